@@ -0,0 +1,63 @@
+## Copyright (C) 2024 Daniel Marks
+##
+## This is licensed under the zlib license
+##
+## Permission is granted to anyone to use this software for any purpose,#
+## including commercial applications, and to alter it and redistribute it
+## freely, subject to the following restrictions:
+##
+## 1. The origin of this software must not be misrepresented; you must not
+##   claim that you wrote the original software. If you use this software
+##   in a product, an acknowledgment in the product documentation would be
+##   appreciated but is not required.
+## 2. Altered source versions must be plainly marked as such, and must not be
+##   misrepresented as being the original software.
+## 3. This notice may not be removed or altered from any source distribution.
+## Author: Daniel Marks <Daniel Marks@VECTRON>
+
+## Compensation FIR for the CIC decimator of the ADC input
+## r = decimation ratio
+## n = number of CIC stages
+## fp = passband edge in Hz, the droop is flattened from DC to fp
+## bits = quantized to bits bits
+##
+## Five symmetric taps at the 25 kHz sample rate are fitted by least squares
+## to the inverse of the CIC response over the passband.  The rounding error
+## of the sum is taken up by the center tap, so the gain at DC is exactly
+## 2^bits.  For gpico:
+##    ciccomp(8,3,8000,14)   adc_cic_taps
+
+function qcoeffs = ciccomp (r,n,fp,bits)
+
+fs = 25000;
+f = (1:400)*(fp/400);
+w = 2*pi*f/fs;
+hcic = abs(sin(pi*f/fs)./(r*sin(pi*f/(r*fs)))).^n;
+
+a = [2*(cos(w)-1); 2*(cos(2*w)-1)]';
+h = a \ (1./hcic - 1)';
+qh = floor(h*2^bits + 0.5);
+qcoeffs = [qh(2) qh(1) 2^bits-2*sum(qh) qh(1) qh(2)];
+coeffs = qcoeffs/(2^bits);
+
+figure(1);
+fr = (0:1000)*(fs/2000);
+wr = 2*pi*fr/fs;
+hr = abs(sin(pi*fr/fs)./(r*sin(pi*fr/(r*fs)))).^n;
+hr(1) = 1;
+comp = coeffs(3) + 2*coeffs(2)*cos(wr) + 2*coeffs(1)*cos(2*wr);
+subplot(2,1,1);
+plot(fr,20*log10(hr),'r',fr,20*log10(abs(comp.*hr)),'b');
+axis([0 fs/2 -10 2]);
+xlabel('Frequency (Hz)');
+ylabel('Amplitude (dB)');
+fa = (0:1000)*(r*fs/2000);
+ha = abs(sin(pi*fa/fs)./(r*sin(pi*fa/(r*fs)))).^n;
+ha(1) = 1;
+subplot(2,1,2);
+plot(fa,20*log10(ha),'r');
+axis([0 r*fs/2 -120 5]);
+xlabel('Input Frequency (Hz)');
+ylabel('CIC Amplitude (dB)');
+
+endfunction
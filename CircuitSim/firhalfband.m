@@ -0,0 +1,78 @@
+## Copyright (C) 2024 Daniel Marks
+##
+## This is licensed under the zlib license
+##
+## Permission is granted to anyone to use this software for any purpose,#
+## including commercial applications, and to alter it and redistribute it
+## freely, subject to the following restrictions:
+##
+## 1. The origin of this software must not be misrepresented; you must not
+##   claim that you wrote the original software. If you use this software
+##   in a product, an acknowledgment in the product documentation would be
+##   appreciated but is not required.
+## 2. Altered source versions must be plainly marked as such, and must not be
+##   misrepresented as being the original software.
+## 3. This notice may not be removed or altered from any source distribution.
+## Author: Daniel Marks <Daniel Marks@VECTRON>
+
+## Half band low pass FIR coefficients for 2x interpolation and decimation
+## m = number of non-zero taps either side of the center (4m-1 taps)
+## bits = quantized to bits bits
+## coswindow = cosine window applied (0.0 to 1.0)
+##    0=rectangular, 1=cosine, 0.5=Hann, 0.53836=Hamming
+## coswindowpwr = power of cosine window (normally one)
+##
+## The coefficients are those of the interpolator, with a gain of 2, so the
+## center tap is 2^bits and the taps either side sum to 2^(bits-1).  Every
+## other tap is zero.  The rounding error of the sum is taken up by the
+## taps next to the center, so the gain at DC is exact.  The decimator uses
+## the same taps divided by 2.  For gpico:
+##    firhalfband(4,15,1.0,3)  1x to 2x, dsp_halfband_1x
+##    firhalfband(2,15,1.0,1)  2x to 4x, dsp_halfband_2x
+
+function qcoeffs = firhalfband (m,bits,coswindow,coswindowpwr)
+
+if nargin<4
+    coswindowpwr = 1;
+  endif
+if nargin<3
+    coswindow = 0.0
+  endif
+
+n=2*m-1;
+samp = (-n:n);
+coeffs = sin((pi/2).*samp)./(pi.*samp).*(mod(samp,2)==1);
+coeffs(n+1)=0;
+coswindow = coswindow*(cos(((pi/2)/(n+1)).*samp)).^coswindowpwr+(1.0-coswindow);
+coeffs = coeffs.*coswindow;
+
+coeffs = coeffs.*(0.5/sum(coeffs(n+2:2*n+1)));
+qcoeffs = floor(coeffs * 2^bits + 0.5);
+qcoeffs(n+1) = 2^bits;
+err = 2^(bits-1) - sum(qcoeffs(n+2:2*n+1));
+qcoeffs(n+2) = qcoeffs(n+2) + err;
+qcoeffs(n) = qcoeffs(n) + err;
+coeffs = qcoeffs/(2^(bits+1));
+
+
+figure(1);
+resp = [ coeffs(n+1:2*n+1) zeros(1,8*n-1) coeffs(1:n) ];
+spectrum = fftshift(fft(resp));
+
+nyq = (-(5*n):(5*n)-1)/(10*n);
+subplot(2,2,1);
+plot(samp,coeffs,'.')';
+xlabel('Sample #');
+ylabel('Value');
+subplot(2,2,3);
+plot(nyq,20*log10(abs(spectrum)),'r');
+axis([-0.5 0.5 -80 5]);
+xlabel('Sample Frequency Frac');
+ylabel('Amplitude (dB)');
+subplot(2,2,4);
+plot(nyq,angle(spectrum),'b');
+axis([-0.5 0.5 -pi pi]);
+xlabel('Sample Frequency Frac');
+ylabel('Phase (rad)');
+
+endfunction
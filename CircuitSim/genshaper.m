@@ -0,0 +1,59 @@
+## Copyright (C) 2024 Daniel Marks
+##
+## This is licensed under the zlib license
+##
+## Permission is granted to anyone to use this software for any purpose,#
+## including commercial applications, and to alter it and redistribute it
+## freely, subject to the following restrictions:
+##
+## 1. The origin of this software must not be misrepresented; you must not
+##   claim that you wrote the original software. If you use this software
+##   in a product, an acknowledgment in the product documentation would be
+##   appreciated but is not required.
+## 2. Altered source versions must be plainly marked as such, and must not be
+##   misrepresented as being the original software.
+## 3. This notice may not be removed or altered from any source distribution.
+## Author: Daniel Marks <Daniel Marks@VECTRON>
+
+## Transfer curves of the Waveshaper, printed as the C tables of waves.c
+## n = number of intervals (SHAPER_LENGTH), the tables have n+1 entries
+## xmax = the input of the first and last entries is -xmax and xmax
+##
+## The outputs are scaled to 32767.  gpicocoefs checks the tables in
+## waves.c against the same formulas.  For gpico:
+##    genshaper(512,8)
+
+function genshaper (n,xmax)
+
+x = ((0:n)-n/2)*(2*xmax/n);
+pos = (x >= 0);
+
+curves = zeros(4,n+1);
+curves(1,:) = tanh(x);
+curves(2,:) = pos.*(1-exp(-x)) - (1-pos).*0.5.*(1-exp(2*x));
+curves(3,:) = pos.*(x./(1+abs(x).^3).^(1/3)) + (1-pos).*tanh(x);
+curves(4,:) = (2/pi)*asin(sin((pi/2)*x));
+names = { "tanh", "diode", "tube", "foldback" };
+
+qcurves = floor(32767*curves + 0.5);
+
+for c=1:4
+  printf("const int16_t table_shaper_%s[SHAPER_LENGTH+1]={\n",names{c});
+  for i=1:16:n+1
+    s = sprintf("%d,",qcurves(c,i:min(i+15,n+1)));
+    if (i+16 <= n+1)
+      printf("    %s\n",s);
+    else
+      printf("    %s};\n\n",s(1:end-1));
+    endif
+  endfor
+endfor
+
+figure(1);
+plot(x,curves);
+axis([-xmax xmax -1.1 1.1]);
+xlabel('Input');
+ylabel('Output');
+legend(names);
+
+endfunction
@@ -0,0 +1,96 @@
+/* adccic.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "adcdnl.h"
+#include "adccic.h"
+
+/* ciccomp(8,3,8000,14), symmetric, the center tap last.  They sum to 2^14 so
+   the gain at DC is exact. */
+static const int32_t adc_cic_taps[(ADC_CIC_TAPS+1)/2] = { 765, -4597, 24048 };
+
+/* filled as if the input had been at the middle of the ADC's range, so
+   starting does not click */
+void adc_cic_reset(adc_cic_state *acs)
+{
+    uint16_t adc[2*ADC_CIC_RATIO];
+    int16_t out;
+
+    memset((void *)acs, '\000', sizeof(adc_cic_state));
+    for (uint i=0;i<(2*ADC_CIC_RATIO);i++)
+        adc[i] = ADC_MAX_VALUE/2;
+    for (uint i=0;i<(ADC_CIC_STAGES+ADC_CIC_TAPS);i++)
+        adc_cic_block(acs, adc, &out, 1);
+}
+
+/* adc holds n*ADC_CIC_RATIO pairs of conversions, audio then control, as
+   block mode's DMA writes them.  out receives n samples centered on zero,
+   scaled as the per sample path scales a single conversion.  Each audio
+   conversion is corrected by adc_dnl.table as it goes in.  The integrators
+   and combs wrap modulo 2^32, which the CIC allows as long as the registers
+   are wider than the 14 bits of the corrected conversions and its gain, 23
+   bits. */
+void __not_in_flash_func(adc_cic_block)(adc_cic_state *acs, const uint16_t *adc, int16_t *out, uint n)
+{
+    uint32_t i0 = acs->integ[0], i1 = acs->integ[1], i2 = acs->integ[2];
+
+    for (uint i=0;i<n;i++)
+    {
+        for (uint k=0;k<ADC_CIC_RATIO;k++)
+        {
+            i0 += adc_dnl.table[adc[0] & (ADC_MAX_VALUE-1)];
+            i1 += i0;
+            i2 += i1;
+            adc += 2;
+        }
+        uint32_t c0 = i2 - acs->comb[0];
+        acs->comb[0] = i2;
+        uint32_t c1 = c0 - acs->comb[1];
+        acs->comb[1] = c0;
+        uint32_t c2 = c1 - acs->comb[2];
+        acs->comb[2] = c1;
+
+        int32_t v = (((int32_t)c2) - ((ADC_PREC_VALUE/2) << ADC_CIC_GAIN_BITS)) >> ADC_CIC_FIR_SHIFT;
+        int32_t *f = acs->fir;
+        int32_t y = adc_cic_taps[0]*(v + f[3]) + adc_cic_taps[1]*(f[0] + f[2]) + adc_cic_taps[2]*f[1];
+        f[3] = f[2];
+        f[2] = f[1];
+        f[1] = f[0];
+        f[0] = v;
+
+        /* from 16 bits to the scale of ADC_PREC_VALUE, 14 */
+        y >>= ADC_CIC_FIR_BITS + ADC_CIC_GAIN_BITS - ADC_CIC_FIR_SHIFT;
+        if (y > (ADC_PREC_VALUE/2-1)) y = ADC_PREC_VALUE/2-1;
+        if (y < (-ADC_PREC_VALUE/2)) y = -ADC_PREC_VALUE/2;
+        out[i] = y;
+    }
+    acs->integ[0] = i0;
+    acs->integ[1] = i1;
+    acs->integ[2] = i2;
+}
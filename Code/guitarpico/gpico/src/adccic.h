@@ -0,0 +1,74 @@
+/* adccic.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ADCCIC_H
+#define __ADCCIC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ADC oversampling for block mode.  The ADC converts the audio input
+   ADC_CIC_RATIO times per sample, round robin with the control input, and
+   the audio conversions are decimated to the sample rate by a cascaded
+   integrator comb filter of ADC_CIC_STAGES stages followed by a short FIR
+   that flattens the droop of the CIC across the passband.  The noise of the
+   ADC is spread over eight times the bandwidth, so about one and a half bits
+   more of the 14 bit samples are signal.
+
+   The taps of the compensation FIR are printed by CircuitSim/ciccomp.m,
+   ciccomp(8,3,8000,14), which fits the inverse of the CIC response from DC
+   to 8 kHz: flat to 0.15 dB there, -1.4 dB at 10 kHz.  Tones around 25 kHz
+   that fold to 5 kHz and below are at least 35 dB down.  The CIC and FIR
+   delay the input by 2.4 samples (100 us) more than taking one conversion
+   per sample does. */
+
+#define ADC_CIC_RATIO 8
+#define ADC_CIC_STAGES 3
+#define ADC_CIC_TAPS 5
+#define ADC_CIC_DELAY_US 100
+
+/* the conversions go in corrected by adc_dnl.table, 14 bits.  The CIC has
+   a gain of ADC_CIC_RATIO^ADC_CIC_STAGES, 2^9, and the FIR works on its
+   output shifted down to 16 bits, two more than the samples. */
+#define ADC_CIC_GAIN_BITS 9
+#define ADC_CIC_FIR_SHIFT 7
+#define ADC_CIC_FIR_BITS 14
+
+typedef struct
+{
+    uint32_t integ[ADC_CIC_STAGES];
+    uint32_t comb[ADC_CIC_STAGES];
+    int32_t fir[ADC_CIC_TAPS-1];
+} adc_cic_state;
+
+void adc_cic_reset(adc_cic_state *acs);
+void adc_cic_block(adc_cic_state *acs, const uint16_t *adc, int16_t *out, uint n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADCCIC_H */
@@ -0,0 +1,146 @@
+/* adcdnl.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "adcdnl.h"
+
+/* in SRAM, it is read for every conversion */
+adc_dnl_data adc_dnl;
+
+/* the straight line */
+void adc_dnl_reset(adc_dnl_data *add)
+{
+    for (uint k=0;k<ADC_MAX_VALUE;k++)
+        add->table[k] = k*(ADC_PREC_VALUE/ADC_MAX_VALUE);
+    adc_dnl_seal(add);
+}
+
+static uint32_t adc_dnl_checksum(const adc_dnl_data *add)
+{
+    uint32_t sum = ADC_DNL_MAGIC_NUMBER;
+    for (uint k=0;k<ADC_MAX_VALUE;k++)
+        sum = (sum << 1) + (sum >> 31) + add->table[k];
+    return sum;
+}
+
+void adc_dnl_seal(adc_dnl_data *add)
+{
+    add->magic_number = ADC_DNL_MAGIC_NUMBER;
+    add->checksum = adc_dnl_checksum(add);
+}
+
+bool adc_dnl_valid(const adc_dnl_data *add)
+{
+    return (add->magic_number == ADC_DNL_MAGIC_NUMBER) && (add->checksum == adc_dnl_checksum(add));
+}
+
+/* table_sine_quarter interpolated, in Q30, one turn of phase is 2^32 */
+static int32_t adc_dnl_sin(uint32_t phase)
+{
+    uint32_t quarter = phase & 0x3FFFFFFFu;
+    if (phase & 0x40000000u) quarter = 0x40000000u - quarter;
+    uint32_t index = quarter >> 22;
+    int32_t frac = (quarter >> 6) & 0xFFFF;
+    int32_t s0 = table_sine_quarter[index];
+    int32_t s1 = table_sine_quarter[index + (index < SINE_QUARTER_LENGTH)];
+    int32_t s = s0 + (int32_t)((((int64_t)(s1 - s0)) * frac) >> 16);
+    return (phase & 0x80000000u) ? -s : s;
+}
+
+/* where an edge with below of total conversions under it sits on the sine,
+   -1 to 1 in Q30.  A sine spends the fraction acos(-x)/pi of its time
+   below x. */
+static int32_t adc_dnl_edge(uint64_t below, uint64_t total)
+{
+    uint32_t phase = (uint32_t)((below << 31) / total);
+    return adc_dnl_sin(phase - 0x40000000u);
+}
+
+/* hist holds the count of each code, which saturates at 65535.  Returns
+   false, leaving the table alone, if too little of the range was reached
+   or a count saturated, which a sine clipped at either end does. */
+bool adc_dnl_build(const uint16_t *hist, adc_dnl_data *add, adc_dnl_report *adr)
+{
+    int first = -1, last = -1;
+    uint64_t total = 0;
+
+    for (uint k=0;k<ADC_MAX_VALUE;k++)
+    {
+        if (hist[k] == 0xFFFF) return false;
+        if (hist[k] != 0)
+        {
+            if (first < 0) first = k;
+            last = k;
+        }
+        total += hist[k];
+    }
+    first += ADC_DNL_TRIM;
+    last -= ADC_DNL_TRIM;
+    if ((first < 0) || ((last - first + 1) < ADC_DNL_MIN_CODES)) return false;
+
+    /* the edges from first to last+1 are stretched to span last+1-first
+       codes, in 1/65536ths of a code */
+    uint64_t below = 0, below_last = 0;
+    for (int k=0;k<=last;k++)
+    {
+        if (k < first) below += hist[k];
+        below_last += hist[k];
+    }
+    int32_t edge_first = adc_dnl_edge(below, total);
+    int64_t span = ((int64_t)adc_dnl_edge(below_last, total)) - edge_first;
+    int64_t scale = ((int64_t)(last + 1 - first)) << 16;
+    int32_t edge = edge_first;
+    adc_dnl_reset(add);
+    memset(adr, '\000', sizeof(*adr));
+    adr->first_code = first;
+    adr->last_code = last;
+    for (int k=first;k<=last;k++)
+    {
+        below += hist[k];
+        int32_t edge_next = adc_dnl_edge(below, total);
+        int64_t center = (((((int64_t)edge) + edge_next)/2 - edge_first) * scale) / span;
+        /* from the middle of the code to its value on the straight line,
+           which is its lower edge */
+        int32_t pos = (int32_t)(((uint32_t)first) << 16) + (int32_t)center - 32768;
+        int32_t value = (pos*(ADC_PREC_VALUE/ADC_MAX_VALUE) + 32768) >> 16;
+        if (value < 0) value = 0;
+        if (value > (ADC_PREC_VALUE-1)) value = ADC_PREC_VALUE-1;
+        add->table[k] = value;
+        int correction = value - k*(ADC_PREC_VALUE/ADC_MAX_VALUE);
+        if (abs(correction) > abs(adr->worst_correction))
+        {
+            adr->worst_correction = correction;
+            adr->worst_code = k;
+        }
+        edge = edge_next;
+    }
+    adc_dnl_seal(add);
+    return true;
+}
@@ -0,0 +1,80 @@
+/* adcdnl.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ADCDNL_H
+#define __ADCDNL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Correction of the differential nonlinearity of the RP2040's ADC, whose
+   codes are not all the same width; a few around 512, 1536, 2560 and 3584
+   are several times wider than the rest.  Each conversion is looked up in
+   adc_dnl.table, which gives the middle of the input range of its code in
+   ADC_PREC_VALUE units, where a straight line would give 4 times the code.
+
+   The table is built by adc_dnl_build from a histogram of conversions of a
+   steady sine that swings over most of the range without clipping (the
+   code density test).  The fraction of the conversions below a code gives
+   where its lower edge is on the sine, whatever the widths of the codes
+   around it.  The outermost ADC_DNL_TRIM codes that were reached, where
+   noise moves the counts most, and the codes beyond are left on the
+   straight line, and the corrected codes are stretched to meet it at both
+   ends, so the gain and offset are unchanged. */
+
+#define ADC_DNL_TRIM 16
+/* the least number of codes that must be corrected for a table to be
+   built */
+#define ADC_DNL_MIN_CODES 1024
+#define ADC_DNL_MAGIC_NUMBER 0xAD0CD41Eu
+
+typedef struct
+{
+    uint32_t magic_number;
+    uint32_t checksum;
+    uint16_t table[ADC_MAX_VALUE];
+} adc_dnl_data;
+
+typedef struct
+{
+    uint first_code;
+    uint last_code;
+    int worst_correction;          /* in ADC_PREC_VALUE units */
+    uint worst_code;
+} adc_dnl_report;
+
+extern adc_dnl_data adc_dnl;
+
+void adc_dnl_reset(adc_dnl_data *add);
+void adc_dnl_seal(adc_dnl_data *add);
+bool adc_dnl_valid(const adc_dnl_data *add);
+bool adc_dnl_build(const uint16_t *hist, adc_dnl_data *add, adc_dnl_report *adr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADCDNL_H */
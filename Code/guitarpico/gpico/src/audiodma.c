@@ -0,0 +1,188 @@
+/* audiodma.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "hardware/irq.h"
+#include "audioring.h"
+#include "audiodma.h"
+
+/* the ADC and PWM buffers are rings for the DMA, so each half is aligned to
+   its size at the largest block and oversampling.  The channels wrap by
+   themselves, so with interrupts off the PWM repeats the last two blocks
+   over and over; audio has to be stopped before a flash write. */
+static uint16_t audio_dma_adc_buf[2][2*AUDIO_RING_OVERSAMPLE_MAX*AUDIO_DMA_BLOCK_MAX] __attribute__ ((aligned(4*AUDIO_RING_OVERSAMPLE_MAX*AUDIO_DMA_BLOCK_MAX)));
+static uint32_t audio_dma_pwm_buf[2*AUDIO_DMA_BLOCK_MAX] __attribute__ ((aligned(8*AUDIO_DMA_BLOCK_MAX)));
+
+/* the PWM channels run for 2^32-1 samples, about 47 hours, and are re-armed
+   from the interrupt well before they stop */
+#define AUDIO_DMA_PWM_COUNT 0xFFFFFFFFu
+#define AUDIO_DMA_PWM_REARM 0x01000000u
+
+static uint audio_dma_block_size;
+static int audio_dma_timer = -1;
+static audio_dma_block_func *audio_dma_block;
+volatile uint32_t audio_dma_late_blocks;
+
+bool audio_dma_block_size_valid(uint block_size)
+{
+    return audio_ring_block_size_valid(block_size);
+}
+
+bool audio_dma_running(void)
+{
+    return audio_dma_block_size != 0;
+}
+
+static uint audio_dma_ring_bits(uint bytes)
+{
+    return __builtin_ctz(bytes);
+}
+
+static void audio_dma_rearm_pwm(void)
+{
+    for (uint ch=AUDIO_DMA_PWM_A;ch<=AUDIO_DMA_PWM_B;ch++)
+    {
+        uint32_t read_addr = dma_channel_hw_addr(ch)->read_addr;
+        dma_channel_abort(ch);
+        dma_channel_set_trans_count(ch, AUDIO_DMA_PWM_COUNT, false);
+        dma_channel_set_read_addr(ch, (const void *)read_addr, true);
+    }
+}
+
+static void __no_inline_not_in_flash_func(audio_dma_irq)(void)
+{
+    const uint32_t ping = 1u << AUDIO_DMA_ADC_PING;
+    const uint32_t pong = 1u << AUDIO_DMA_ADC_PONG;
+    uint n = audio_dma_block_size;
+
+    for (;;)
+    {
+        uint32_t ints = dma_hw->ints1;
+        int half = audio_ring_next_half(((ints & ping) ? AUDIO_RING_PING : 0) |
+                                        ((ints & pong) ? AUDIO_RING_PONG : 0), &audio_dma_late_blocks);
+        if (half < 0) break;
+        dma_hw->ints1 = half ? pong : ping;
+        audio_dma_block(audio_dma_adc_buf[half], &audio_dma_pwm_buf[half*n], n);
+    }
+    if (dma_channel_hw_addr(AUDIO_DMA_PWM_A)->transfer_count < AUDIO_DMA_PWM_REARM)
+        audio_dma_rearm_pwm();
+}
+
+static void audio_dma_configure_adc(uint ch, uint chain_to, uint16_t *buf, uint conversions)
+{
+    dma_channel_config c = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, audio_dma_ring_bits(conversions*sizeof(uint16_t)));
+    channel_config_set_dreq(&c, DREQ_ADC);
+    channel_config_set_chain_to(&c, chain_to);
+    dma_channel_configure(ch, &c, buf, &adc_hw->fifo, conversions, false);
+    dma_channel_set_irq1_enabled(ch, true);
+}
+
+static void audio_dma_configure_pwm(uint ch, uint slice, uint n)
+{
+    dma_channel_config c = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, audio_dma_ring_bits(2*n*sizeof(uint32_t)));
+    channel_config_set_dreq(&c, dma_get_timer_dreq(audio_dma_timer));
+    dma_channel_configure(ch, &c, &pwm_hw->slice[slice].cc, audio_dma_pwm_buf, AUDIO_DMA_PWM_COUNT, false);
+}
+
+/* The per sample alarm must be stopped first.  The ADC is left running round
+   robin at 2*oversample times the sample rate with its FIFO feeding the
+   DMA. */
+bool audio_dma_start(uint block_size, uint oversample, uint pwm_slice_a, uint pwm_slice_b, audio_dma_block_func *abf)
+{
+    uint16_t num, den;
+
+    if (!audio_dma_block_size_valid(block_size)) return false;
+    if (!audio_ring_oversample_valid(oversample)) return false;
+    audio_dma_stop();
+    if (audio_dma_timer < 0)
+    {
+        for (uint ch=AUDIO_DMA_ADC_PING;ch<=AUDIO_DMA_PWM_B;ch++)
+            dma_channel_claim(ch);
+        audio_dma_timer = dma_claim_unused_timer(true);
+        irq_set_exclusive_handler(DMA_IRQ_1, audio_dma_irq);
+    }
+    audio_dma_block = abf;
+    memset(audio_dma_adc_buf, '\000', sizeof(audio_dma_adc_buf));
+    for (uint i=0;i<(sizeof(audio_dma_pwm_buf)/sizeof(audio_dma_pwm_buf[0]));i++)
+        audio_dma_pwm_buf[i] = (DAC_PWM_WRAP_VALUE/2) | ((DAC_PWM_WRAP_VALUE/2) << 16);
+
+    adc_run(false);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv((float)audio_ring_adc_clkdiv(clock_get_hz(clk_adc), GUITARPICO_SAMPLERATE, oversample));
+    adc_select_input(0);
+    adc_set_round_robin(0x03);
+
+    audio_ring_timer_fraction(clock_get_hz(clk_sys), GUITARPICO_SAMPLERATE, &num, &den);
+    dma_timer_set_fraction(audio_dma_timer, num, den);
+
+    audio_dma_configure_adc(AUDIO_DMA_ADC_PING, AUDIO_DMA_ADC_PONG, audio_dma_adc_buf[0], 2*oversample*block_size);
+    audio_dma_configure_adc(AUDIO_DMA_ADC_PONG, AUDIO_DMA_ADC_PING, audio_dma_adc_buf[1], 2*oversample*block_size);
+    audio_dma_configure_pwm(AUDIO_DMA_PWM_A, pwm_slice_a, block_size);
+    audio_dma_configure_pwm(AUDIO_DMA_PWM_B, pwm_slice_b, block_size);
+    audio_dma_block_size = block_size;
+    dma_hw->ints1 = (1u << AUDIO_DMA_ADC_PING) | (1u << AUDIO_DMA_ADC_PONG);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    /* the PWM ring starts playing silence with the ADC, so the first input
+       block has a whole block period to be processed before its half of
+       the ring comes around */
+    dma_start_channel_mask((1u << AUDIO_DMA_ADC_PING) | (1u << AUDIO_DMA_PWM_A) | (1u << AUDIO_DMA_PWM_B));
+    adc_run(true);
+    return true;
+}
+
+/* leaves the ADC as initialize_adc sets it up for the per sample alarm */
+void audio_dma_stop(void)
+{
+    if (!audio_dma_running()) return;
+    adc_run(false);
+    irq_set_enabled(DMA_IRQ_1, false);
+    for (uint ch=AUDIO_DMA_ADC_PING;ch<=AUDIO_DMA_PWM_B;ch++)
+    {
+        if (ch <= AUDIO_DMA_ADC_PONG) dma_channel_set_irq1_enabled(ch, false);
+        dma_channel_abort(ch);
+    }
+    dma_hw->ints1 = (1u << AUDIO_DMA_ADC_PING) | (1u << AUDIO_DMA_ADC_PONG);
+    adc_set_round_robin(0);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(100);
+    adc_select_input(0);
+    audio_dma_block_size = 0;
+    adc_run(true);
+}
@@ -0,0 +1,71 @@
+/* audiodma.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __AUDIODMA_H
+#define __AUDIODMA_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Block mode audio.  The ADC converts the audio and control inputs round
+   robin into a pair of ping-pong buffers, and two channels play a ring of
+   PWM compare values into the two DAC slices, paced by a DMA timer at the
+   sample rate.  When a block of input is complete the block function is
+   called from the DMA interrupt with the interleaved ADC samples (audio,
+   control, audio, control ...), oversample pairs of them per sample, and
+   the half of the PWM ring that plays next.  The latency is two blocks,
+   and the processing has one block period.  This is the default, and the
+   CPU only runs the chain; the per sample alarm, which switches the ADC
+   input and re-arms itself twice a sample, is kept for SPLIT and JITTER.
+
+   The DAC slices wrap every 1024 clocks of clk_sys, several times a sample,
+   so their wrap cannot pace the ring.  The compare values are double
+   buffered by the PWM and take effect at the next wrap, so writing them
+   from the DMA timer does not glitch the output.
+
+   picovga uses DMA channels 0 to 7 without claiming them, so the audio
+   channels are fixed above those. */
+
+#define AUDIO_DMA_ADC_PING 8
+#define AUDIO_DMA_ADC_PONG 9
+#define AUDIO_DMA_PWM_A 10
+#define AUDIO_DMA_PWM_B 11
+
+#define AUDIO_DMA_BLOCK_MAX AUDIO_RING_BLOCK_MAX
+
+typedef void (audio_dma_block_func)(const uint16_t *adc, uint32_t *pwm, uint n);
+
+bool audio_dma_block_size_valid(uint block_size);
+bool audio_dma_start(uint block_size, uint oversample, uint pwm_slice_a, uint pwm_slice_b, audio_dma_block_func *abf);
+void audio_dma_stop(void);
+bool audio_dma_running(void);
+extern volatile uint32_t audio_dma_late_blocks;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIODMA_H */
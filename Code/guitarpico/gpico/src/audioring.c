@@ -0,0 +1,114 @@
+/* audioring.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "audioring.h"
+
+/* a power of two, so the halves are DMA rings */
+bool audio_ring_block_size_valid(uint block_size)
+{
+    return (block_size >= AUDIO_RING_BLOCK_MIN) && (block_size <= AUDIO_RING_BLOCK_MAX) &&
+           ((block_size & (block_size-1)) == 0);
+}
+
+bool audio_ring_oversample_valid(uint oversample)
+{
+    return (oversample >= 1) && (oversample <= AUDIO_RING_OVERSAMPLE_MAX) &&
+           ((oversample & (oversample-1)) == 0);
+}
+
+/* in samples from the ADC to the PWM */
+uint audio_ring_latency(uint block_size)
+{
+    return 2*block_size;
+}
+
+/* The half to process for the completion flags pending, or -1 when there is
+   none.  Both pending means the interrupt was held off for a whole block and
+   one has been missed; ping is taken first and pong on the next call. */
+int __not_in_flash_func(audio_ring_next_half)(uint pending, volatile uint32_t *late_blocks)
+{
+    if (pending == (AUDIO_RING_PING | AUDIO_RING_PONG))
+        (*late_blocks)++;
+    if (pending & AUDIO_RING_PING) return 0;
+    if (pending & AUDIO_RING_PONG) return 1;
+    return -1;
+}
+
+/* the DMA timer runs at clk_sys * num / den.  With the clocks picovga sets
+   the sample rate is usually an exact fraction of clk_sys, and as clk_adc
+   and clk_sys come from the same crystal the input and output then do not
+   drift apart.  Otherwise the closest fraction with a 16 bit numerator and
+   denominator is taken from the continued fraction of rate / clk, which
+   keeps the drift to a fraction of a ppm, where the nearest whole divider
+   could be 100 ppm out and slip a sample every half second. */
+void audio_ring_timer_fraction(uint32_t clk, uint32_t rate, uint16_t *num, uint16_t *den)
+{
+    uint32_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    uint32_t a_num = rate, a_den = clk;
+
+    while (a_den != 0)
+    {
+        uint32_t a = a_num / a_den;
+        uint32_t p2 = a*p1 + p0, q2 = a*q1 + q0;
+        if ((p2 > 0xFFFF) || (q2 > 0xFFFF))
+        {
+            /* the largest step towards the next convergent that fits, taken
+               if it is closer than the last convergent */
+            uint32_t t = 0xFFFF;
+            if ((q1 != 0) && (((0xFFFF - q0) / q1) < t)) t = (0xFFFF - q0) / q1;
+            if ((p1 != 0) && (((0xFFFF - p0) / p1) < t)) t = (0xFFFF - p0) / p1;
+            uint32_t ps = t*p1 + p0, qs = t*q1 + q0;
+            uint64_t err1 = (uint64_t)llabs((int64_t)p1*clk - (int64_t)q1*rate);
+            uint64_t errs = (uint64_t)llabs((int64_t)ps*clk - (int64_t)qs*rate);
+            if (errs*q1 < err1*qs)
+            {
+                p1 = ps;
+                q1 = qs;
+            }
+            break;
+        }
+        p0 = p1;
+        q0 = q1;
+        p1 = p2;
+        q1 = q2;
+        uint32_t r = a_num % a_den;
+        a_num = a_den;
+        a_den = r;
+    }
+    *num = p1;
+    *den = q1;
+}
+
+/* The ADC converts the audio and control inputs round robin, oversample
+   times each per sample.  A conversion takes clkdiv+1 cycles of clk_adc. */
+uint32_t audio_ring_adc_clkdiv(uint32_t clk_adc, uint32_t rate, uint oversample)
+{
+    return clk_adc / (2*oversample*rate) - 1;
+}
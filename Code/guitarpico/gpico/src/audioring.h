@@ -0,0 +1,67 @@
+/* audioring.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __AUDIORING_H
+#define __AUDIORING_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The bookkeeping of the DMA rings of block mode (see audiodma.h), kept
+   apart from the hardware so that the host build can drive it from a model
+   of the sample clock (host/gpicoclock.c).
+
+   The ADC ping and pong channels each fill one half of the input, chained
+   to each other, and the PWM channels play a ring of two halves.  The block
+   from an input half is written to the same half of the PWM ring, which
+   starts playing one block after the input half completed, so the latency
+   is two blocks and the processing has one block period. */
+
+#define AUDIO_RING_BLOCK_MIN 4
+#define AUDIO_RING_BLOCK_MAX 32
+#define AUDIO_RING_BLOCK_DEFAULT 8
+
+/* the conversions of each input per sample, so the ADC runs at up to
+   2*8*25 kHz, 400 kHz, of the 500 kHz it can */
+#define AUDIO_RING_OVERSAMPLE_MAX 8
+
+/* the completion flags of the ADC channels, as passed to
+   audio_ring_next_half */
+#define AUDIO_RING_PING 0x01
+#define AUDIO_RING_PONG 0x02
+
+bool audio_ring_block_size_valid(uint block_size);
+bool audio_ring_oversample_valid(uint oversample);
+uint audio_ring_latency(uint block_size);
+int audio_ring_next_half(uint pending, volatile uint32_t *late_blocks);
+void audio_ring_timer_fraction(uint32_t clk, uint32_t rate, uint16_t *num, uint16_t *den);
+uint32_t audio_ring_adc_clkdiv(uint32_t clk_adc, uint32_t rate, uint oversample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIORING_H */
@@ -0,0 +1,348 @@
+/* cabinet.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "dsp.h"
+#include "cabinet.h"
+
+static inline int16_t cabinet_saturate(int32_t x)
+{
+    if (x > 32767) return 32767;
+    if (x < -32768) return -32768;
+    return x;
+}
+
+/* In place radix 2 FFT of CABINET_FFT_SIZE points, with the twiddle factors
+   read from table_sine.  The stages from scale_from on halve their outputs.
+   No stage more than doubles the largest magnitude, so if the magnitudes
+   of the input are below 2^(15-scale_from) they stay below 2^15 all the
+   way through and the products with the Q15 twiddles fit in 32 bits. */
+void cabinet_fft(cabinet_complex *x, uint32_t scale_from, bool inverse)
+{
+    for (uint32_t i=1,j=0;i<CABINET_FFT_SIZE;i++)
+    {
+        uint32_t bit = CABINET_FFT_SIZE >> 1;
+        for (;j & bit;bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            cabinet_complex t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+    }
+    for (uint32_t len=2,stage=0;len<=CABINET_FFT_SIZE;len<<=1,stage++)
+    {
+        uint32_t half = len >> 1;
+        uint32_t step = WAVETABLES_LENGTH / len;
+        uint32_t scale = (stage >= scale_from) ? 1 : 0;
+        for (uint32_t k=0;k<half;k++)
+        {
+            int32_t c = table_sine[k*step + WAVETABLES_LENGTH/4];
+            int32_t s = inverse ? table_sine[k*step] : -table_sine[k*step];
+            for (uint32_t i=k;i<CABINET_FFT_SIZE;i+=len)
+            {
+                cabinet_complex *a = &x[i];
+                cabinet_complex *b = &x[i+half];
+                int32_t tr = (b->re * c - b->im * s + (1 << 14)) >> 15;
+                int32_t ti = (b->re * s + b->im * c + (1 << 14)) >> 15;
+                b->re = (a->re - tr) >> scale;
+                b->im = (a->im - ti) >> scale;
+                a->re = (a->re + tr) >> scale;
+                a->im = (a->im + ti) >> scale;
+            }
+        }
+    }
+}
+
+/* the tail taps of an IR are shifted up by this much so that the largest
+   is close to full scale, the output of the tail is shifted down again */
+int32_t cabinet_tail_shift(const cabinet_ir *ir)
+{
+    int32_t most = 0;
+    int32_t shift = 0;
+    for (uint32_t i=CABINET_HEAD;i<ir->length;i++)
+        if (abs(ir->taps[i]) > most) most = abs(ir->taps[i]);
+    if (most == 0) return 0;
+    while ((most << (shift+1)) <= 32767) shift++;
+    return shift;
+}
+
+/* The spectrum of partition part of the tail, the CABINET_BLOCK taps from
+   CABINET_HEAD+part*CABINET_BLOCK padded with zeros.  Every stage of the
+   FFT is scaled, so the bins are below 2^14. */
+void cabinet_partition(cabinet_bin *h, const cabinet_ir *ir, uint32_t part, int32_t shift, cabinet_complex *work)
+{
+    uint32_t start = CABINET_HEAD + part*CABINET_BLOCK;
+    for (uint32_t i=0;i<CABINET_FFT_SIZE;i++)
+    {
+        uint32_t t = start + i;
+        work[i].re = ((i < CABINET_BLOCK) && (t < ir->length)) ? (((int32_t)ir->taps[t]) * (1 << shift)) : 0;
+        work[i].im = 0;
+    }
+    cabinet_fft(work, 0, false);
+    for (uint32_t k=0;k<CABINET_BINS;k++)
+    {
+        h[k].re = work[k].re;
+        h[k].im = work[k].im;
+    }
+}
+
+/* The spectrum of input blocks block-1 and block from the ring.  The input
+   is below 2^13 and the first two stages are not scaled, so the bins are
+   1/16 of the DFT and below 2^15. */
+void cabinet_spectrum(cabinet_bin *x, const int16_t *in, uint32_t block, cabinet_complex *work)
+{
+    uint32_t base = (block - 1) * CABINET_BLOCK;
+    for (uint32_t i=0;i<CABINET_FFT_SIZE;i++)
+    {
+        work[i].re = in[(base + i) & (CABINET_RING-1)];
+        work[i].im = 0;
+    }
+    cabinet_fft(work, 2, false);
+    for (uint32_t k=0;k<CABINET_BINS;k++)
+    {
+        x[k].re = cabinet_saturate(work[k].re);
+        x[k].im = cabinet_saturate(work[k].im);
+    }
+}
+
+/* One block of the tail by overlap-save.  The input spectra in the ring fdl
+   are multiplied by the spectra of the partitions and summed, the newest
+   input (at fdl_pos) with the first partition.  The sum is normalised so
+   that its largest part is 2^14 before the inverse FFT, and the output is
+   scaled back by that and by the shift of the taps.  Only the first
+   parts_ready partitions are used. */
+void cabinet_tail(int16_t *out, const cabinet_bin *fdl, uint32_t fdl_pos, const cabinet_bin *h, uint32_t parts,
+                  uint32_t parts_ready, int32_t shift, cabinet_complex *work)
+{
+    uint32_t slot = fdl_pos;
+    uint32_t most = 0;
+    uint32_t bits = 0;
+
+    for (uint32_t k=0;k<CABINET_BINS;k++)
+    {
+        work[k].re = 0;
+        work[k].im = 0;
+    }
+    for (uint32_t p=0;p<parts_ready;p++)
+    {
+        const cabinet_bin *xb = &fdl[slot*CABINET_BINS];
+        const cabinet_bin *hb = &h[p*CABINET_BINS];
+        for (uint32_t k=0;k<CABINET_BINS;k++)
+        {
+            work[k].re += (xb[k].re * hb[k].re - xb[k].im * hb[k].im) >> 5;
+            work[k].im += (xb[k].re * hb[k].im + xb[k].im * hb[k].re) >> 5;
+        }
+        slot = (slot == 0) ? (parts - 1) : (slot - 1);
+    }
+    for (uint32_t k=0;k<CABINET_BINS;k++)
+        most |= abs(work[k].re) | abs(work[k].im);
+    if (most == 0)
+    {
+        memset((void *)out, '\000', CABINET_BLOCK*sizeof(int16_t));
+        return;
+    }
+    while (most >> bits) bits++;
+
+    int32_t s = ((int32_t)bits) - 14;
+    for (uint32_t k=0;k<CABINET_BINS;k++)
+    {
+        if (s > 0)
+        {
+            work[k].re = (work[k].re + (1 << (s-1))) >> s;
+            work[k].im = (work[k].im + (1 << (s-1))) >> s;
+        } else
+        {
+            work[k].re *= (1 << -s);
+            work[k].im *= (1 << -s);
+        }
+    }
+    /* the input is real, so the upper half is the mirror of the lower */
+    work[0].im = 0;
+    work[CABINET_BLOCK].im = 0;
+    for (uint32_t k=1;k<CABINET_BLOCK;k++)
+    {
+        work[CABINET_FFT_SIZE-k].re = work[k].re;
+        work[CABINET_FFT_SIZE-k].im = -work[k].im;
+    }
+    cabinet_fft(work, 0, true);
+
+    /* the product was 1/16 * 1/64 * 2^-5, 2^-15 in all, of the product of
+       the DFTs, which undoes the Q15 of the taps, and scaling every stage
+       makes the inverse FFT the inverse DFT.  That leaves the 2^-s of the
+       normalisation and the 2^shift of the taps. */
+    int32_t sh = s - shift;
+    for (uint32_t n=0;n<CABINET_BLOCK;n++)
+    {
+        int32_t z = work[CABINET_BLOCK+n].re;
+        if (sh >= 0)
+        {
+            if (z > (32767 >> sh)) z = 32767;
+            else if (z < (-32768 >> sh)) z = -32768;
+            else z *= (1 << sh);
+        } else
+            z = (z + (1 << (-sh-1))) >> (-sh);
+        out[n] = cabinet_saturate(z);
+    }
+}
+
+/* The impulse responses are synthetic, made by running an impulse and a
+   few delayed copies of it (the reflections inside the box) through a high
+   pass at the resonance of the speakers, peaks and dips for the cone and
+   two low passes for the roll off of a guitar speaker, and fading out the
+   last quarter.  The largest response at any frequency is 0 dB.  The sum
+   of the magnitudes of the head taps is below 2^31/2^13, so the head may
+   be summed in 32 bits. */
+
+static const int16_t cabinet_ir_1x12[256]={
+    544,2789,5916,6452,3122,-1094,-3165,-2909,-1735,-724,-109,262,496,583,500,287,
+    30,-186,-312,-342,-299,-219,-141,-92,-86,-123,-190,-269,-344,-401,-434,-445,
+    -438,-421,-402,-386,-375,-370,-367,-364,-359,-349,-336,-318,-299,-280,-262,-247,
+    -234,-225,-218,-212,-207,-203,-199,-196,-193,-191,-190,-190,-190,-190,-191,-191,
+    -191,-190,-189,-187,-184,-181,-341,-1011,-1945,-2101,-1097,173,801,730,384,86,
+    -92,-197,-261,-281,-251,-181,-99,-29,14,28,19,0,-20,-30,-28,-13,
+    10,38,63,84,97,104,105,103,101,99,99,101,103,106,108,108,
+    107,105,103,100,98,96,96,96,96,97,99,100,102,103,105,106,
+    108,110,112,114,116,118,119,121,122,123,123,124,124,124,124,124,
+    123,123,122,121,120,119,118,117,116,114,113,112,111,110,108,107,
+    106,105,104,103,101,100,99,98,96,95,94,93,91,90,88,87,
+    85,84,82,80,79,77,75,74,72,70,68,66,65,63,61,59,
+    57,56,54,52,50,48,46,44,42,40,38,35,33,31,29,27,
+    25,24,22,20,18,17,15,13,12,10,9,8,7,6,5,4,
+    3,2,1,1,0,0,-1,-1,-1,-2,-2,-2,-2,-2,-2,-2,
+    -2,-2,-2,-2,-1,-1,-1,-1,-1,-1,0,0,0,0,0,0};
+
+static const int16_t cabinet_ir_2x12[512]={
+    690,3345,6489,6014,1704,-2112,-2999,-2228,-1530,-1256,-1009,-581,-96,268,450,479,
+    407,275,121,-25,-137,-202,-220,-199,-153,-99,-48,-12,6,4,-16,-46,
+    -83,-120,-153,-180,-198,-210,-217,-219,-220,-222,-224,-227,-232,-238,-244,-250,
+    -254,-256,-257,-256,-253,-249,-245,-239,-234,-228,-223,-217,-212,-206,-200,-194,
+    -188,-182,-176,-170,-164,-158,-152,-147,-141,-136,-132,-127,-123,-119,-115,-111,
+    -108,-104,-101,-98,-95,-92,-90,-87,-85,-83,-80,-78,-76,-74,-72,-70,
+    -68,-66,-64,-62,-60,-58,-56,-54,-51,-49,-47,-45,-43,-41,134,800,
+    1588,1472,397,-555,-775,-580,-403,-332,-268,-159,-36,57,105,114,98,68,
+    31,-4,-30,-44,-47,-40,-27,-11,3,14,19,20,17,11,3,-5,
+    -12,-17,-21,-23,-23,-23,-22,-21,-21,-21,-21,-21,-22,-23,-23,-23,
+    -22,-21,-20,-18,-16,-15,-13,-11,-9,-7,-5,-3,-1,0,2,4,
+    6,8,10,11,13,15,16,17,19,20,21,22,23,24,25,26,
+    27,27,28,28,29,29,30,30,31,31,31,31,32,32,32,32,
+    33,33,33,33,33,33,33,33,34,34,34,34,34,34,34,34,
+    34,34,34,34,34,34,-48,-367,-744,-687,-170,288,394,302,218,185,
+    155,104,45,1,-21,-24,-16,0,18,35,49,56,58,55,50,43,
+    36,32,29,29,31,35,39,43,46,49,51,52,53,52,52,52,
+    52,52,52,52,53,53,53,53,53,52,52,51,50,49,48,47,
+    45,44,43,42,41,40,39,38,37,36,34,33,32,31,30,29,
+    28,27,26,26,25,24,23,22,22,21,20,19,19,18,17,17,
+    16,16,15,14,14,13,13,12,12,11,11,10,9,9,8,8,
+    7,7,6,6,5,5,4,4,3,3,2,2,1,1,0,0,
+    -1,-1,-2,-2,-3,-3,-3,-4,-4,-5,-5,-5,-6,-6,-6,-7,
+    -7,-7,-8,-8,-8,-8,-9,-9,-9,-9,-10,-10,-10,-10,-11,-11,
+    -11,-11,-11,-11,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,
+    -12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-12,-11,-11,
+    -11,-11,-11,-11,-11,-10,-10,-10,-10,-10,-10,-9,-9,-9,-9,-9,
+    -8,-8,-8,-8,-8,-7,-7,-7,-7,-7,-6,-6,-6,-6,-6,-5,
+    -5,-5,-5,-5,-4,-4,-4,-4,-4,-4,-3,-3,-3,-3,-3,-3,
+    -2,-2,-2,-2,-2,-2,-2,-2,-2,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+
+static const int16_t cabinet_ir_4x12[1024]={
+    293,1623,3861,5073,3675,529,-2201,-3172,-2490,-1065,237,982,1141,894,464,42,
+    -247,-347,-272,-89,116,266,319,278,172,46,-61,-127,-149,-141,-122,-109,
+    -114,-137,-174,-214,-248,-272,-284,-286,-281,-275,-270,-268,-268,-268,-266,-262,
+    -255,-246,-235,-225,-215,-206,-199,-193,-187,-182,-178,-174,-171,-168,-167,-166,
+    -166,-167,-169,-171,-173,-175,-178,-180,-183,-185,-187,-189,-191,-192,-192,-193,
+    -192,-192,-190,-189,-187,-184,-181,-178,-175,-171,-167,-163,-159,-154,-150,-145,
+    -141,-137,-132,-128,-124,-120,-116,-113,-109,-106,-102,-99,-96,-93,-90,-88,
+    -85,-82,-80,-77,-74,-72,-69,-66,-63,-61,-58,-55,-52,-49,-46,-43,
+    -40,-37,-34,-31,-27,-24,-21,-18,-15,-12,-9,-6,-3,0,3,6,
+    8,11,13,16,18,21,111,512,1186,1552,1134,192,-625,-914,-708,-278,
+    114,339,389,316,189,64,-22,-50,-26,30,93,139,157,146,115,78,
+    48,29,23,27,33,38,37,31,21,10,0,-6,-9,-9,-7,-5,
+    -3,-2,-2,-2,-1,1,3,6,9,12,15,18,20,22,23,25,
+    26,27,28,28,28,28,28,27,26,25,24,23,22,21,20,18,
+    17,16,15,14,13,12,12,11,11,11,11,11,11,11,11,12,
+    12,13,13,14,14,15,15,15,16,16,17,17,17,17,18,18,
+    18,18,18,18,18,18,18,18,17,17,17,17,17,17,17,17,
+    17,17,17,17,17,17,17,17,17,17,17,17,17,17,17,18,
+    18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,
+    18,17,17,17,17,17,17,17,17,16,16,16,16,16,16,16,
+    15,15,15,15,15,-38,-278,-681,-899,-648,-82,410,584,461,205,-30,
+    -164,-193,-149,-72,4,56,74,60,27,-11,-38,-48,-40,-22,1,20,
+    31,35,33,30,27,28,31,38,45,51,55,56,56,55,54,53,
+    52,52,52,51,50,48,47,44,42,40,38,37,35,34,33,32,
+    31,30,29,29,28,28,28,28,28,28,29,29,29,29,29,30,
+    30,30,30,30,30,29,29,29,28,28,27,26,25,25,24,23,
+    22,21,20,19,18,17,16,16,15,14,13,12,11,11,10,9,
+    9,8,7,7,6,6,5,5,4,4,3,3,2,1,1,0,
+    0,-1,-1,-2,-2,-3,-3,-4,-5,-5,-6,-6,-7,-7,-8,-8,
+    -9,-9,-10,-10,-11,-11,-12,-12,-12,-13,-13,-13,-14,-14,-14,-15,
+    -15,-15,-15,-16,-16,-16,-16,-17,-17,-17,-17,-17,-18,-18,-18,-18,
+    -18,-18,-18,-18,-19,-19,-19,-19,-19,-19,-19,-19,-19,-19,-19,-19,
+    -19,-19,-19,-19,-19,-19,-19,-19,-19,-19,-19,-18,-18,-18,-18,-18,
+    -18,-18,-18,-17,-17,-17,-17,-17,-17,-17,-16,-16,-16,-16,-16,-15,
+    -15,-15,-15,-15,-14,-14,-14,-14,-14,-13,-13,-13,-13,-13,-12,-12,
+    -12,-12,-11,-11,-11,-11,-11,-10,-10,-10,-10,-9,-9,-9,-9,-8,
+    -8,-8,-8,-7,-7,-7,-7,-7,-6,-6,-6,-6,-5,-5,-5,-5,
+    -5,-4,-4,-4,-4,-4,-3,-3,-3,-3,-3,-2,-2,-2,-2,-2,
+    -1,-1,-1,-1,-1,-1,0,0,0,0,0,0,1,1,1,1,
+    1,31,164,388,509,369,55,-218,-315,-247,-104,26,101,117,92,49,
+    7,-22,-31,-24,-5,15,30,36,32,21,9,-2,-9,-11,-10,-8,
+    -7,-7,-9,-13,-17,-20,-23,-24,-24,-23,-23,-22,-22,-22,-22,-22,
+    -21,-20,-19,-18,-17,-16,-15,-15,-14,-13,-13,-12,-12,-12,-11,-11,
+    -11,-11,-11,-12,-12,-12,-12,-12,-13,-13,-13,-13,-14,-14,-14,-14,
+    -14,-14,-14,-14,-14,-14,-13,-13,-13,-13,-12,-12,-11,-11,-11,-10,
+    -10,-9,-9,-9,-8,-8,-8,-7,-7,-7,-6,-6,-6,-6,-5,-5,
+    -5,-5,-4,-4,-4,-4,-4,-3,-3,-3,-3,-2,-2,-2,-2,-1,
+    -1,-1,-1,0,0,0,0,1,1,1,1,2,2,2,2,3,
+    3,3,3,3,4,4,4,4,4,4,5,5,5,5,5,5,
+    5,5,6,6,6,6,6,6,6,6,6,6,6,6,7,7,
+    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+    7,7,7,7,7,7,7,7,7,6,6,6,6,6,6,6,
+    6,6,6,6,6,6,6,6,5,5,5,5,5,5,5,5,
+    5,5,5,4,4,4,4,4,4,4,4,4,4,4,3,3,
+    3,3,3,3,3,3,3,3,3,3,2,2,2,2,2,2,
+    2,2,2,2,2,2,2,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+
+const cabinet_ir cabinet_irs[CABINET_IRS] =
+{
+    { "1x12", cabinet_ir_1x12, sizeof(cabinet_ir_1x12)/sizeof(int16_t) },
+    { "2x12", cabinet_ir_2x12, sizeof(cabinet_ir_2x12)/sizeof(int16_t) },
+    { "4x12", cabinet_ir_4x12, sizeof(cabinet_ir_4x12)/sizeof(int16_t) },
+};
@@ -0,0 +1,59 @@
+/* cabinet.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __CABINET_H
+#define __CABINET_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The impulse responses of the Cabinet unit and the fixed point FFT that
+   convolves with their tails.  The sizes and the types shared with the
+   unit's state are in dsp.h, which has to be included first. */
+
+typedef struct
+{
+    const char    *name;
+    const int16_t *taps;
+    uint32_t      length;
+} cabinet_ir;
+
+#define CABINET_IRS 3
+
+extern const cabinet_ir cabinet_irs[CABINET_IRS];
+
+void cabinet_fft(cabinet_complex *x, uint32_t scale_from, bool inverse);
+int32_t cabinet_tail_shift(const cabinet_ir *ir);
+void cabinet_partition(cabinet_bin *h, const cabinet_ir *ir, uint32_t part, int32_t shift, cabinet_complex *work);
+void cabinet_spectrum(cabinet_bin *x, const int16_t *in, uint32_t block, cabinet_complex *work);
+void cabinet_tail(int16_t *out, const cabinet_bin *fdl, uint32_t fdl_pos, const cabinet_bin *h, uint32_t parts,
+                  uint32_t parts_ready, int32_t shift, cabinet_complex *work);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CABINET_H */
@@ -31,31 +31,224 @@
 #include "guitarpico.h"
 #include "waves.h"
 #include "dsp.h"
+#include "dspbench.h"
+#include "cabinet.h"
+#include "dspoverlay.h"
 
-int sample_circ_buf_offset;
-int16_t sample_circ_buf[SAMPLE_CIRC_BUF_SIZE];
 int sample_circ_buf_clean_offset;
 int16_t sample_circ_buf_clean[SAMPLE_CIRC_BUF_SIZE];
 
-dsp_unit dsp_units[MAX_DSP_UNITS];
-dsp_parm dsp_parms[MAX_DSP_UNITS];
-int32_t dsp_unit_result[MAX_DSP_UNITS+1];
+dsp_engine dsp_engines[2];
 
-inline int32_t sine_wave_table(uint n)
+/* The core states and the dispatch tables are read by the audio path for
+   every unit on every sample.  They are kept in scratch_y (SRAM5), which
+   is not striped with the rest of SRAM and which the VGA DMA never reads,
+   so the audio path does not wait on the bus behind the scanlines.  It
+   also holds core 0's stack, so only these 264 bytes are put there; the
+   banks and the crossfade are in main SRAM, where a stack that grows past
+   its 2 kB runs into unused scratch rather than the running settings. */
+dsp_core_state __scratch_y("dsp_cores") dsp_cores[2] = { { dsp_engines[0].unit_result, 0, dsp_engines[0].block_result },
+                                                          { dsp_engines[0].unit_result, 0, dsp_engines[0].block_result } };
+
+/* each unit starts on the alignment of dsp_unit, which is 8 bytes on a
+   64 bit host */
+#define DSP_UNIT_ALIGN _Alignof(dsp_unit)
+
+static uint32_t dsp_arena[DSP_ARENA_SIZE/sizeof(uint32_t)] __attribute__ ((aligned(DSP_UNIT_ALIGN)));
+
+static inline int32_t sine_wave_table(uint n)
 {
-    return table_sine[n & (WAVETABLES_LENGTH-1)];
+    return wavetables[0][n & (WAVETABLES_LENGTH-1)];
 };
 void initialize_sample_circ_buf(void)
 {
-    memset((void *)sample_circ_buf, '\000', sizeof(sample_circ_buf));
-    sample_circ_buf_offset = 0;
     memset((void *)sample_circ_buf_clean, '\000', sizeof(sample_circ_buf_clean));
     sample_circ_buf_clean_offset = 0;
 }
 
-void dsp_unit_struct_zero(dsp_unit *du)
+/* the state of a unit is a whole number of words, its line starts after it */
+static inline uint32_t dsp_unit_state_size(dsp_unit_type dut)
+{
+    return (dsp_type_state_size[dut] + (sizeof(uint32_t)-1)) & ~(sizeof(uint32_t)-1);
+}
+
+void dsp_unit_struct_zero(dsp_unit *du, dsp_unit_type dut)
+{
+    memset((void *)du,'\000',dsp_unit_state_size(dut));
+}
+
+static inline const dsp_coefs *dsp_coefs_current(const dsp_unit *du)
+{
+    return &du->coefs[du->coefs_active];
+}
+
+/* the set the audio path is not using, starting from the one it is */
+static inline dsp_coefs *dsp_coefs_edit(dsp_unit *du)
+{
+    dsp_coefs *dc = &du->coefs[du->coefs_active ^ 1];
+    *dc = du->coefs[du->coefs_active];
+    return dc;
+}
+
+static inline void dsp_coefs_publish(dsp_unit *du)
+{
+    DMB();
+    du->coefs_active ^= 1;
+    DMB();
+}
+
+/**************************** COEFFICIENTS ********************************************/
+
+/* one turn of phase is 2^32, one Hz is 2^32/DSP_SAMPLERATE of a turn */
+#define FIXED_PHASE_PER_HZ ((uint32_t)(((1ull<<32) + DSP_SAMPLERATE/2) / DSP_SAMPLERATE))
+
+/* table_sine_quarter interpolated, in Q24 */
+static int32_t fixed_sin_phase(uint32_t phase)
+{
+    uint32_t quarter = phase & 0x3FFFFFFFu;
+    if (phase & 0x40000000u) quarter = 0x40000000u - quarter;
+    uint32_t index = quarter >> 22;
+    int32_t frac = (quarter >> 6) & 0xFFFF;
+    int32_t s0 = table_sine_quarter[index];
+    int32_t s1 = table_sine_quarter[index + (index < SINE_QUARTER_LENGTH)];
+    int32_t s = s0 + (int32_t)((((int64_t)(s1 - s0)) * frac) >> 16);
+    s = (s + (1 << (29 - FIXED_COEF_BITS))) >> (30 - FIXED_COEF_BITS);
+    return (phase & 0x80000000u) ? -s : s;
+}
+
+int32_t fixed_omega_sin(uint16_t frequency)
+{
+    return fixed_sin_phase(frequency * FIXED_PHASE_PER_HZ);
+}
+
+int32_t fixed_omega_cos(uint16_t frequency)
+{
+    return fixed_sin_phase(frequency * FIXED_PHASE_PER_HZ + (1u << 30));
+}
+
+/* Q = 100 means Q scaled to one */
+int32_t fixed_a_value(int32_t sin_omega, uint16_t Q)
+{
+    return (sin_omega * 50 + Q / 2) / Q;
+}
+
+int32_t fixed_bfpa0_value(int32_t a)
+{
+    uint32_t d = FIXED_COEF_ONE + a;
+    return (int32_t)(((1ull << (FIXED_COEF_BITS + 30)) + d / 2) / d);
+}
+
+int32_t fixed_to_sampled_int(int32_t x, int32_t bfpa0)
+{
+    const uint shift = FIXED_COEF_BITS + 30 - QUANTIZATION_BITS;
+    return (int32_t)((((int64_t)x) * bfpa0 + (1ll << (shift - 1))) >> shift);
+}
+
+/**************************** BIQUAD **************************************************/
+
+/* The filter types share one direct form I biquad.  form is a constant at
+   every call, so each call compiles to the terms of that zero structure
+   only, 3 multiplies for a bandpass or allpass and 4 for a lowpass or
+   highpass instead of 5:
+
+   DSP_BIQUAD_BANDPASS   b0*(x[n]-x[n-2])              - a1*y[n-1] - a2*y[n-2]
+   DSP_BIQUAD_SYMMETRIC  b0*(x[n]+x[n-2]) + b1*x[n-1]  - a1*y[n-1] - a2*y[n-2]
+   DSP_BIQUAD_ALLPASS    a2*(x[n]-y[n-2]) + a1*(x[n-1]-y[n-1]) + b2*x[n-2]
+
+   Coefficients are Q15 (fixed_to_sampled_int) and the output is cut to 16
+   bits.  |a1| is below 2.0 and the others below 1.0, so with x and y
+   within the ADC range (2^13) every product is below 2^30 and the sum
+   cannot overflow.  A resonance that takes y past 2^14 can, as it always
+   could; the Q limit of 9.99 keeps the filters short of that at the input
+   levels the ADC gives. */
+
+static inline __attribute__ ((always_inline)) int32_t dsp_biquad(dsp_biquad_form form, int32_t sample,
+                int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2, dsp_biquad_state *bs)
+{
+    int32_t filtout;
+    switch (form)
+    {
+        case DSP_BIQUAD_BANDPASS:
+            filtout =    b0 * (sample - bs->sampledly2)
+                       - a1 * bs->filtdly1
+                       - a2 * bs->filtdly2;
+            break;
+        case DSP_BIQUAD_SYMMETRIC:
+            filtout =    b0 * (sample + bs->sampledly2)
+                       + b1 * bs->sampledly1
+                       - a1 * bs->filtdly1
+                       - a2 * bs->filtdly2;
+            break;
+        default:
+            filtout =    a2 * (sample - bs->filtdly2)
+                       + a1 * (bs->sampledly1 - bs->filtdly1)
+                       + b2 * bs->sampledly2;
+            break;
+    }
+    filtout = fractional_int_remove_offset(filtout);
+    bs->sampledly2 = bs->sampledly1;
+    bs->sampledly1 = sample;
+    bs->filtdly2 = bs->filtdly1;
+    bs->filtdly1 = filtout;
+    return filtout;
+}
+
+/* the state is kept in locals over the block and stored once */
+static inline __attribute__ ((always_inline)) void dsp_biquad_block(dsp_biquad_form form, int32_t *out, const int32_t *in, uint n,
+                int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2, dsp_biquad_state *bs)
+{
+    dsp_biquad_state s = *bs;
+    for (uint i=0;i<n;i++)
+        out[i] = dsp_biquad(form, in[i], b0, b1, b2, a1, a2, &s);
+    *bs = s;
+}
+
+/**************************** SWEEP **************************************************/
+
+/* Builds the sweep table that is not active for freq1 to freq2 and
+   switches to it.  The allpass coefficients are scaled by 0.999 to keep
+   the poles of the phaser stages inside the unit circle. */
+static void dsp_sweep_build(dsp_sweep *sw, dsp_biquad_form form, uint16_t freq1, uint16_t freq2, uint16_t Q)
+{
+    dsp_sweep_entry *e = sw->entry[sw->active ^ 1];
+    if (freq1 > freq2)
+    {
+        uint16_t temp = freq1;
+        freq1 = freq2;
+        freq2 = temp;
+    }
+    for (uint i=0;i<DSP_SWEEP_ENTRIES;i++)
+    {
+        uint16_t frequency = freq1 + (((uint32_t)(freq2 - freq1)) * i + (DSP_SWEEP_ENTRIES - 1) / 2) / (DSP_SWEEP_ENTRIES - 1);
+        int32_t c0 = fixed_omega_cos(frequency);
+        int32_t a = fixed_a_value(fixed_omega_sin(frequency), Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        if (form == DSP_BIQUAD_ALLPASS) bfpa0 -= bfpa0 / 1000;
+        e[i].b0 = fixed_to_sampled_int(a, bfpa0);
+        e[i].a1 = fixed_to_sampled_int(-2*c0, bfpa0);
+        e[i].a2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+    }
+    DMB();
+    sw->active ^= 1;
+    DMB();
+}
+
+/* the coefficients at pos, from 0 at the lower frequency to
+   QUANTIZATION_MAX at the higher */
+static inline void dsp_sweep_value(const dsp_sweep *sw, uint32_t pos, dsp_sweep_entry *e)
 {
-    memset((void *)du,'\000',sizeof(dsp_unit));
+    const dsp_sweep_entry *t = sw->entry[sw->active];
+    uint32_t p = pos * (DSP_SWEEP_ENTRIES - 1);
+    uint32_t i = p >> QUANTIZATION_BITS;
+    if (i >= (DSP_SWEEP_ENTRIES - 1))
+    {
+        *e = t[DSP_SWEEP_ENTRIES - 1];
+        return;
+    }
+    int32_t frac = p & (QUANTIZATION_MAX - 1);
+    e->b0 = t[i].b0 + (((t[i+1].b0 - t[i].b0) * frac) >> QUANTIZATION_BITS);
+    e->a1 = t[i].a1 + (((t[i+1].a1 - t[i].a1) * frac) >> QUANTIZATION_BITS);
+    e->a2 = t[i].a2 + (((t[i+1].a2 - t[i].a2) * frac) >> QUANTIZATION_BITS);
 }
 
 /**************************** DSP_TYPE_NONE **************************************************/
@@ -65,6 +258,11 @@ int32_t dsp_type_process_none(int32_t sample, dsp_parm *dp, dsp_unit *du)
     return sample;
 }
 
+void dsp_type_process_none_block(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du)
+{
+    memcpy((void *)out, (const void *)in, n*sizeof(int32_t));
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_none[] = 
 {
     { "SourceUnit",  offsetof(dsp_parm_none,source_unit),        4, 2, 1, MAX_DSP_UNITS, NULL },
@@ -75,7 +273,7 @@ const dsp_parm_none dsp_parm_none_default = { 0, 0 };
 
 /******************************DSP_TYPE_SINE_SYNTH*******************************************/
 
-int32_t dsp_type_process_sin_synth(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_sin_synth(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtss.control_number1);
     if (abs(new_input - du->dtss.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -104,6 +302,10 @@ int32_t dsp_type_process_sin_synth(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtss.last_frequency[2] = dp->dtss.frequency[2];
         du->dtss.sine_counter_inc[2] = (du->dtss.last_frequency[2]*65536) / DSP_SAMPLERATE;
     }
+}
+
+int32_t dsp_type_process_sin_synth(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     uint ct = 1;
     int32_t sine_val = sample * ((int32_t)dp->dtss.mixval);
     for (uint i=0;i<(sizeof(du->dtss.sine_counter)/sizeof(du->dtss.sine_counter[0]));i++)
@@ -143,7 +345,7 @@ const dsp_parm_sine_synth dsp_parm_sine_synth_default = { 0, 0, 255, { 300, 300,
 
 /************************************DSP_TYPE_NOISEGATE**********************************/
 
-int32_t dsp_type_process_noisegate(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_noisegate(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtnoise.control_number1);
     if (abs(new_input - du->dtnoise.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -151,7 +353,10 @@ int32_t dsp_type_process_noisegate(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtnoise.pot_value1 = new_input;
         dp->dtnoise.threshold = (du->dtnoise.pot_value1 * (ADC_PREC_VALUE/2)) / (POT_MAX_VALUE*16);
     }
-    
+}
+
+int32_t dsp_type_process_noisegate(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     uint32_t envfilt;
     uint32_t abssample = sample < 0 ? -sample : sample;
     switch (dp->dtnoise.response)
@@ -180,9 +385,138 @@ const dsp_parm_configuration_entry dsp_parm_configuration_entry_noisegate[] =
 
 const dsp_parm_noisegate dsp_parm_noisegate_default = { 0, 0, 30, 3, 0  };
 
+/************************************ADPCM LINE*************************************/
+
+const int16_t dsp_adpcm_step_table[DSP_ADPCM_STEPS] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+
+const int8_t dsp_adpcm_index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+void dsp_adpcm_line_init(dsp_adpcm_line *al, void *mem, uint32_t bytes)
+{
+    memset((void *)al, '\000', sizeof(dsp_adpcm_line));
+    al->blocks = (dsp_adpcm_block *)mem;
+    al->size = (bytes / sizeof(dsp_adpcm_block)) * DSP_ADPCM_BLOCK_SAMPLES;
+    /* so that the first sample starts a block and writes its header */
+    al->pos = al->size - 1;
+    al->read_pos = al->size;
+}
+
+/* decodes from the start of the block of sample p up to p */
+void dsp_adpcm_seek(dsp_adpcm_line *al, uint32_t p)
+{
+    const dsp_adpcm_block *b = &al->blocks[p / DSP_ADPCM_BLOCK_SAMPLES];
+    al->decoder.predictor = b->predictor;
+    al->decoder.step_index = b->step_index;
+    for (uint32_t q=p & ~(DSP_ADPCM_BLOCK_SAMPLES-1);q<p;q++)
+        dsp_adpcm_decode(&al->decoder, dsp_adpcm_code(al, q));
+}
+
+/************************************OVERSAMPLING*************************************/
+
+/* the taps either side of the center of the interpolators, from
+   firhalfband(4,15,1.0,3) and firhalfband(2,15,1.0,1).  The center tap is
+   2^15 and each side sums to 2^14, the decimators take half of that. */
+static const dsp_halfband dsp_halfband_1x = { 4, { 19689, -3999, 716, -22 } };
+static const dsp_halfband dsp_halfband_2x = { 2, { 19009, -2625 } };
+
+uint32_t dsp_oversample_cost[DSP_OVERSAMPLE_RATIOS];
+
+/* two samples at twice the rate, the first half way between the inputs
+   pairs and pairs-1 back, the second the input pairs-1 back */
+static void dsp_halfband_up(dsp_halfband_state *hs, const dsp_halfband *hb, int32_t sample, int32_t *out)
+{
+    uint32_t pairs = hb->pairs;
+    int32_t acc = 1 << 14;
+    for (uint32_t i=pairs*2-1;i>0;i--) hs->up[i] = hs->up[i-1];
+    hs->up[0] = sample;
+    for (uint32_t k=0;k<pairs;k++)
+        acc += hb->coefs[k] * (hs->up[pairs-1-k] + hs->up[pairs+k]);
+    out[0] = acc >> 15;
+    out[1] = hs->up[pairs-1];
+}
+
+/* one sample from two at twice the rate, the first of which is in phase
+   with the center tap */
+static int32_t dsp_halfband_down(dsp_halfband_state *hs, const dsp_halfband *hb, const int32_t *in)
+{
+    uint32_t pairs = hb->pairs;
+    int32_t acc = 1 << 15;
+    for (uint32_t i=pairs*2-1;i>0;i--) hs->even[i] = hs->even[i-1];
+    for (uint32_t i=pairs-1;i>0;i--) hs->odd[i] = hs->odd[i-1];
+    hs->odd[0] = in[0];
+    hs->even[0] = in[1];
+    acc += ((int32_t)hs->odd[pairs-1]) * 32768;
+    for (uint32_t k=0;k<pairs;k++)
+        acc += hb->coefs[k] * (hs->even[pairs-1-k] + hs->even[pairs+k]);
+    return acc >> 16;
+}
+
+/* ratio samples from one, oldest first */
+void __not_in_flash_func(dsp_oversample_up)(dsp_oversample_state *os, uint32_t ratio, int32_t sample, int32_t *out)
+{
+    int32_t mid[2];
+
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    switch (ratio)
+    {
+        case 2: dsp_halfband_up(&os->stage[0], &dsp_halfband_1x, sample, out);
+                break;
+        case 4: dsp_halfband_up(&os->stage[0], &dsp_halfband_1x, sample, mid);
+                dsp_halfband_up(&os->stage[1], &dsp_halfband_2x, mid[0], &out[0]);
+                dsp_halfband_up(&os->stage[1], &dsp_halfband_2x, mid[1], &out[2]);
+                break;
+        default: out[0] = sample;
+                break;
+    }
+}
+
+/* one sample from ratio, which must be within the range of the samples */
+int32_t __not_in_flash_func(dsp_oversample_down)(dsp_oversample_state *os, uint32_t ratio, const int32_t *in)
+{
+    int32_t mid[2];
+
+    switch (ratio)
+    {
+        case 2: return dsp_halfband_down(&os->stage[0], &dsp_halfband_1x, in);
+        case 4: mid[0] = dsp_halfband_down(&os->stage[1], &dsp_halfband_2x, &in[0]);
+                mid[1] = dsp_halfband_down(&os->stage[1], &dsp_halfband_2x, &in[2]);
+                return dsp_halfband_down(&os->stage[0], &dsp_halfband_1x, mid);
+        default: return in[0];
+    }
+}
+
+/* A unit's curve run at the rate of its Oversample parameter.  At 1x it
+   is the curve on its own. */
+static inline int32_t dsp_oversample_process(dsp_oversample_state *os, uint32_t oversample, int32_t sample,
+                                             dsp_type_process *curve, dsp_parm *dp, dsp_unit *du)
+{
+    int32_t s[DSP_OVERSAMPLE_MAX];
+    uint32_t ratio = dsp_oversample_ratio(oversample);
+
+    if (ratio == 1) return curve(sample, dp, du);
+    dsp_oversample_up(os, ratio, sample, s);
+    for (uint32_t i=0;i<ratio;i++)
+        s[i] = curve(s[i], dp, du);
+    return dsp_oversample_down(os, ratio, s);
+}
+
 /************************************DSP_TYPE_DELAY*************************************/
 
-int32_t dsp_type_process_delay(int32_t sample, dsp_parm *dp, dsp_unit *du)
+/* delays longer than a 16 bit line of SAMPLE_CIRC_BUF_SIZE are kept as
+   ADPCM, a delay set by a control always has a 16 bit line */
+static inline bool dsp_type_delay_adpcm(const dsp_parm *dp)
+{
+    return (dp->dtd.control_number1 == 0) && (dp->dtd.delay_samples > SAMPLE_CIRC_BUF_SIZE);
+}
+
+void dsp_type_control_delay(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtd.control_number1);
     if (abs(new_input - du->dtd.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -196,15 +530,49 @@ int32_t dsp_type_process_delay(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtd.pot_value2 = new_input;
         dp->dtd.echo_reduction = (du->dtd.pot_value2 * 256) / POT_MAX_VALUE;
     }
-    sample = (sample + ((sample_circ_buf_value(dp->dtd.delay_samples) * ((int16_t)dp->dtd.echo_reduction)) / 256)) / 2;
+}
+
+/* the line memory is the same for both kinds of line, so whichever one
+   the unit was last running is started again if the kind changes */
+static void dsp_type_delay_line_start(dsp_unit *du, bool adpcm)
+{
+    du->line.pos = 0;
+    du->line.fill = 0;
+    if (adpcm)
+        dsp_adpcm_line_init(&du->dtd.adpcm, du->line.samples, du->line.size * sizeof(int16_t));
+    else
+        du->dtd.adpcm.blocks = NULL;
+}
+
+int32_t dsp_type_process_delay(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    bool adpcm = dsp_type_delay_adpcm(dp);
+    if (adpcm != (du->dtd.adpcm.blocks != NULL)) dsp_type_delay_line_start(du, adpcm);
+    int32_t echo = adpcm ? dsp_adpcm_value(&du->dtd.adpcm, dp->dtd.delay_samples) : dsp_line_value(&du->line, dp->dtd.delay_samples);
+    sample = (sample + ((echo * ((int16_t)dp->dtd.echo_reduction)) / 256)) / 2;
     if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
     if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    if (adpcm)
+        dsp_adpcm_insert(&du->dtd.adpcm, sample);
+    else
+        dsp_line_insert(&du->line, sample);
     return sample;
 }
 
+/* the echoes are of the unit's own output, a control can set any length */
+uint32_t dsp_type_line_delay(const dsp_parm *dp)
+{
+    if (dsp_type_delay_adpcm(dp))
+        return dsp_adpcm_line_bytes(dp->dtd.delay_samples) / sizeof(int16_t);
+    uint32_t samples = dp->dtd.delay_samples;
+    if ((dp->dtd.control_number1 != 0) && (samples < SAMPLE_CIRC_BUF_SIZE))
+        samples = SAMPLE_CIRC_BUF_SIZE;
+    return samples + 1;
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_delay[] = 
 {
-    { "Samples",    offsetof(dsp_parm_delay,delay_samples),   4, 5, 1, SAMPLE_CIRC_BUF_SIZE, NULL },
+    { "Samples",    offsetof(dsp_parm_delay,delay_samples),   4, 6, 1, DSP_DELAY_ADPCM_MAX, NULL },
     { "EchoRed",    offsetof(dsp_parm_delay,echo_reduction),  4, 3, 0, 255, NULL },
     { "SampCtrl",   offsetof(dsp_parm_delay,control_number1), 4, 2, 0, POTENTIOMETER_MAX, "DlySamp" },
     { "EchoCtrl",   offsetof(dsp_parm_delay,control_number2), 4, 2, 0, POTENTIOMETER_MAX, "DlyEcho" },
@@ -256,6 +624,7 @@ const dsp_parm_room dsp_parm_room_default = { 0, 0, { 2500, 0, 0, }, {255, 0, 0
 
 int32_t dsp_type_process_combine(int32_t sample, dsp_parm *dp, dsp_unit *du)
 {
+    const int32_t *unit_result = dsp_core()->unit_result;
     int count = 0;
     if (dp->dtcombine.prev_amplitude > 0)
     {
@@ -267,9 +636,9 @@ int32_t dsp_type_process_combine(int32_t sample, dsp_parm *dp, dsp_unit *du)
         if (dp->dtcombine.amplitude[i] != 0)
         {
             if (dp->dtcombine.signbit[i] != 0)
-                sample -= dsp_unit_result[dp->dtcombine.unit[i]-1] * dp->dtcombine.amplitude[i];
+                sample -= unit_result[dp->dtcombine.unit[i]-1] * dp->dtcombine.amplitude[i];
             else
-                sample += dsp_unit_result[dp->dtcombine.unit[i]-1] * dp->dtcombine.amplitude[i];
+                sample += unit_result[dp->dtcombine.unit[i]-1] * dp->dtcombine.amplitude[i];
             count++;
         }
     }
@@ -283,6 +652,21 @@ int32_t dsp_type_process_combine(int32_t sample, dsp_parm *dp, dsp_unit *du)
     return sample;
 }
 
+/* Combine reads other units' results through the core's unit_result, so
+   those are filled in from the block results one sample at a time */
+void dsp_type_process_combine_block(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du)
+{
+    int32_t *unit_result = dsp_core()->unit_result;
+    int32_t (*block_result)[DSP_BLOCK_MAX] = dsp_core()->block_result;
+    for (uint i=0;i<n;i++)
+    {
+        for (int j=0;j<(sizeof(dp->dtcombine.unit)/sizeof(dp->dtcombine.unit[0]));j++)
+            if (dp->dtcombine.amplitude[j] != 0)
+                unit_result[dp->dtcombine.unit[j]-1] = block_result[dp->dtcombine.unit[j]-1][i];
+        out[i] = dsp_type_process_combine(in[i], dp, du);
+    }
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_combine[] = 
 {
     { "Ampltiude",   offsetof(dsp_parm_combine,prev_amplitude),     4, 3, 0, 255, NULL },
@@ -303,9 +687,8 @@ const dsp_parm_combine dsp_parm_combine_default = { 0, 0, 255, { 2, 3, 4, }, {0,
 
 /************************************DSP_TYPE_BANDPASS*************************************/
 
-int32_t dsp_type_process_bandpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_bandpass(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
     uint32_t new_input = read_potentiometer_value(dp->dtbp.control_number1);
     if (abs(new_input - du->dtbp.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
@@ -316,22 +699,26 @@ int32_t dsp_type_process_bandpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
     {
         du->dtbp.last_frequency = dp->dtbp.frequency;
         du->dtbp.last_Q = dp->dtbp.Q;
-        float w0 = nyquist_fraction_omega(du->dtbp.last_frequency);
-        float a = float_a_value(w0,du->dtbp.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtbp.filtb0 = float_to_sampled_int(a * bfpa0);
-        du->dtbp.filta1 = float_to_sampled_int(-2.0f*cosf(w0)*bfpa0);
-        du->dtbp.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
-    }
-    filtout =    ((int32_t)du->dtbp.filtb0) * ((int32_t)sample - (int32_t)du->dtbp.sampledly2)
-               - ((int32_t)du->dtbp.filta1) * ((int32_t)du->dtbp.filtdly1)
-               - ((int32_t)du->dtbp.filta2) * ((int32_t)du->dtbp.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtbp.sampledly2 = du->dtbp.sampledly1;
-    du->dtbp.sampledly1 = sample;
-    du->dtbp.filtdly2 = du->dtbp.filtdly1;
-    du->dtbp.filtdly1 = filtout;
-    return filtout;
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        int32_t a = fixed_a_value(fixed_omega_sin(du->dtbp.last_frequency), du->dtbp.last_Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        bq->filtb0 = fixed_to_sampled_int(a, bfpa0);
+        bq->filta1 = fixed_to_sampled_int(-2*fixed_omega_cos(du->dtbp.last_frequency), bfpa0);
+        bq->filta2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_bandpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    return dsp_biquad(DSP_BIQUAD_BANDPASS, sample, bq->filtb0, 0, 0, bq->filta1, bq->filta2, &du->dtbp.bs);
+}
+
+void dsp_type_process_bandpass_block(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    dsp_biquad_block(DSP_BIQUAD_BANDPASS, out, in, n, bq->filtb0, 0, 0, bq->filta1, bq->filta2, &du->dtbp.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_bandpass[] = 
@@ -347,9 +734,8 @@ const dsp_parm_bandpass dsp_parm_bandpass_default = {0, 0, 400, 100, 0 };
 
 /************************************DSP_TYPE_LOWPASS*************************************/
 
-int32_t dsp_type_process_lowpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_lowpass(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
     uint32_t new_input = read_potentiometer_value(dp->dtlp.control_number1);
     if (abs(new_input - du->dtlp.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
@@ -360,25 +746,28 @@ int32_t dsp_type_process_lowpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
     {
         du->dtlp.last_frequency = dp->dtlp.frequency;
         du->dtlp.last_Q = dp->dtlp.Q;
-        float w0 = nyquist_fraction_omega(du->dtlp.last_frequency);
-        float c0 = cosf(w0);
-        float a = float_a_value(w0,du->dtlp.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtlp.filtb1 = float_to_sampled_int((1.0f-c0)*bfpa0);
-        du->dtlp.filtb0 = float_to_sampled_int(0.5*(1.0f-c0)*bfpa0);
-        du->dtlp.filta1 = float_to_sampled_int(-2.0f*c0*bfpa0);
-        du->dtlp.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
-    }
-    filtout =    ((int32_t)du->dtlp.filtb0) * ((int32_t)sample + (int32_t)du->dtlp.sampledly2)
-               + ((int32_t)du->dtlp.filtb1) * ((int32_t)du->dtlp.sampledly1)  
-               - ((int32_t)du->dtlp.filta1) * ((int32_t)du->dtlp.filtdly1)
-               - ((int32_t)du->dtlp.filta2) * ((int32_t)du->dtlp.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtlp.sampledly2 = du->dtlp.sampledly1;
-    du->dtlp.sampledly1 = sample;
-    du->dtlp.filtdly2 = du->dtlp.filtdly1;
-    du->dtlp.filtdly1 = filtout;
-    return filtout;
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        int32_t c0 = fixed_omega_cos(du->dtlp.last_frequency);
+        int32_t a = fixed_a_value(fixed_omega_sin(du->dtlp.last_frequency), du->dtlp.last_Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        bq->filtb1 = fixed_to_sampled_int(FIXED_COEF_ONE - c0, bfpa0);
+        bq->filtb0 = fixed_to_sampled_int((FIXED_COEF_ONE - c0) / 2, bfpa0);
+        bq->filta1 = fixed_to_sampled_int(-2*c0, bfpa0);
+        bq->filta2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_lowpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    return dsp_biquad(DSP_BIQUAD_SYMMETRIC, sample, bq->filtb0, bq->filtb1, 0, bq->filta1, bq->filta2, &du->dtlp.bs);
+}
+
+void dsp_type_process_lowpass_block(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    dsp_biquad_block(DSP_BIQUAD_SYMMETRIC, out, in, n, bq->filtb0, bq->filtb1, 0, bq->filta1, bq->filta2, &du->dtlp.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_lowpass[] = 
@@ -394,9 +783,8 @@ const dsp_parm_lowpass dsp_parm_lowpass_default = {0, 0, 400, 100, 0 };
 
 /************************************DSP_TYPE_HIGHPASS*************************************/
 
-int32_t dsp_type_process_highpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_highpass(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
     uint32_t new_input = read_potentiometer_value(dp->dthp.control_number1);
     if (abs(new_input - du->dthp.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
@@ -407,25 +795,28 @@ int32_t dsp_type_process_highpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
     {
         du->dthp.last_frequency = dp->dthp.frequency;
         du->dthp.last_Q = dp->dthp.Q;
-        float w0 = nyquist_fraction_omega(du->dthp.last_frequency);
-        float c0 = cosf(w0);
-        float a = float_a_value(w0,du->dthp.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dthp.filtb1 = float_to_sampled_int(-(1.0f+c0)*bfpa0);
-        du->dthp.filtb0 = float_to_sampled_int(0.5*(1.0f+c0)*bfpa0);
-        du->dthp.filta1 = float_to_sampled_int(-2.0f*c0*bfpa0);
-        du->dthp.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
-    }
-    filtout =    ((int32_t)du->dthp.filtb0) * ((int32_t)sample + (int32_t)du->dthp.sampledly2)
-               + ((int32_t)du->dthp.filtb1) * ((int32_t)du->dthp.sampledly1)  
-               - ((int32_t)du->dthp.filta1) * ((int32_t)du->dthp.filtdly1)
-               - ((int32_t)du->dthp.filta2) * ((int32_t)du->dthp.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dthp.sampledly2 = du->dthp.sampledly1;
-    du->dthp.sampledly1 = sample;
-    du->dthp.filtdly2 = du->dthp.filtdly1;
-    du->dthp.filtdly1 = filtout;
-    return filtout;
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        int32_t c0 = fixed_omega_cos(du->dthp.last_frequency);
+        int32_t a = fixed_a_value(fixed_omega_sin(du->dthp.last_frequency), du->dthp.last_Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        bq->filtb1 = fixed_to_sampled_int(-(FIXED_COEF_ONE + c0), bfpa0);
+        bq->filtb0 = fixed_to_sampled_int((FIXED_COEF_ONE + c0) / 2, bfpa0);
+        bq->filta1 = fixed_to_sampled_int(-2*c0, bfpa0);
+        bq->filta2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_highpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    return dsp_biquad(DSP_BIQUAD_SYMMETRIC, sample, bq->filtb0, bq->filtb1, 0, bq->filta1, bq->filta2, &du->dthp.bs);
+}
+
+void dsp_type_process_highpass_block(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    dsp_biquad_block(DSP_BIQUAD_SYMMETRIC, out, in, n, bq->filtb0, bq->filtb1, 0, bq->filta1, bq->filta2, &du->dthp.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_highpass[] = 
@@ -441,9 +832,8 @@ const dsp_parm_highpass dsp_parm_highpass_default = {0, 0, 400, 100, 0 };
 
 /************************************DSP_TYPE_ALLPASS*************************************/
 
-int32_t dsp_type_process_allpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_allpass(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
     uint32_t new_input = read_potentiometer_value(dp->dtap.control_number1);
     if (abs(new_input - du->dtap.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
@@ -454,21 +844,19 @@ int32_t dsp_type_process_allpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
     {
         du->dtap.last_frequency = dp->dtap.frequency;
         du->dtap.last_Q = dp->dtap.Q;
-        float w0 = nyquist_fraction_omega(du->dtap.last_frequency);
-        float a = float_a_value(w0,du->dtap.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtap.filta1 = float_to_sampled_int(-2.0f*cosf(w0)*bfpa0);
-        du->dtap.filta2 = float_to_sampled_int((1.0f-a) * bfpa0);
-    }
-    filtout =    ((int32_t)du->dtap.filta2) * ((int32_t)sample - (int32_t)du->dtap.filtdly2)
-               + ((int32_t)du->dtap.filta1) * ((int32_t)du->dtap.sampledly1 - (int32_t)du->dtap.filtdly1)
-               + ((int32_t)du->dtap.sampledly2) * float_to_sampled_int(1.0f);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtap.sampledly2 = du->dtap.sampledly1;
-    du->dtap.sampledly1 = sample;
-    du->dtap.filtdly2 = du->dtap.filtdly1;
-    du->dtap.filtdly1 = filtout;
-    return filtout;
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        int32_t a = fixed_a_value(fixed_omega_sin(du->dtap.last_frequency), du->dtap.last_Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        bq->filta1 = fixed_to_sampled_int(-2*fixed_omega_cos(du->dtap.last_frequency), bfpa0);
+        bq->filta2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_allpass(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    return dsp_biquad(DSP_BIQUAD_ALLPASS, sample, 0, 0, QUANTIZATION_MAX, bq->filta1, bq->filta2, &du->dtap.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_allpass[] = 
@@ -484,7 +872,7 @@ const dsp_parm_allpass dsp_parm_allpass_default = {0, 0, 400, 100, 0 };
 
 /************************************DSP_TYPE_TREMOLO*************************************/
 
-int32_t dsp_type_process_tremolo(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_tremolo(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dttrem.control_number1);
     if (abs(new_input - du->dttrem.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -503,6 +891,10 @@ int32_t dsp_type_process_tremolo(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dttrem.last_frequency = dp->dttrem.frequency;
         du->dttrem.sine_counter_inc = (du->dttrem.last_frequency*65536) / DSP_SAMPLERATE;
     }
+}
+
+int32_t dsp_type_process_tremolo(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dttrem.sine_counter += du->dttrem.sine_counter_inc;
     int32_t sine_val = sine_wave_table((du->dttrem.sine_counter & 0xFFFF) / (65536/WAVETABLES_LENGTH));
     int32_t mod_val = ((sine_val * dp->dttrem.modulation) + QUANTIZATION_MAX * 256) / 512;
@@ -524,7 +916,7 @@ const dsp_parm_tremolo dsp_parm_tremolo_default = { 0, 0, 6, 128, 0, 0  };
 
 /************************************DSP_TYPE_VIBRATO*************************************/
 
-int32_t dsp_type_process_vibrato(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_vibrato(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtvibr.control_number1);
     if (abs(new_input - du->dtvibr.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -543,6 +935,10 @@ int32_t dsp_type_process_vibrato(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtvibr.last_frequency = dp->dtvibr.frequency;
         du->dtvibr.sine_counter_inc = (du->dtvibr.last_frequency*65536) / DSP_SAMPLERATE;
     }
+}
+
+int32_t dsp_type_process_vibrato(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dtvibr.sine_counter += du->dtvibr.sine_counter_inc;
     int32_t sine_val = sine_wave_table((du->dtvibr.sine_counter & 0xFFFF) / (65536 / WAVETABLES_LENGTH));
     int32_t mod_val = ((sine_val * dp->dtvibr.modulation) + QUANTIZATION_MAX * 256) / 512;
@@ -569,46 +965,42 @@ const dsp_parm_vibrato dsp_parm_vibrato_default = { 0, 0, 40, 6, 128, 0, 0 };
 
 /************************************DSP_TYPE_WAH*************************************/
 
-int32_t dsp_type_process_wah(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_wah(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
+    bool changed = false;
     if ((dp->dtwah.freq1 != du->dtwah.last_freq1) || (dp->dtwah.freq2 != du->dtwah.last_freq2) || (dp->dtwah.Q != du->dtwah.last_Q))
     {
         du->dtwah.last_freq1 = dp->dtwah.freq1;
         du->dtwah.last_freq2 = dp->dtwah.freq2;
         du->dtwah.last_Q = dp->dtwah.Q;
-        float w1 = nyquist_fraction_omega(du->dtwah.last_freq1);
-        float w2 = nyquist_fraction_omega(du->dtwah.last_freq2);
-        if (w1 > w2)
-        {
-            float temp = w1;
-            w1 = w2;
-            w2 = temp;
-        }
-        float a = float_a_value(w2, du->dtwah.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtwah.filtb0 = float_to_sampled_int(a * bfpa0);
-        du->dtwah.filta1_interp1 = du->dtwah.filta1 = float_to_sampled_int(-2.0f*cosf(w1)*bfpa0);
-        du->dtwah.filta1_interp2 = float_to_sampled_int(-2.0f*cosf(w2)*bfpa0);
-        du->dtwah.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
+        dsp_sweep_build(&du->dtwah.sweep, DSP_BIQUAD_BANDPASS, du->dtwah.last_freq1, du->dtwah.last_freq2, du->dtwah.last_Q);
+        changed = true;
     }
     uint32_t new_input = read_potentiometer_value(dp->dtwah.control_number1);
     if (abs(new_input - du->dtwah.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
         du->dtwah.pot_value1 = new_input;
-        int32_t sine_val = sine_wave_table(new_input / (POT_MAX_VALUE / (WAVETABLES_LENGTH / 4)));
-        du->dtwah.filta1 = du->dtwah.filta1_interp1 + ((du->dtwah.filta1_interp2 - du->dtwah.filta1_interp1) * 
-                            (dp->dtwah.reverse ? sine_val : (QUANTIZATION_MAX - 1) - sine_val) / QUANTIZATION_MAX);
+        changed = true;
     }
-    filtout =    ((int32_t)du->dtwah.filtb0) * ((int32_t)sample - (int32_t)du->dtwah.sampledly2)
-               - ((int32_t)du->dtwah.filta1) * ((int32_t)du->dtwah.filtdly1)
-               - ((int32_t)du->dtwah.filta2) * ((int32_t)du->dtwah.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtwah.sampledly2 = du->dtwah.sampledly1;
-    du->dtwah.sampledly1 = sample;
-    du->dtwah.filtdly2 = du->dtwah.filtdly1;
-    du->dtwah.filtdly1 = filtout;
-    return filtout;
+    if (changed)
+    {
+        /* the pedal only moves at the control rate, so the coefficients
+           are looked up here rather than for every sample */
+        int32_t sine_val = sine_wave_table(du->dtwah.pot_value1 / (POT_MAX_VALUE / (WAVETABLES_LENGTH / 4)));
+        dsp_sweep_entry e;
+        dsp_sweep_value(&du->dtwah.sweep, dp->dtwah.reverse ? sine_val : (QUANTIZATION_MAX - 1) - sine_val, &e);
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        bq->filtb0 = e.b0;
+        bq->filta1 = e.a1;
+        bq->filta2 = e.a2;
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_wah(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    return dsp_biquad(DSP_BIQUAD_BANDPASS, sample, bq->filtb0, 0, 0, bq->filta1, bq->filta2, &du->dtwah.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_wah[] = 
@@ -626,9 +1018,8 @@ const dsp_parm_wah dsp_parm_wah_default = { 0, 0, 200, 900, 400, 0, 24 };
 
 /************************************DSP_TYPE_AUTOWAH*************************************/
 
-int32_t dsp_type_process_autowah(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_autowah(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
     uint32_t new_input = read_potentiometer_value(dp->dtautowah.control_number1);
     if (abs(new_input - du->dtautowah.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
     {
@@ -645,37 +1036,18 @@ int32_t dsp_type_process_autowah(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtautowah.last_freq1 = dp->dtautowah.freq1;
         du->dtautowah.last_freq2 = dp->dtautowah.freq2;
         du->dtautowah.last_Q = dp->dtautowah.Q;
-        float w1 = nyquist_fraction_omega(du->dtautowah.last_freq1);
-        float w2 = nyquist_fraction_omega(du->dtautowah.last_freq2);
-        if (w1 > w2)
-        {
-            float temp = w1;
-            w1 = w2;
-            w2 = temp;
-        }
-        float a = float_a_value(w2, du->dtautowah.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtautowah.filtb0 = float_to_sampled_int(a * bfpa0);
-        du->dtautowah.filta1_interp1 = du->dtautowah.filta1 = float_to_sampled_int(-2.0f*cosf(w1)*bfpa0);
-        du->dtautowah.filta1_interp2 = float_to_sampled_int(-2.0f*cosf(w2)*bfpa0);
-        du->dtautowah.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
+        dsp_sweep_build(&du->dtautowah.sweep, DSP_BIQUAD_BANDPASS, du->dtautowah.last_freq1, du->dtautowah.last_freq2, du->dtautowah.last_Q);
     }
+}
+
+int32_t dsp_type_process_autowah(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_sweep_entry e;
 
     du->dtautowah.sine_counter += du->dtautowah.sine_counter_inc;
     int32_t sine_val = (QUANTIZATION_MAX - 1) - abs(sine_wave_table((du->dtautowah.sine_counter & 0xFFFF0) / (0xFFFF0 / WAVETABLES_LENGTH)));
-    
-    du->dtautowah.filta1 = du->dtautowah.filta1_interp1 + ((du->dtautowah.filta1_interp2 - du->dtautowah.filta1_interp1) * 
-                            sine_val) / QUANTIZATION_MAX;
- 
-    filtout =    ((int32_t)du->dtautowah.filtb0) * ((int32_t)sample - (int32_t)du->dtautowah.sampledly2)
-               - ((int32_t)du->dtautowah.filta1) * ((int32_t)du->dtautowah.filtdly1)
-               - ((int32_t)du->dtautowah.filta2) * ((int32_t)du->dtautowah.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtautowah.sampledly2 = du->dtautowah.sampledly1;
-    du->dtautowah.sampledly1 = sample;
-    du->dtautowah.filtdly2 = du->dtautowah.filtdly1;
-    du->dtautowah.filtdly1 = filtout;
-    return filtout;
+    dsp_sweep_value(&du->dtautowah.sweep, sine_val, &e);
+    return dsp_biquad(DSP_BIQUAD_BANDPASS, sample, e.b0, 0, 0, e.a1, e.a2, &du->dtautowah.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_autowah[] = 
@@ -693,31 +1065,20 @@ const dsp_parm_autowah dsp_parm_autowah_default = { 0, 0, 200, 900, 400, 60, 0 }
 
 /************************************DSP_TYPE_ENVELOPE*************************************/
 
-int32_t dsp_type_process_envelope(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_envelope(dsp_parm *dp, dsp_unit *du)
 {
-    int32_t filtout;
-
     if ((dp->dtenv.freq1 != du->dtenv.last_freq1) || (dp->dtenv.freq2 != du->dtenv.last_freq2) || (dp->dtenv.Q != du->dtenv.last_Q))
     {
         du->dtenv.last_freq1 = dp->dtenv.freq1;
         du->dtenv.last_freq2 = dp->dtenv.freq2;
         du->dtenv.last_Q = dp->dtenv.Q;
-        float w1 = nyquist_fraction_omega(du->dtenv.last_freq1);
-        float w2 = nyquist_fraction_omega(du->dtenv.last_freq2);
-        if (w1 > w2)
-        {
-            float temp = w1;
-            w1 = w2;
-            w2 = temp;
-        }
-        float a = float_a_value(w2, du->dtenv.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtenv.filtb0 = float_to_sampled_int(a * bfpa0);
-        du->dtenv.filta1_interp1 = du->dtenv.filta1 = float_to_sampled_int(-2.0f*cosf(w1)*bfpa0);
-        du->dtenv.filta1_interp2 = float_to_sampled_int(-2.0f*cosf(w2)*bfpa0);
-        du->dtenv.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
+        dsp_sweep_build(&du->dtenv.sweep, DSP_BIQUAD_BANDPASS, du->dtenv.last_freq1, du->dtenv.last_freq2, du->dtenv.last_Q);
     }
+}
 
+int32_t dsp_type_process_envelope(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_sweep_entry e;
     uint32_t envfilt;
     uint32_t abssample = sample < 0 ? -sample : sample;
 
@@ -749,18 +1110,8 @@ int32_t dsp_type_process_envelope(int32_t sample, dsp_parm *dp, dsp_unit *du)
                  break;
     }           
     int32_t sin_val = (QUANTIZATION_MAX - 1) - sine_wave_table(envfilt  + (dp->dtenv.reverse ? 0 : (WAVETABLES_LENGTH/4)));
-    du->dtenv.filta1 = du->dtenv.filta1_interp1 + ((du->dtenv.filta1_interp2 - du->dtenv.filta1_interp1) * 
-                            sin_val) / QUANTIZATION_MAX;
- 
-    filtout =    ((int32_t)du->dtenv.filtb0) * ((int32_t)sample - (int32_t)du->dtenv.sampledly2)
-               - ((int32_t)du->dtenv.filta1) * ((int32_t)du->dtenv.filtdly1)
-               - ((int32_t)du->dtenv.filta2) * ((int32_t)du->dtenv.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtenv.sampledly2 = du->dtenv.sampledly1;
-    du->dtenv.sampledly1 = sample;
-    du->dtenv.filtdly2 = du->dtenv.filtdly1;
-    du->dtenv.filtdly1 = filtout;
-    return filtout;
+    dsp_sweep_value(&du->dtenv.sweep, sin_val, &e);
+    return dsp_biquad(DSP_BIQUAD_BANDPASS, sample, e.b0, 0, 0, e.a1, e.a2, &du->dtenv.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_envelope[] = 
@@ -779,7 +1130,7 @@ const dsp_parm_envelope dsp_parm_envelope_default = { 0, 0, 200, 1500, 400, 2, 2
 
 /************************************DSP_TYPE_DISTORTION*************************************/
 
-int32_t dsp_type_process_distortion(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_distortion(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtdist.control_number1);
     if (abs(new_input - du->dtdist.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -787,40 +1138,50 @@ int32_t dsp_type_process_distortion(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtdist.pot_value1 = new_input;
         dp->dtdist.gain = (new_input * 256) / POT_MAX_VALUE; 
     }
-    if (dp->dtdist.noise_gate != du->dtdist.last_noise_gate)
+    if ((dp->dtdist.noise_gate != du->dtdist.last_noise_gate) || (dp->dtdist.sample_offset != du->dtdist.last_sample_offset))
     {
         du->dtdist.last_noise_gate = dp->dtdist.noise_gate;
-        du->dtdist.low_threshold = -((int32_t)du->dtdist.last_noise_gate)*(ADC_PREC_VALUE/256);
-        du->dtdist.high_threshold = ((int32_t)du->dtdist.last_noise_gate)*(ADC_PREC_VALUE/256);
-    }
-    if (dp->dtdist.sample_offset != du->dtdist.last_sample_offset)
-    {
         du->dtdist.last_sample_offset = dp->dtdist.sample_offset;
-        du->dtdist.offset_value = ((int32_t)du->dtdist.last_sample_offset)*(ADC_PREC_VALUE/256);
+        dsp_coefs_distortion *dist = &dsp_coefs_edit(du)->dist;
+        dist->low_threshold = -((int32_t)du->dtdist.last_noise_gate)*(ADC_PREC_VALUE/256);
+        dist->high_threshold = ((int32_t)du->dtdist.last_noise_gate)*(ADC_PREC_VALUE/256);
+        dist->offset_value = ((int32_t)du->dtdist.last_sample_offset)*(ADC_PREC_VALUE/256);
+        dsp_coefs_publish(du);
     }
-    if ((sample > du->dtdist.low_threshold) && (sample < du->dtdist.high_threshold))
+}
+
+static inline int32_t dsp_type_curve_distortion(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_distortion *dist = &dsp_coefs_current(du)->dist;
+    if ((sample > dist->low_threshold) && (sample < dist->high_threshold))
         sample = 0;
-    sample = ((sample+du->dtdist.offset_value) * (dp->dtdist.gain + 32)) / 32;
+    sample = ((sample+dist->offset_value) * (dp->dtdist.gain + 32)) / 32;
     if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
     if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
     return sample;
 }
 
+int32_t dsp_type_process_distortion(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    return dsp_oversample_process(&du->dtdist.os, dp->dtdist.oversample, sample, dsp_type_curve_distortion, dp, du);
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_distortion[] = 
 {
     { "Gain",         offsetof(dsp_parm_distortion,gain),                    4, 3, 1, 255, NULL },
     { "NoiseGate",    offsetof(dsp_parm_distortion,noise_gate),              4, 3, 0, 255, NULL },
     { "Offset",       offsetof(dsp_parm_distortion,sample_offset),           4, 3, 0, 255, NULL },
     { "GainCntrl",    offsetof(dsp_parm_distortion,control_number1),         4, 2, 0, POTENTIOMETER_MAX, "DistGain" },
+    { "Oversample",   offsetof(dsp_parm_distortion,oversample),              4, 1, 1, DSP_OVERSAMPLE_MAX, NULL, DSP_OVERSAMPLE_ALLOWED },
     { "SourceUnit",   offsetof(dsp_parm_distortion,source_unit),             4, 2, 1, MAX_DSP_UNITS, NULL },
     { NULL, 0, 4, 0, 0,   1, NULL    }
 };
 
-const dsp_parm_distortion dsp_parm_distortion_default = { 0, 0, 128, 0, 0, 0 };
+const dsp_parm_distortion dsp_parm_distortion_default = { 0, 0, 128, 0, 0, 0, 1 };
 
 /************************************DSP_TYPE_OVERDRIVE*************************************/
 
-int32_t dsp_type_process_overdrive(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_overdrive(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtovr.control_number1);
     if (abs(new_input - du->dtovr.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -838,38 +1199,51 @@ int32_t dsp_type_process_overdrive(int32_t sample, dsp_parm *dp, dsp_unit *du)
     {
         du->dtovr.last_threshold = dp->dtovr.threshold;
         du->dtovr.last_amplitude = dp->dtovr.amplitude;
-        du->dtovr.x0 = du->dtovr.last_threshold * (ADC_PREC_VALUE/256);
-        du->dtovr.y0 = du->dtovr.last_amplitude * (ADC_PREC_VALUE/256);
-        du->dtovr.y0x0 = du->dtovr.y0 * QUANTIZATION_MAX / du->dtovr.x0;
-        du->dtovr.y01 = (ADC_PREC_VALUE - du->dtovr.y0) * QUANTIZATION_MAX / (ADC_PREC_VALUE - du->dtovr.x0);
+        dsp_coefs_overdrive *ovr = &dsp_coefs_edit(du)->ovr;
+        ovr->x0 = du->dtovr.last_threshold * (ADC_PREC_VALUE/256);
+        ovr->y0 = du->dtovr.last_amplitude * (ADC_PREC_VALUE/256);
+        ovr->y0x0 = ovr->y0 * QUANTIZATION_MAX / ovr->x0;
+        ovr->y01 = (ADC_PREC_VALUE - ovr->y0) * QUANTIZATION_MAX / (ADC_PREC_VALUE - ovr->x0);
+        dsp_coefs_publish(du);
     }
+}
+
+static inline int32_t dsp_type_curve_overdrive(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_overdrive *ovr = &dsp_coefs_current(du)->ovr;
     int32_t absample = (sample < 0) ? -sample : sample;
-    if (absample <= du->dtovr.x0)
+    if (absample <= ovr->x0)
     {
-        absample = fractional_int_remove_offset(absample * du->dtovr.y0x0);
+        absample = fractional_int_remove_offset(absample * ovr->y0x0);
     } else
     {
-        absample = fractional_int_remove_offset((absample - du->dtovr.x0) * du->dtovr.y01) + du->dtovr.y0;
+        absample = fractional_int_remove_offset((absample - ovr->x0) * ovr->y01) + ovr->y0;
     }
     if (absample > (ADC_PREC_VALUE/2-1)) absample = (ADC_PREC_VALUE/2-1);
     return (sample < 0) ? -absample : absample;
 }
 
+int32_t dsp_type_process_overdrive(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    return dsp_oversample_process(&du->dtovr.os, dp->dtovr.oversample, sample, dsp_type_curve_overdrive, dp, du);
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_overdrive[] = 
 {
     { "Threshold",    offsetof(dsp_parm_overdrive,threshold),               4, 3, 1, 255, NULL },
     { "Amplitude",    offsetof(dsp_parm_overdrive,amplitude),               4, 3, 1, 255, NULL },
     { "ThrshCntrl",   offsetof(dsp_parm_overdrive,control_number1),         4, 2, 0, POTENTIOMETER_MAX, "OverThrsh" },
     { "AmplCntrl",    offsetof(dsp_parm_overdrive,control_number2),         4, 2, 0, POTENTIOMETER_MAX, "OverAmpl" },
+    { "Oversample",   offsetof(dsp_parm_overdrive,oversample),              4, 1, 1, DSP_OVERSAMPLE_MAX, NULL, DSP_OVERSAMPLE_ALLOWED },
     { "SourceUnit",   offsetof(dsp_parm_overdrive,source_unit),             4, 2, 1, MAX_DSP_UNITS, NULL },
     { NULL, 0, 4, 0, 0,   1, NULL    }
 };
 
-const dsp_parm_overdrive dsp_parm_overdrive_default = { 0, 0, 64, 192, 0, 0 };
+const dsp_parm_overdrive dsp_parm_overdrive_default = { 0, 0, 64, 192, 0, 0, 1 };
 
 /************************************DSP_TYPE_COMPRESSOR*************************************/
 
-int32_t dsp_type_process_compressor(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_compressor(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtcomp.control_number1);
     if (abs(new_input - du->dtcomp.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -883,7 +1257,10 @@ int32_t dsp_type_process_compressor(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtcomp.pot_value2 = new_input;
         dp->dtcomp.release = (new_input * 256) / POT_MAX_VALUE; 
     }
+}
 
+int32_t dsp_type_process_compressor(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     sample = (sample * du->dtcomp.gain) / 4096;
     if (sample > (ADC_PREC_VALUE/2-1)) 
     {
@@ -928,7 +1305,7 @@ const dsp_parm_compressor dsp_parm_compressor_default = { 0, 0, 40, 400, 200, 30
 
 /************************************DSP_TYPE_RING*************************************/
 
-int32_t dsp_type_process_ring(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_ring(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtring.control_number1);
     if (abs(new_input - du->dtring.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -941,7 +1318,10 @@ int32_t dsp_type_process_ring(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtring.last_frequency = dp->dtring.frequency;
         du->dtring.sine_counter_inc = du->dtring.last_frequency;
     }
+}
 
+int32_t dsp_type_process_ring(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dtring.sine_counter += du->dtring.sine_counter_inc;
     int32_t sine_val = sine_wave_table((du->dtring.sine_counter & 0xFFFF00) / (0xFFFF0 / WAVETABLES_LENGTH));
     if (!dp->dtring.sine_mix)
@@ -968,7 +1348,7 @@ const dsp_parm_ring dsp_parm_ring_default = { 0, 0, 60, 1, 0  };
 
 /************************************DSP_TYPE_FLANGE*************************************/
 
-int32_t dsp_type_process_flange(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_flange(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtflng.control_number1);
     if (abs(new_input - du->dtflng.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -987,18 +1367,29 @@ int32_t dsp_type_process_flange(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtflng.last_frequency = dp->dtflng.frequency;
         du->dtflng.sine_counter_inc = du->dtflng.last_frequency; // (du->dtflng.frequency * 65536) / DSP_SAMPLERATE;
     }
+}
+
+int32_t dsp_type_process_flange(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dtflng.sine_counter += du->dtflng.sine_counter_inc;
     int32_t sine_val = sine_wave_table((du->dtflng.sine_counter & 0xFFFF00) / (0xFFFF0 / WAVETABLES_LENGTH));
     int32_t mod_val = ((sine_val * dp->dtflng.modulation) + QUANTIZATION_MAX * 256) / 512;
     uint32_t delay_samples = (dp->dtflng.delay_samples * mod_val) / QUANTIZATION_MAX;
-    sample = (sample_circ_buf_value(delay_samples) * ((int32_t)dp->dtflng.feedback) + sample * ((int32_t)(255 - dp->dtflng.feedback))) / 256;
+    sample = (dsp_line_value(&du->line, delay_samples) * ((int32_t)dp->dtflng.feedback) + sample * ((int32_t)(255 - dp->dtflng.feedback))) / 256;
+    dsp_line_insert(&du->line, sample);
     return sample;
 
 }
 
-const dsp_parm_configuration_entry dsp_parm_configuration_entry_flange[] = 
+/* the modulation never takes the delay past delay_samples */
+uint32_t dsp_type_line_flange(const dsp_parm *dp)
 {
-    { "Speed",        offsetof(dsp_parm_flange,frequency),       4, 3, 1, 4095, NULL },
+    return dp->dtflng.delay_samples + 1;
+}
+
+const dsp_parm_configuration_entry dsp_parm_configuration_entry_flange[] = 
+{
+    { "Speed",        offsetof(dsp_parm_flange,frequency),       4, 3, 1, 4095, NULL },
     { "Modulation",   offsetof(dsp_parm_flange,modulation),      4, 3, 0, 255, NULL },
     { "Samples",      offsetof(dsp_parm_flange,delay_samples),   4, 5, 1, SAMPLE_CIRC_BUF_SIZE, NULL },
     { "Feedback",     offsetof(dsp_parm_flange,feedback),        4, 3, 0, 255, NULL },
@@ -1012,7 +1403,7 @@ const dsp_parm_flange dsp_parm_flange_default = { 0, 0, 32, 255, 70, 128, 0, 0
 
 /************************************DSP_TYPE_CHORUS*************************************/
 
-int32_t dsp_type_process_chorus(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_chorus(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtchor.control_number1);
     if (abs(new_input - du->dtchor.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -1031,6 +1422,10 @@ int32_t dsp_type_process_chorus(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtchor.last_frequency = dp->dtchor.frequency;
         du->dtchor.sine_counter_inc = du->dtchor.last_frequency; // (du->dtchor.frequency * 65536) / DSP_SAMPLERATE;
     }
+}
+
+int32_t dsp_type_process_chorus(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dtchor.sine_counter += du->dtchor.sine_counter_inc;
     int32_t sine_val = sine_wave_table((du->dtchor.sine_counter & 0xFFFF00) / (0xFFFF0 / WAVETABLES_LENGTH));
     int32_t mod_val = ((sine_val * dp->dtchor.modulation) + QUANTIZATION_MAX * 256) / 512;
@@ -1060,7 +1455,7 @@ const dsp_parm_chorus dsp_parm_chorus_default = { 0, 0, 70, 32, 128, 200, 0, 0 }
 
 /************************************DSP_TYPE_PHASER*************************************/
 
-int32_t dsp_type_process_phaser(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_phaser(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtphaser.control_number1);
     if (abs(new_input - du->dtphaser.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -1078,41 +1473,20 @@ int32_t dsp_type_process_phaser(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtphaser.last_freq1 = dp->dtphaser.freq1;
         du->dtphaser.last_freq2 = dp->dtphaser.freq2;
         du->dtphaser.last_Q = dp->dtphaser.Q;
-        
-        float w1 = nyquist_fraction_omega(du->dtphaser.last_freq1);
-        float w2 = nyquist_fraction_omega(du->dtphaser.last_freq2);
-        if (w1 > w2)
-        {
-            float temp = w1;
-            w1 = w2;
-            w2 = temp;
-        }
-        float a = float_a_value(w1, du->dtphaser.last_Q);
-        float bfpa0 = 0.999f/(1.0f+a);
-        du->dtphaser.filta1_interp1 = du->dtphaser.filta1 = float_to_sampled_int(-2.0f*cosf(w1)*bfpa0);
-        du->dtphaser.filta1_interp2 = float_to_sampled_int(-2.0f*cosf(w2)*bfpa0);
-        du->dtphaser.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
+        dsp_sweep_build(&du->dtphaser.sweep, DSP_BIQUAD_ALLPASS, du->dtphaser.last_freq1, du->dtphaser.last_freq2, du->dtphaser.last_Q);
     }
-    
+}
+
+int32_t dsp_type_process_phaser(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_sweep_entry e;
     du->dtphaser.sine_counter += du->dtphaser.sine_counter_inc;
     int32_t sine_val = QUANTIZATION_MAX - 1 - abs(sine_wave_table((du->dtphaser.sine_counter & 0xFFFF0) / (0xFFFF0 / WAVETABLES_LENGTH)));
-    du->dtphaser.filta1 = du->dtphaser.filta1_interp1 + ((du->dtphaser.filta1_interp2 - du->dtphaser.filta1_interp1) * 
-                            sine_val) / QUANTIZATION_MAX;
+    dsp_sweep_value(&du->dtphaser.sweep, sine_val, &e);
 
     int32_t filtout = sample;
     for (uint stage=0;stage<dp->dtphaser.stages;stage++)
-    {
-        int32_t last_filtout = filtout;
-        filtout =     ((int32_t)du->dtphaser.filta2) * (((int32_t)last_filtout) - ((int32_t)du->dtphaser.filtdly2[stage]))
-                            + ((int32_t)du->dtphaser.filta1) * (((int32_t)du->dtphaser.sampledly1[stage]) - ((int32_t)du->dtphaser.filtdly1[stage]))
-                            + ((int32_t)du->dtphaser.sampledly2[stage]) * float_to_sampled_int(0.999f);
-               
-        filtout = fractional_int_remove_offset(filtout);
-        du->dtphaser.sampledly2[stage] = du->dtphaser.sampledly1[stage];
-        du->dtphaser.sampledly1[stage] = last_filtout;
-        du->dtphaser.filtdly2[stage] = du->dtphaser.filtdly1[stage];
-        du->dtphaser.filtdly1[stage] = filtout;
-    }
+        filtout = dsp_biquad(DSP_BIQUAD_ALLPASS, filtout, 0, 0, QUANTIZATION_MAX * 999 / 1000, e.a1, e.a2, &du->dtphaser.bs[stage]);
     filtout = (filtout * ((int32_t)dp->dtphaser.mixval) + sample * ((int32_t)(255 - dp->dtphaser.mixval))) / 256;
     return filtout;
 }
@@ -1134,7 +1508,7 @@ const dsp_parm_phaser dsp_parm_phaser_default = { 0, 0, 300, 600, 200, 60, 128,
 
 /************************************DSP_TYPE_BACKWARDS*********************************/
 
-int32_t dsp_type_process_backwards(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_backwards(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtback.control_number1);
     if (abs(new_input - du->dtback.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -1148,6 +1522,10 @@ int32_t dsp_type_process_backwards(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtback.pot_value2 = new_input;
         dp->dtback.balance = (du->dtback.pot_value2 * 256) / POT_MAX_VALUE;
     }
+}
+
+int32_t dsp_type_process_backwards(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
     du->dtback.samples_count = (du->dtback.samples_count == 0) ? dp->dtback.backwards_samples : (du->dtback.samples_count-1);
     sample = (sample * ((int32_t)(255 - dp->dtback.balance)) + 
                        ((int32_t)sample_circ_buf_clean_value(du->dtback.samples_count)) * ((int32_t)dp->dtback.balance)) / 256;
@@ -1170,7 +1548,7 @@ const dsp_parm_backwards dsp_parm_backwards_default = { 0, 0, 2000, 255, 0, 0 };
 
 /************************************DSP_TYPE_PITCHSHIFT*********************************/
 
-int32_t dsp_type_process_pitchshift(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_pitchshift(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtpitch.control_number2);
     if (abs(new_input - du->dtpitch.pot_value2) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -1184,6 +1562,26 @@ int32_t dsp_type_process_pitchshift(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtpitch.pot_value3 = new_input;
         dp->dtpitch.pitchshift_rate = (du->dtpitch.pot_value3 * 16384) / POT_MAX_VALUE;
     }
+    if ((dp->dtpitch.frequency != du->dtpitch.last_frequency) || (dp->dtpitch.Q != du->dtpitch.last_Q))
+    {
+        du->dtpitch.last_frequency = dp->dtpitch.frequency;
+        du->dtpitch.last_Q = dp->dtpitch.Q;
+        dsp_coefs_biquad *bq = &dsp_coefs_edit(du)->bq;
+        int32_t c0 = fixed_omega_cos(du->dtpitch.last_frequency);
+        int32_t a = fixed_a_value(fixed_omega_sin(du->dtpitch.last_frequency), du->dtpitch.last_Q);
+        int32_t bfpa0 = fixed_bfpa0_value(a);
+        bq->filtb1 = fixed_to_sampled_int(FIXED_COEF_ONE - c0, bfpa0);
+        bq->filtb0 = fixed_to_sampled_int((FIXED_COEF_ONE - c0) / 2, bfpa0);
+        bq->filta1 = fixed_to_sampled_int(-2*c0, bfpa0);
+        bq->filta2 = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+        dsp_coefs_publish(du);
+    }
+}
+
+int32_t dsp_type_process_pitchshift(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_biquad *bq = &dsp_coefs_current(du)->bq;
+    /* resetting the read position belongs to the audio path, not the control pass */
     if (dp->dtpitch.pitchshift_samples != du->dtpitch.pitchshift_samples)
     {
         du->dtpitch.pitchshift_samples = dp->dtpitch.pitchshift_samples;
@@ -1195,19 +1593,6 @@ int32_t dsp_type_process_pitchshift(int32_t sample, dsp_parm *dp, dsp_unit *du)
         du->dtpitch.pitchshift_samples_scale = 32768 / du->dtpitch.pitchshift_samples;
         du->dtpitch.samples_count = du->dtpitch.pitchshift_samples_4096;
     }
-    if ((dp->dtpitch.frequency != du->dtpitch.last_frequency) || (dp->dtpitch.Q != du->dtpitch.last_Q))
-    {
-        du->dtpitch.last_frequency = dp->dtpitch.frequency;
-        du->dtpitch.last_Q = dp->dtpitch.Q;
-        float w0 = nyquist_fraction_omega(du->dtpitch.last_frequency);
-        float c0 = cosf(w0);
-        float a = float_a_value(w0,du->dtpitch.last_Q);
-        float bfpa0 = 1.0f/(1.0f+a);
-        du->dtpitch.filtb1 = float_to_sampled_int((1.0f-c0)*bfpa0);
-        du->dtpitch.filtb0 = float_to_sampled_int(0.5*(1.0f-c0)*bfpa0);
-        du->dtpitch.filta1 = float_to_sampled_int(-2.0f*c0*bfpa0);
-        du->dtpitch.filta2 = float_to_sampled_int((1.0f-a)*bfpa0);
-    }
     du->dtpitch.samples_count += (4096 - ((int32_t)dp->dtpitch.pitchshift_rate));
     if (du->dtpitch.samples_count < 0)  du->dtpitch.samples_count += du->dtpitch.pitchshift_samples_4096;
     if (du->dtpitch.samples_count >= du->dtpitch.pitchshift_samples_8192) du->dtpitch.samples_count -= du->dtpitch.pitchshift_samples_4096;
@@ -1237,16 +1622,7 @@ int32_t dsp_type_process_pitchshift(int32_t sample, dsp_parm *dp, dsp_unit *du)
     if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
     if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
     
-    int32_t filtout =    ((int32_t)du->dtpitch.filtb0) * ((int32_t)sample + (int32_t)du->dtpitch.sampledly2)
-                       + ((int32_t)du->dtpitch.filtb1) * ((int32_t)du->dtpitch.sampledly1)  
-                       - ((int32_t)du->dtpitch.filta1) * ((int32_t)du->dtpitch.filtdly1)
-                       - ((int32_t)du->dtpitch.filta2) * ((int32_t)du->dtpitch.filtdly2);
-    filtout = fractional_int_remove_offset(filtout);
-    du->dtpitch.sampledly2 = du->dtpitch.sampledly1;
-    du->dtpitch.sampledly1 = sample;
-    du->dtpitch.filtdly2 = du->dtpitch.filtdly1;
-    du->dtpitch.filtdly1 = filtout;
-    return filtout;
+    return dsp_biquad(DSP_BIQUAD_SYMMETRIC, sample, bq->filtb0, bq->filtb1, 0, bq->filta1, bq->filta2, &du->dtpitch.bs);
 }
 
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_pitchshift[] = 
@@ -1266,7 +1642,7 @@ const dsp_parm_pitchshift dsp_parm_pitchshift_default = { 0, 0, 800, 4096, 255,
 
 /************************************DSP_TYPE_WHAMMY*********************************/
 
-int32_t dsp_type_process_whammy(int32_t sample, dsp_parm *dp, dsp_unit *du)
+void dsp_type_control_whammy(dsp_parm *dp, dsp_unit *du)
 {
     uint32_t new_input = read_potentiometer_value(dp->dtwhammy.control_number3);
     if (abs(new_input - du->dtwhammy.pot_value3) >= POTENTIOMETER_VALUE_SENSITIVITY)
@@ -1277,6 +1653,11 @@ int32_t dsp_type_process_whammy(int32_t sample, dsp_parm *dp, dsp_unit *du)
         else
             du->dtwhammy.whammy_rate = 4096 + (du->dtwhammy.pot_value3 * dp->dtwhammy.whammy_adj) / POT_MAX_VALUE;
     }
+}
+
+int32_t dsp_type_process_whammy(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    /* resetting the read position belongs to the audio path, not the control pass */
     if (dp->dtwhammy.whammy_samples != du->dtwhammy.whammy_samples)
     {
         du->dtwhammy.whammy_samples = dp->dtwhammy.whammy_samples;
@@ -1333,7 +1714,7 @@ const dsp_parm_whammy dsp_parm_whammy_default = { 0, 0, 800, 128, 0, 5  };
 
 /************************************DSP_TYPE_OCTAVE*********************************/
 
-int32_t dsp_type_process_octave(int32_t sample, dsp_parm *dp, dsp_unit *du)
+static inline int32_t dsp_type_curve_octave(int32_t sample, dsp_parm *dp, dsp_unit *du)
 {
     if (dp->dtoct.rectify) 
     {
@@ -1367,15 +1748,611 @@ int32_t dsp_type_process_octave(int32_t sample, dsp_parm *dp, dsp_unit *du)
     return sample;
 }
 
+/* oversampled, the averages that take out the offset follow faster */
+int32_t dsp_type_process_octave(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    return dsp_oversample_process(&du->dtoct.os, dp->dtoct.oversample, sample, dsp_type_curve_octave, dp, du);
+}
+
 const dsp_parm_configuration_entry dsp_parm_configuration_entry_octave[] = 
 {
     { "Rectify",    offsetof(dsp_parm_octave,rectify),   4, 1, 0, 1, NULL},
     { "Multplr",    offsetof(dsp_parm_octave,multiplier), 4, 2, 1, 99, NULL },
+    { "Oversample", offsetof(dsp_parm_octave,oversample), 4, 1, 1, DSP_OVERSAMPLE_MAX, NULL, DSP_OVERSAMPLE_ALLOWED },
     { "SourceUnit", offsetof(dsp_parm_octave,source_unit),     4, 2, 1, MAX_DSP_UNITS, NULL },
     { NULL, 0, 4, 0, 0,   1 , NULL   }
 };
 
-const dsp_parm_octave dsp_parm_octave_default = { 0, 0, 1, 1 };
+const dsp_parm_octave dsp_parm_octave_default = { 0, 0, 1, 1, 1 };
+
+/************************************DSP_TYPE_LOOPER*************************************/
+
+#define DSP_LOOP_SAMPLES (DSP_LOOP_POOL_SIZE/sizeof(int16_t))
+#define DSP_LOOP_BLOCKS (DSP_LOOP_POOL_SIZE/sizeof(dsp_adpcm_block))
+
+static union
+{
+    int16_t         samples[DSP_LOOP_SAMPLES];
+    dsp_adpcm_block blocks[DSP_LOOP_BLOCKS];
+} dsp_loop_pool;
+
+dsp_loop_state dsp_loop;
+
+/* the resistor ladder of the stomp pedal, 0 if no button is pressed */
+uint dsp_pedal_button(uint16_t val)
+{
+    if ((val>=(POT_MAX_VALUE*2/16)) && (val<(POT_MAX_VALUE*4/16))) return 1;
+    if ((val>=(POT_MAX_VALUE*4/16)) && (val<(POT_MAX_VALUE*6/16))) return 2;
+    if ((val>=(POT_MAX_VALUE*7/16)) && (val<(POT_MAX_VALUE*9/16))) return 3;
+    if ((val>=(POT_MAX_VALUE*10/16)) && (val<(POT_MAX_VALUE*12/16))) return 4;
+    return 0;
+}
+
+/* audio must not be running the loop */
+void dsp_loop_clear(void)
+{
+    memset((void *)&dsp_loop, '\000', sizeof(dsp_loop));
+    /* so that the next sample moves the loop on */
+    dsp_loop.stamp = (dsp_core()->clean_pos + SAMPLE_CIRC_BUF_CLEAN_SIZE/2) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1);
+}
+
+/* true if a Looper of the active chain takes its buttons from control_number,
+   the stomp pedal then does not load settings */
+bool dsp_loop_pedal_input(uint control_number)
+{
+    const dsp_bank *db = dsp_bank_active;
+    for (uint e=0;e<db->schedule.count;e++)
+    {
+        const dsp_parm *dp = &db->parms[db->schedule.entry[e].unit_no];
+        if ((dp->dtn.dut == DSP_TYPE_LOOPER) && (dp->dtloop.control_number1 == control_number))
+            return true;
+    }
+    return false;
+}
+
+/* The benchmark overdubs a loop of DSP_LOOP_BENCH_BLOCKS blocks, the most
+   the audio path does per sample, at the start of the pool.  The player's
+   loop there and its state are kept aside and put back afterwards.  Audio
+   must not be running the loop. */
+#define DSP_LOOP_BENCH_BLOCKS 2
+
+static struct
+{
+    dsp_loop_state  loop;
+    dsp_adpcm_block blocks[DSP_LOOP_BENCH_BLOCKS];
+} dsp_loop_bench_saved;
+
+void dsp_loop_bench_start(bool compress)
+{
+    memcpy((void *)&dsp_loop_bench_saved.loop, (void *)&dsp_loop, sizeof(dsp_loop));
+    memcpy((void *)dsp_loop_bench_saved.blocks, (void *)dsp_loop_pool.blocks, sizeof(dsp_loop_bench_saved.blocks));
+    dsp_loop_clear();
+    dsp_loop.compress = compress;
+    dsp_loop.length = compress ? (DSP_LOOP_BENCH_BLOCKS*DSP_ADPCM_BLOCK_SAMPLES) : (DSP_LOOP_BENCH_BLOCKS*sizeof(dsp_adpcm_block)/sizeof(int16_t));
+    dsp_loop.mode = DSP_LOOP_OVERDUB;
+}
+
+void dsp_loop_bench_end(void)
+{
+    memcpy((void *)dsp_loop_pool.blocks, (void *)dsp_loop_bench_saved.blocks, sizeof(dsp_loop_bench_saved.blocks));
+    memcpy((void *)&dsp_loop, (void *)&dsp_loop_bench_saved.loop, sizeof(dsp_loop));
+    dsp_loop.stamp = (dsp_core()->clean_pos + SAMPLE_CIRC_BUF_CLEAN_SIZE/2) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1);
+}
+
+static inline int32_t dsp_loop_read(dsp_loop_state *dl)
+{
+    if (!dl->compress) return dsp_loop_pool.samples[dl->pos];
+    const dsp_adpcm_block *b = &dsp_loop_pool.blocks[dl->pos / DSP_ADPCM_BLOCK_SAMPLES];
+    uint32_t i = dl->pos % DSP_ADPCM_BLOCK_SAMPLES;
+    if (i == 0)
+    {
+        dl->decoder.predictor = b->predictor;
+        dl->decoder.step_index = b->step_index;
+    }
+    return dsp_adpcm_decode(&dl->decoder, dsp_adpcm_block_code(b, i)) >> 2;
+}
+
+static inline void dsp_loop_write(dsp_loop_state *dl, int32_t sample)
+{
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    if (dl->compress)
+        dsp_adpcm_block_write(&dsp_loop_pool.blocks[dl->pos / DSP_ADPCM_BLOCK_SAMPLES], dl->pos % DSP_ADPCM_BLOCK_SAMPLES, &dl->encoder, sample);
+    else
+        dsp_loop_pool.samples[dl->pos] = sample;
+}
+
+static void dsp_loop_press(dsp_loop_state *dl, uint32_t button)
+{
+    dsp_loop_mode mode = dl->mode;
+
+    if (button == 4)
+    {
+        dl->mode = DSP_LOOP_EMPTY;
+        dl->length = 0;
+        dl->pos = 0;
+        return;
+    }
+    if (mode == DSP_LOOP_EMPTY)
+    {
+        if (button != 1) return;
+        dl->compress = dl->compress_next;
+        dl->encoder.predictor = 0;
+        dl->encoder.step_index = 0;
+        dl->length = 0;
+        dl->pos = 0;
+        dl->mode = DSP_LOOP_RECORD;
+        return;
+    }
+    if (mode == DSP_LOOP_RECORD)
+    {
+        dl->length = dl->pos;
+        dl->pos = 0;
+        if (dl->length == 0)
+            dl->mode = DSP_LOOP_EMPTY;
+        else
+            dl->mode = (button == 3) ? DSP_LOOP_STOP : DSP_LOOP_PLAY;
+        return;
+    }
+    switch (button)
+    {
+        case 1: dl->mode = (mode == DSP_LOOP_PLAY) ? DSP_LOOP_OVERDUB : DSP_LOOP_PLAY;
+                break;
+        case 2: dl->mode = DSP_LOOP_PLAY;
+                break;
+        case 3: dl->mode = DSP_LOOP_STOP;
+                dl->pos = 0;
+                break;
+    }
+}
+
+/* one sample of the loop, overdub reads and writes the same sample */
+static int32_t dsp_loop_advance(dsp_loop_state *dl, int32_t sample)
+{
+    uint32_t button = dl->button;
+    int32_t loop = 0;
+
+    if ((button != 0) && ((!dl->compress) || ((dl->pos % DSP_ADPCM_BLOCK_SAMPLES) == 0)))
+    {
+        dl->button = 0;
+        dsp_loop_press(dl, button);
+    }
+    switch (dl->mode)
+    {
+        case DSP_LOOP_RECORD:
+            dsp_loop_write(dl, sample);
+            if ((++dl->pos) >= (dl->compress ? (DSP_LOOP_BLOCKS*DSP_ADPCM_BLOCK_SAMPLES) : DSP_LOOP_SAMPLES))
+                dsp_loop_press(dl, 2);
+            return 0;
+        case DSP_LOOP_PLAY:
+            loop = dsp_loop_read(dl);
+            break;
+        case DSP_LOOP_OVERDUB:
+            loop = dsp_loop_read(dl);
+            dsp_loop_write(dl, loop + sample);
+            break;
+        default:
+            return 0;
+    }
+    if ((++dl->pos) >= dl->length) dl->pos = 0;
+    return loop;
+}
+
+void dsp_type_control_looper(dsp_parm *dp, dsp_unit *du)
+{
+    dsp_loop_state *dl = &dsp_loop;
+
+    dl->compress_next = dp->dtloop.compress != 0;
+    if (dp->dtloop.control_number1 == 0) return;
+    uint button = dsp_pedal_button(read_potentiometer_value(dp->dtloop.control_number1));
+    if (button != dl->pedal_wait)
+    {
+        dl->pedal_wait = button;
+        dl->pedal_count = 0;
+        return;
+    }
+    if (dl->pedal_count >= DSP_LOOP_DEBOUNCE) return;
+    if (((++dl->pedal_count) == DSP_LOOP_DEBOUNCE) && (button != 0))
+        dl->button = button;
+}
+
+int32_t dsp_type_process_looper(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_loop_state *dl = &dsp_loop;
+    int stamp = dsp_core()->clean_pos;
+    int32_t loop;
+
+    if (((dl->stamp - stamp) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1)) < DSP_BLOCK_MAX)
+        loop = dl->recent[stamp & (DSP_BLOCK_MAX-1)];
+    else
+    {
+        loop = dsp_loop_advance(dl, sample);
+        dl->recent[stamp & (DSP_BLOCK_MAX-1)] = loop;
+        dl->stamp = stamp;
+    }
+    sample += (loop * ((int32_t)dp->dtloop.level)) / 256;
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    return sample;
+}
+
+const dsp_parm_configuration_entry dsp_parm_configuration_entry_looper[] =
+{
+    { "Level",      offsetof(dsp_parm_looper,level),           4, 3, 0, 255, NULL },
+    { "Compress",   offsetof(dsp_parm_looper,compress),        4, 1, 0, 1, NULL },
+    { "PedalCtrl",  offsetof(dsp_parm_looper,control_number1), 4, 2, 0, POTENTIOMETER_MAX, "LoopPedal" },
+    { "SourceUnit", offsetof(dsp_parm_looper,source_unit),     4, 2, 1, MAX_DSP_UNITS, NULL },
+    { NULL, 0, 4, 0, 0,   1 , NULL   }
+};
+
+const dsp_parm_looper dsp_parm_looper_default = { 0, 0, 255, 1, PEDAL_SWITCH_INPUT };
+
+/************************************DSP_TYPE_REVERB*************************************/
+
+/* prime lengths (57 to 104 ms), which with DSP_REVERB_MOD_MAX+2 samples
+   each for the modulation fit in DSP_REVERB_LINE_BUDGET */
+static const uint16_t dsp_reverb_lengths[DSP_REVERB_LINES] = { 1433, 1867, 2179, 2591 };
+
+#define DSP_REVERB_LFO_INC (0xFFFFFFFFu / DSP_SAMPLERATE)
+
+/* an arithmetic shift that rounds towards zero, so that the tail dies
+   away to silence instead of settling on a small offset */
+static inline int32_t dsp_type_reverb_shift(int32_t x, uint n)
+{
+    return (x >= 0) ? (x >> n) : -((int32_t)((-(uint32_t)x) >> n));
+}
+
+/* ((x << 8) - d) * m / 256 rounded towards zero, as the damping filter
+   steps damped towards x.  Full scale x and d with m up to 256 would
+   overflow 32 bits, so d is split into its top bits and its low byte:
+   the result is a - b/256 with a = (x - (d >> 8)) * m and
+   b = (d & 0xFF) * m. */
+static inline int32_t dsp_type_reverb_damp(int32_t x, int32_t d, int32_t m)
+{
+    int32_t a = (x - (d >> 8)) * m;
+    int32_t b = (d & 0xFF) * m;
+    if ((a > 255) || ((a > 0) && ((a << 8) > b)))
+        return a - ((b + 255) >> 8);
+    return a - (b >> 8);
+}
+
+/* 655/65536 is close enough to 1/100 to scale by Size in percent */
+static inline uint32_t dsp_type_reverb_delay(uint i, uint32_t size)
+{
+    return (dsp_reverb_lengths[i] * size * 655) >> 16;
+}
+
+uint32_t dsp_type_line_reverb(const dsp_parm *dp)
+{
+    uint32_t samples = 0;
+    for (uint i=0;i<DSP_REVERB_LINES;i++)
+        samples += dsp_type_reverb_delay(i, dp->dtrev.size) + DSP_REVERB_MOD_MAX + 2;
+    return samples;
+}
+
+/* the lines are cut from the unit's line when Size changes, they are not
+   cleared but nothing is read from them until it has been written */
+static void dsp_type_reverb_lines(dsp_parm *dp, dsp_unit *du)
+{
+    dsp_type_reverb *rv = &du->dtrev;
+    int16_t *line = du->line.samples;
+    uint32_t left = du->line.size;
+
+    rv->size = dp->dtrev.size;
+    rv->fill = 0;
+    for (uint i=0;i<DSP_REVERB_LINES;i++)
+    {
+        uint32_t delay = dsp_type_reverb_delay(i, rv->size);
+        uint32_t length = delay + DSP_REVERB_MOD_MAX + 2;
+        if (length > left)
+        {
+            length = left;
+            delay = (length > (DSP_REVERB_MOD_MAX + 2)) ? (length - DSP_REVERB_MOD_MAX - 2) : 0;
+        }
+        rv->line[i] = line;
+        rv->length[i] = length;
+        rv->delay[i] = delay;
+        rv->pos[i] = 0;
+        rv->damped[i] = 0;
+        line += length;
+        left -= length;
+    }
+}
+
+void dsp_type_control_reverb(dsp_parm *dp, dsp_unit *du)
+{
+    uint32_t new_input = read_potentiometer_value(dp->dtrev.control_number1);
+    if (abs(new_input - du->dtrev.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
+    {
+        du->dtrev.pot_value1 = new_input;
+        dp->dtrev.decay = (du->dtrev.pot_value1 * 256) / POT_MAX_VALUE;
+    }
+    new_input = read_potentiometer_value(dp->dtrev.control_number2);
+    if (abs(new_input - du->dtrev.pot_value2) >= POTENTIOMETER_VALUE_SENSITIVITY)
+    {
+        du->dtrev.pot_value2 = new_input;
+        dp->dtrev.mixval = (du->dtrev.pot_value2 * 256) / POT_MAX_VALUE;
+    }
+}
+
+int32_t dsp_type_process_reverb(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_type_reverb *rv = &du->dtrev;
+    int32_t v[DSP_REVERB_LINES];
+    int32_t depth = dp->dtrev.modulation;
+    int32_t damp = 256 - ((int32_t)dp->dtrev.damping);
+    int32_t decay = dp->dtrev.decay;
+
+    if (rv->size != dp->dtrev.size) dsp_type_reverb_lines(dp, du);
+    rv->lfo_phase += DSP_REVERB_LFO_INC;
+    for (uint i=0;i<DSP_REVERB_LINES;i++)
+    {
+        int32_t x = 0;
+        int32_t s = sine_wave_table((rv->lfo_phase + i*0x40000000u) >> 22);
+        uint32_t delay = (rv->delay[i] << 8) + ((depth * (s + 32768)) >> 8);
+        uint32_t d = delay >> 8;
+        if ((d + 2) <= rv->fill)
+        {
+            const int16_t *line = rv->line[i];
+            int32_t p = ((int32_t)rv->pos[i]) - ((int32_t)d);
+            if (p < 0) p += rv->length[i];
+            int32_t q = (p > 0) ? (p - 1) : (rv->length[i] - 1);
+            x = line[p] + dsp_type_reverb_shift((line[q] - line[p]) * ((int32_t)(delay & 0xFF)), 8);
+        }
+        /* damped holds 8 more bits so that it settles on x */
+        rv->damped[i] += dsp_type_reverb_damp(x, rv->damped[i], damp);
+        v[i] = dsp_type_reverb_shift(rv->damped[i], 8);
+    }
+
+    /* the Hadamard matrix in butterflies, it is twice an orthonormal matrix
+       and the half is taken with the decay gain, decay/512.  h reaches 4
+       times full scale, which times decay still fits 32 bits. */
+    int32_t a = v[0] + v[1], b = v[0] - v[1], c = v[2] + v[3], d = v[2] - v[3];
+    int32_t h[DSP_REVERB_LINES] = { a + c, b + d, a - c, b - d };
+    for (uint i=0;i<DSP_REVERB_LINES;i++)
+    {
+        int32_t w = sample + dsp_type_reverb_shift(h[i] * decay, 9);
+        if (w > 32767) w = 32767;
+        if (w < -32768) w = -32768;
+        if ((++rv->pos[i]) >= rv->length[i]) rv->pos[i] = 0;
+        rv->line[i][rv->pos[i]] = w;
+    }
+    if (rv->fill < DSP_REVERB_LINE_BUDGET) rv->fill++;
+
+    int32_t wet = h[0] >> 1;
+    sample += ((wet - sample) * ((int32_t)dp->dtrev.mixval)) >> 8;
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    return sample;
+}
+
+const dsp_parm_configuration_entry dsp_parm_configuration_entry_reverb[] =
+{
+    { "Size",       offsetof(dsp_parm_reverb,size),            4, 3, 10, 100, NULL },
+    { "Decay",      offsetof(dsp_parm_reverb,decay),           4, 3, 0, 255, NULL },
+    { "Damping",    offsetof(dsp_parm_reverb,damping),         4, 3, 0, 255, NULL },
+    { "Modulation", offsetof(dsp_parm_reverb,modulation),      4, 2, 0, DSP_REVERB_MOD_MAX, NULL },
+    { "Mixval",     offsetof(dsp_parm_reverb,mixval),          4, 3, 0, 255, NULL },
+    { "DecayCntrl", offsetof(dsp_parm_reverb,control_number1), 4, 2, 0, POTENTIOMETER_MAX, "RevDecay" },
+    { "MixCntrl",   offsetof(dsp_parm_reverb,control_number2), 4, 2, 0, POTENTIOMETER_MAX, "RevMix" },
+    { "SourceUnit", offsetof(dsp_parm_reverb,source_unit),     4, 2, 1, MAX_DSP_UNITS, NULL },
+    { NULL, 0, 4, 0, 0,   1 , NULL   }
+};
+
+const dsp_parm_reverb dsp_parm_reverb_default = { 0, 0, 70, 200, 80, 8, 96, 0, 0 };
+
+/************************************DSP_TYPE_CABINET*************************************/
+
+static inline const cabinet_ir *dsp_type_cabinet_ir(uint32_t cabinet)
+{
+    return &cabinet_irs[((cabinet >= 1) && (cabinet <= CABINET_IRS)) ? (cabinet - 1) : 0];
+}
+
+static inline uint32_t dsp_type_cabinet_parts(const cabinet_ir *ir)
+{
+    return (ir->length > CABINET_HEAD) ? ((ir->length - CABINET_HEAD + CABINET_BLOCK - 1) / CABINET_BLOCK) : 0;
+}
+
+/* the FFT work area, the input ring, two blocks of tail and the head taps,
+   then the input spectra and the partition spectra */
+#define DSP_CABINET_WORK_SAMPLES (CABINET_FFT_SIZE*sizeof(cabinet_complex)/sizeof(int16_t))
+#define DSP_CABINET_SPECTRUM_SAMPLES (CABINET_BINS*sizeof(cabinet_bin)/sizeof(int16_t))
+
+uint32_t dsp_type_line_cabinet(const dsp_parm *dp)
+{
+    uint32_t parts = dsp_type_cabinet_parts(dsp_type_cabinet_ir(dp->dtcab.cabinet));
+    return DSP_CABINET_WORK_SAMPLES + CABINET_RING + CABINET_BLOCK*2 + CABINET_HEAD + parts*DSP_CABINET_SPECTRUM_SAMPLES*2;
+}
+
+/* The audio path passes the signal through while taps is NULL.  The work
+   area, ring and tail are always at the start of the line, so the audio
+   path may still be using them while the IR is changed.  The head taps are
+   copied into the line, so the audio path reads them from SRAM rather
+   than through the XIP cache. */
+static void dsp_type_cabinet_setup(dsp_parm *dp, dsp_unit *du)
+{
+    dsp_type_cabinet *cb = &du->dtcab;
+    const cabinet_ir *ir = dsp_type_cabinet_ir(dp->dtcab.cabinet);
+    int16_t *line = du->line.samples;
+
+    cb->taps = NULL;
+    DMB();
+    cb->cabinet = dp->dtcab.cabinet;
+    if (dsp_type_line_cabinet(dp) > du->line.size) return;
+    cb->parts = dsp_type_cabinet_parts(ir);
+    cb->parts_ready = 0;
+    cb->shift = cabinet_tail_shift(ir);
+    cb->fdl_pos = 0;
+    cb->work = (cabinet_complex *)line;
+    line += DSP_CABINET_WORK_SAMPLES;
+    cb->in = line;
+    line += CABINET_RING;
+    cb->tail = line;
+    line += CABINET_BLOCK*2;
+    int16_t *taps = line;
+    line += CABINET_HEAD;
+    cb->fdl = (cabinet_bin *)line;
+    line += cb->parts*DSP_CABINET_SPECTRUM_SAMPLES;
+    cb->h = (cabinet_bin *)line;
+    memset((void *)cb->in, '\000', (CABINET_RING + CABINET_BLOCK*2)*sizeof(int16_t));
+    memset((void *)cb->fdl, '\000', cb->parts*CABINET_BINS*sizeof(cabinet_bin));
+    cb->head = (ir->length < CABINET_HEAD) ? ir->length : CABINET_HEAD;
+    memcpy((void *)taps, (const void *)ir->taps, cb->head*sizeof(int16_t));
+    cb->done = cb->block;
+    DMB();
+    cb->taps = taps;
+}
+
+/* The tail of the last input block, if there is one the audio path has
+   finished, and the spectrum of one more partition until they are all
+   done.  If the control pass has fallen more than a block behind the
+   blocks missed are dropped and the convolution starts again from the
+   last one. */
+void dsp_type_control_cabinet(dsp_parm *dp, dsp_unit *du)
+{
+    dsp_type_cabinet *cb = &du->dtcab;
+
+    if (cb->cabinet != dp->dtcab.cabinet) dsp_type_cabinet_setup(dp, du);
+    if ((cb->taps == NULL) || (cb->parts == 0)) return;
+
+    uint32_t block = cb->block;
+    if ((block - cb->done) > 1)
+    {
+        memset((void *)cb->fdl, '\000', cb->parts*CABINET_BINS*sizeof(cabinet_bin));
+        cb->done = block - 1;
+    }
+    if (block != cb->done)
+    {
+        uint32_t j = cb->done;
+        if ((++cb->fdl_pos) >= cb->parts) cb->fdl_pos = 0;
+        cabinet_spectrum(&cb->fdl[cb->fdl_pos*CABINET_BINS], cb->in, j, cb->work);
+        cabinet_tail(&cb->tail[(j & 0x01)*CABINET_BLOCK], cb->fdl, cb->fdl_pos, cb->h, cb->parts,
+                     cb->parts_ready, cb->shift, cb->work);
+        DMB();
+        cb->done = j + 1;
+    }
+    if (cb->parts_ready < cb->parts)
+    {
+        cabinet_partition(&cb->h[cb->parts_ready*CABINET_BINS], dsp_type_cabinet_ir(cb->cabinet), cb->parts_ready,
+                          cb->shift, cb->work);
+        cb->parts_ready++;
+    }
+}
+
+/* The tail of input block j is added to block j+2, if the control pass has
+   finished it by the time that block starts. */
+int32_t dsp_type_process_cabinet(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    dsp_type_cabinet *cb = &du->dtcab;
+    const int16_t *taps = cb->taps;
+    uint32_t pos = cb->pos;
+    uint32_t block = cb->block;
+    int32_t wet = sample;
+
+    if ((pos & (CABINET_BLOCK-1)) == 0) cb->tail_ok = (block - cb->done) <= 1;
+    if (taps != NULL)
+    {
+        int16_t *in = cb->in;
+        int32_t acc = 0;
+        in[pos] = (sample > (ADC_PREC_VALUE/2-1)) ? (ADC_PREC_VALUE/2-1) : ((sample < (-ADC_PREC_VALUE/2+1)) ? (-ADC_PREC_VALUE/2+1) : sample);
+        for (uint32_t t=0;t<cb->head;t++)
+            acc += taps[t] * in[(pos - t) & (CABINET_RING-1)];
+        wet = (acc + (1 << 14)) >> 15;
+        if (cb->tail_ok) wet += cb->tail[(block & 0x01)*CABINET_BLOCK + (pos & (CABINET_BLOCK-1))];
+    }
+    if ((++pos) >= CABINET_RING) pos = 0;
+    cb->pos = pos;
+    if ((pos & (CABINET_BLOCK-1)) == 0)
+    {
+        DMB();
+        cb->block = block + 1;
+    }
+
+    sample += ((wet - sample) * ((int32_t)dp->dtcab.mixval)) >> 8;
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    return sample;
+}
+
+const dsp_parm_configuration_entry dsp_parm_configuration_entry_cabinet[] =
+{
+    { "Cabinet",    offsetof(dsp_parm_cabinet,cabinet),        4, 1, 1, CABINET_IRS, NULL },
+    { "Mixval",     offsetof(dsp_parm_cabinet,mixval),         4, 3, 0, 255, NULL },
+    { "SourceUnit", offsetof(dsp_parm_cabinet,source_unit),    4, 2, 1, MAX_DSP_UNITS, NULL },
+    { NULL, 0, 4, 0, 0,   1 , NULL   }
+};
+
+const dsp_parm_cabinet dsp_parm_cabinet_default = { 0, 0, 1, 255 };
+
+/************************************DSP_TYPE_WAVESHAPER*************************************/
+
+/* pos is in 1/65536 of an entry, past either end the end entries are used */
+static inline int32_t dsp_waveshaper_lookup(const int16_t *table, int32_t pos)
+{
+    if (pos <= 0) return table[0];
+    if (pos >= (SHAPER_LENGTH << 16)) return table[SHAPER_LENGTH];
+    const int16_t *t = &table[pos >> 16];
+    int32_t frac = (pos & 0xFFFF) >> 1;
+    return t[0] + (((t[1] - t[0]) * frac) >> 15);
+}
+
+void dsp_type_control_waveshaper(dsp_parm *dp, dsp_unit *du)
+{
+    uint32_t new_input = read_potentiometer_value(dp->dtshape.control_number1);
+    if (abs(new_input - du->dtshape.pot_value1) >= POTENTIOMETER_VALUE_SENSITIVITY)
+    {
+        du->dtshape.pot_value1 = new_input;
+        dp->dtshape.drive = (new_input * 256) / POT_MAX_VALUE;
+    }
+    if ((dp->dtshape.curve != du->dtshape.last_curve) || (dp->dtshape.drive != du->dtshape.last_drive) ||
+        (dp->dtshape.bias != du->dtshape.last_bias) || (dp->dtshape.level != du->dtshape.last_level))
+    {
+        du->dtshape.last_curve = dp->dtshape.curve;
+        du->dtshape.last_drive = dp->dtshape.drive;
+        du->dtshape.last_bias = dp->dtshape.bias;
+        du->dtshape.last_level = dp->dtshape.level;
+        dsp_coefs_waveshaper *shape = &dsp_coefs_edit(du)->shape;
+        shape->curve = ((du->dtshape.last_curve >= 1) && (du->dtshape.last_curve <= SHAPERTABLES_NUMBER)) ?
+                       (du->dtshape.last_curve - 1) : 0;
+        /* the curves have 32 entries for each unit of input and a Drive of
+           32 is a gain of one, so full scale times 32 moves 32 entries */
+        shape->drive = du->dtshape.last_drive * ((1 << 16) / (ADC_PREC_VALUE/2));
+        /* a Bias of 0 or 255 moves the input by one unit of the curve */
+        shape->base = ((SHAPER_LENGTH/2) << 16) + ((((int32_t)du->dtshape.last_bias) - 128) * 16384);
+        shape->dc = dsp_waveshaper_lookup(shapertables[shape->curve], shape->base);
+        shape->level = du->dtshape.last_level;
+        dsp_coefs_publish(du);
+    }
+}
+
+static inline int32_t dsp_type_curve_waveshaper(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    const dsp_coefs_waveshaper *shape = &dsp_coefs_current(du)->shape;
+    sample = dsp_waveshaper_lookup(shapertables[shape->curve], sample * shape->drive + shape->base) - shape->dc;
+    sample = (sample * shape->level) >> 9;
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    return sample;
+}
+
+int32_t dsp_type_process_waveshaper(int32_t sample, dsp_parm *dp, dsp_unit *du)
+{
+    return dsp_oversample_process(&du->dtshape.os, dp->dtshape.oversample, sample, dsp_type_curve_waveshaper, dp, du);
+}
+
+const dsp_parm_configuration_entry dsp_parm_configuration_entry_waveshaper[] =
+{
+    { "Curve",        offsetof(dsp_parm_waveshaper,curve),                   4, 1, 1, SHAPERTABLES_NUMBER, NULL },
+    { "Drive",        offsetof(dsp_parm_waveshaper,drive),                   4, 3, 1, 255, NULL },
+    { "Bias",         offsetof(dsp_parm_waveshaper,bias),                    4, 3, 0, 255, NULL },
+    { "Level",        offsetof(dsp_parm_waveshaper,level),                   4, 3, 0, 255, NULL },
+    { "DriveCntrl",   offsetof(dsp_parm_waveshaper,control_number1),         4, 2, 0, POTENTIOMETER_MAX, "ShapeDrive" },
+    { "Oversample",   offsetof(dsp_parm_waveshaper,oversample),              4, 1, 1, DSP_OVERSAMPLE_MAX, NULL, DSP_OVERSAMPLE_ALLOWED },
+    { "SourceUnit",   offsetof(dsp_parm_waveshaper,source_unit),             4, 2, 1, MAX_DSP_UNITS, NULL },
+    { NULL, 0, 4, 0, 0,   1, NULL    }
+};
+
+const dsp_parm_waveshaper dsp_parm_waveshaper_default = { 0, 0, 1, 64, 128, 128, 0, 1 };
 
 /************STRUCTURES FOR ALL DSP TYPES *****************************/
 
@@ -1407,6 +2384,10 @@ const char * const dtnames[] =
     "Whammy",
     "Octave",
     "Sin Synth",
+    "Looper",
+    "Reverb",
+    "Cabinet",
+    "Waveshaper",
     NULL
 };
 
@@ -1438,10 +2419,15 @@ const dsp_parm_configuration_entry * const dpce[] =
     dsp_parm_configuration_entry_whammy, 
     dsp_parm_configuration_entry_octave, 
     dsp_parm_configuration_entry_sin_synth, 
+    dsp_parm_configuration_entry_looper,
+    dsp_parm_configuration_entry_reverb,
+    dsp_parm_configuration_entry_cabinet,
+    dsp_parm_configuration_entry_waveshaper,
     NULL
 };
 
-dsp_type_process * const dtp[] = {
+/* in scratch SRAM with the core states */
+dsp_type_process * const __scratch_y("dsp_dispatch") dtp[] = {
     dsp_type_process_none,
     dsp_type_process_noisegate,
     dsp_type_process_delay,
@@ -1468,6 +2454,147 @@ dsp_type_process * const dtp[] = {
     dsp_type_process_whammy,
     dsp_type_process_octave,
     dsp_type_process_sin_synth,
+    dsp_type_process_looper,
+    dsp_type_process_reverb,
+    dsp_type_process_cabinet,
+    dsp_type_process_waveshaper,
+};
+
+/* NULL entries have nothing to do at the control rate */
+dsp_type_control * const dtcp[] = {
+    NULL,
+    dsp_type_control_noisegate,
+    dsp_type_control_delay,
+    NULL,
+    NULL,
+    dsp_type_control_bandpass,
+    dsp_type_control_lowpass,
+    dsp_type_control_highpass,
+    dsp_type_control_allpass,
+    dsp_type_control_tremolo,
+    dsp_type_control_vibrato,
+    dsp_type_control_wah,
+    dsp_type_control_autowah,
+    dsp_type_control_envelope,
+    dsp_type_control_distortion,
+    dsp_type_control_overdrive,
+    dsp_type_control_compressor,
+    dsp_type_control_ring,
+    dsp_type_control_flange,
+    dsp_type_control_chorus,
+    dsp_type_control_phaser,
+    dsp_type_control_backwards,
+    dsp_type_control_pitchshift,
+    dsp_type_control_whammy,
+    NULL,
+    dsp_type_control_sin_synth,
+    dsp_type_control_looper,
+    dsp_type_control_reverb,
+    dsp_type_control_cabinet,
+    dsp_type_control_waveshaper,
+};
+
+/* NULL entries are run one sample at a time by dsp_process_block */
+dsp_type_process_block * const __scratch_y("dsp_dispatch") dtpb[] = {
+    dsp_type_process_none_block,
+    NULL,
+    NULL,
+    NULL,
+    dsp_type_process_combine_block,
+    dsp_type_process_bandpass_block,
+    dsp_type_process_lowpass_block,
+    dsp_type_process_highpass_block,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+/* NULL entries have no delay line */
+dsp_type_line * const dtline[] = {
+    NULL,
+    NULL,
+    dsp_type_line_delay,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    dsp_type_line_flange,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    dsp_type_line_reverb,
+    dsp_type_line_cabinet,
+    NULL,
+};
+
+#define DSP_UNIT_STATE_SIZE(member) (offsetof(dsp_unit,member) + sizeof(((dsp_unit *)0)->member))
+
+const uint16_t dsp_type_state_size[] = {
+    DSP_UNIT_STATE_SIZE(dtn),
+    DSP_UNIT_STATE_SIZE(dtnoise),
+    DSP_UNIT_STATE_SIZE(dtd),
+    DSP_UNIT_STATE_SIZE(dtroom),
+    DSP_UNIT_STATE_SIZE(dtcombine),
+    DSP_UNIT_STATE_SIZE(dtbp),
+    DSP_UNIT_STATE_SIZE(dtlp),
+    DSP_UNIT_STATE_SIZE(dthp),
+    DSP_UNIT_STATE_SIZE(dtap),
+    DSP_UNIT_STATE_SIZE(dttrem),
+    DSP_UNIT_STATE_SIZE(dtvibr),
+    DSP_UNIT_STATE_SIZE(dtwah),
+    DSP_UNIT_STATE_SIZE(dtautowah),
+    DSP_UNIT_STATE_SIZE(dtenv),
+    DSP_UNIT_STATE_SIZE(dtdist),
+    DSP_UNIT_STATE_SIZE(dtovr),
+    DSP_UNIT_STATE_SIZE(dtcomp),
+    DSP_UNIT_STATE_SIZE(dtring),
+    DSP_UNIT_STATE_SIZE(dtflng),
+    DSP_UNIT_STATE_SIZE(dtchor),
+    DSP_UNIT_STATE_SIZE(dtphaser),
+    DSP_UNIT_STATE_SIZE(dtback),
+    DSP_UNIT_STATE_SIZE(dtpitch),
+    DSP_UNIT_STATE_SIZE(dtwhammy),
+    DSP_UNIT_STATE_SIZE(dtoct),
+    DSP_UNIT_STATE_SIZE(dtss),
+    DSP_UNIT_STATE_SIZE(dtloop),
+    DSP_UNIT_STATE_SIZE(dtrev),
+    DSP_UNIT_STATE_SIZE(dtcab),
+    DSP_UNIT_STATE_SIZE(dtshape),
 };
 
 const void * const dsp_parm_struct_defaults[] =
@@ -1497,9 +2624,55 @@ const void * const dsp_parm_struct_defaults[] =
     (void *) &dsp_parm_pitchshift_default,
     (void *) &dsp_parm_whammy_default,
     (void *) &dsp_parm_octave_default,
-    (void *) &dsp_parm_sine_synth_default
+    (void *) &dsp_parm_sine_synth_default,
+    (void *) &dsp_parm_looper_default,
+    (void *) &dsp_parm_reverb_default,
+    (void *) &dsp_parm_cabinet_default,
+    (void *) &dsp_parm_waveshaper_default
+};
+
+const uint16_t dsp_parm_struct_size[] =
+{
+    sizeof(dsp_parm_none),
+    sizeof(dsp_parm_noisegate),
+    sizeof(dsp_parm_delay),
+    sizeof(dsp_parm_room),
+    sizeof(dsp_parm_combine),
+    sizeof(dsp_parm_bandpass),
+    sizeof(dsp_parm_lowpass),
+    sizeof(dsp_parm_highpass),
+    sizeof(dsp_parm_allpass),
+    sizeof(dsp_parm_tremolo),
+    sizeof(dsp_parm_vibrato),
+    sizeof(dsp_parm_wah),
+    sizeof(dsp_parm_autowah),
+    sizeof(dsp_parm_envelope),
+    sizeof(dsp_parm_distortion),
+    sizeof(dsp_parm_overdrive),
+    sizeof(dsp_parm_compressor),
+    sizeof(dsp_parm_ring),
+    sizeof(dsp_parm_flange),
+    sizeof(dsp_parm_chorus),
+    sizeof(dsp_parm_phaser),
+    sizeof(dsp_parm_backwards),
+    sizeof(dsp_parm_pitchshift),
+    sizeof(dsp_parm_whammy),
+    sizeof(dsp_parm_octave),
+    sizeof(dsp_parm_sine_synth),
+    sizeof(dsp_parm_looper),
+    sizeof(dsp_parm_reverb),
+    sizeof(dsp_parm_cabinet),
+    sizeof(dsp_parm_waveshaper)
 };
 
+/* the defaults of a type, the rest of the union zeroed */
+void dsp_parm_copy_defaults(dsp_parm *dp, dsp_unit_type dut)
+{
+    memset((void *)dp, '\000', sizeof(dsp_parm));
+    memcpy((void *)dp, dsp_parm_struct_defaults[dut], dsp_parm_struct_size[dut]);
+    dp->dtn.dut = dut;
+}
+
 /********************* DSP PROCESS STRUCTURE *******************************************/
 
 uint32_t dsp_read_value_prec(void *v, int prec)
@@ -1530,29 +2703,26 @@ void dsp_set_value_prec(void *v, int prec, uint32_t val)
 
 }
 
+static void dsp_parm_defaults(dsp_parm *dp, int dsp_unit_number, dsp_unit_type dut)
+{
+    dsp_parm_copy_defaults(dp, dut);
+    dp->dtn.source_unit = dsp_unit_number + 1;
+}
+
+/* the unit's state is cleared when the new configuration is first run if
+   the type has changed */
 void dsp_unit_initialize(int dsp_unit_number, dsp_unit_type dut)
 {
-    dsp_unit *du;
-    dsp_parm *dp;
-    
     if (dut >= DSP_TYPE_MAX_ENTRY) return;
     
-    du = dsp_unit_entry(dsp_unit_number);
-    dp = dsp_parm_entry(dsp_unit_number);
-    
-    dsp_unit_struct_zero(du);
-    memcpy((void *)dp, dsp_parm_struct_defaults[dut], sizeof(dsp_parm));
-    dp->dtn.source_unit = dsp_unit_number + 1;
-    DMB();
-    dp->dtn.dut = dut;
-    DMB();
+    dsp_parm_defaults(&dsp_bank_edit()[dsp_unit_number], dsp_unit_number, dut);
+    dsp_bank_commit();
 }
 
+/* the unit is cleared the next time it is run */
 void dsp_unit_reset(int dsp_unit_number)
 {
-    dsp_unit *du = dsp_unit_entry(dsp_unit_number);
-    
-    dsp_unit_struct_zero(du);
+    dsp_bank_active->engine->unit_epoch[dsp_unit_number] = 0;
 }
 
 void dsp_unit_reset_all(void)
@@ -1561,28 +2731,686 @@ void dsp_unit_reset_all(void)
         dsp_unit_reset(i);
 }
 
+uint32_t dsp_type_cost[DSP_TYPE_MAX_ENTRY];
+uint32_t dsp_chain_budget;
+volatile uint dsp_split_unit;
+
+static uint32_t dsp_unit_oversample(const dsp_parm *dp)
+{
+    switch (dp->dtn.dut)
+    {
+        case DSP_TYPE_DISTORTION: return dsp_oversample_ratio(dp->dtdist.oversample);
+        case DSP_TYPE_OVERDRIVE:  return dsp_oversample_ratio(dp->dtovr.oversample);
+        case DSP_TYPE_OCTAVE:     return dsp_oversample_ratio(dp->dtoct.oversample);
+        case DSP_TYPE_WAVESHAPER: return dsp_oversample_ratio(dp->dtshape.oversample);
+        default:                  return 1;
+    }
+}
+
+uint32_t dsp_unit_cost(const dsp_parm *dp)
+{
+    dsp_unit_type dut = dp->dtn.dut;
+    if (dut >= DSP_TYPE_MAX_ENTRY) return 0;
+    uint32_t ratio = dsp_unit_oversample(dp);
+    return dsp_type_cost[dut] * ratio + dsp_oversample_cost[dsp_oversample_index(ratio)];
+}
+
+/* a unit replaced starts with the default parameters, without oversampling */
+static uint32_t dsp_chain_cost_range(const dsp_parm *dps, uint first, uint last, uint replace_unit, dsp_unit_type replace_dut)
+{
+    uint32_t cost = 0;
+    for (uint unit_no=first;unit_no<last;unit_no++)
+    {
+        if (unit_no != replace_unit)
+            cost += dsp_unit_cost(&dps[unit_no]);
+        else if (replace_dut < DSP_TYPE_MAX_ENTRY)
+            cost += dsp_type_cost[replace_dut];
+    }
+    return cost;
+}
+
+/* with the chain split the cost is that of the busier core */
+static uint32_t dsp_chain_cost_split(const dsp_parm *dps, uint replace_unit, dsp_unit_type replace_dut)
+{
+    uint split = dsp_split_unit;
+    if (split == 0)
+        return dsp_chain_cost_range(dps, 0, MAX_DSP_UNITS, replace_unit, replace_dut);
+    uint32_t cost0 = dsp_chain_cost_range(dps, 0, split, replace_unit, replace_dut);
+    uint32_t cost1 = dsp_chain_cost_range(dps, split, MAX_DSP_UNITS, replace_unit, replace_dut);
+    return (cost0 > cost1) ? cost0 : cost1;
+}
+
+uint32_t dsp_chain_cost(const dsp_parm *dps)
+{
+    return dsp_chain_cost_split(dps, MAX_DSP_UNITS, DSP_TYPE_NONE);
+}
+
+uint32_t dsp_chain_cost_replace(uint dsp_unit_number, dsp_unit_type dut)
+{
+    return dsp_chain_cost_split(dsp_bank_active->parms, dsp_unit_number, dut);
+}
+
+bool dsp_chain_fits(uint32_t cost)
+{
+    return (dsp_chain_budget == 0) || (cost <= dsp_chain_budget);
+}
+
+bool dsp_chain_splits(const dsp_parm *dps, uint split)
+{
+    for (uint unit_no=0;unit_no<split;unit_no++)
+    {
+        const dsp_parm *dp = &dps[unit_no];
+        if (dp->dtn.source_unit > (split+1)) return false;
+        if (dp->dtn.dut != DSP_TYPE_COMBINE) continue;
+        for (uint i=0;i<(sizeof(dp->dtcombine.unit)/sizeof(dp->dtcombine.unit[0]));i++)
+            if ((dp->dtcombine.amplitude[i] != 0) && (dp->dtcombine.unit[i] > (split+1))) return false;
+    }
+    return true;
+}
+
+/* bytes of the arena a unit takes when it is run */
+static uint32_t dsp_unit_memory(const dsp_parm *dp)
+{
+    dsp_unit_type dut = dp->dtn.dut;
+    if (dut >= DSP_TYPE_MAX_ENTRY) return 0;
+    uint32_t bytes = dsp_unit_state_size(dut);
+    if (dtline[dut] != NULL) bytes += dtline[dut](dp) * sizeof(int16_t);
+    return (bytes + (DSP_UNIT_ALIGN-1)) & ~(DSP_UNIT_ALIGN-1);
+}
+
+uint32_t dsp_chain_memory(const dsp_parm *dps)
+{
+    dsp_schedule ds;
+    uint32_t bytes = 0;
+
+    dsp_schedule_build(&ds, dps);
+    for (uint i=0;i<ds.count;i++)
+        bytes += dsp_unit_memory(&dps[ds.entry[i].unit_no]);
+    return bytes;
+}
+
+uint32_t dsp_chain_memory_replace(uint dsp_unit_number, dsp_unit_type dut)
+{
+    dsp_parm dps[MAX_DSP_UNITS];
+
+    memcpy((void *)dps, (void *)dsp_bank_active->parms, sizeof(dps));
+    if ((dsp_unit_number < MAX_DSP_UNITS) && (dut < DSP_TYPE_MAX_ENTRY))
+        dsp_parm_defaults(&dps[dsp_unit_number], dsp_unit_number, dut);
+    return dsp_chain_memory(dps);
+}
+
+bool dsp_chain_memory_fits(uint32_t bytes)
+{
+    return bytes <= DSP_ARENA_SIZE;
+}
+
 static inline int32_t dsp_process(int32_t sample, dsp_parm *dp, dsp_unit *du)
 {
     return dtp[(int)dp->dtn.dut](sample, dp, du);
 }
 
+static dsp_bank dsp_banks[2];
+dsp_bank * volatile dsp_bank_active = &dsp_banks[0];
+static volatile bool dsp_bank_editing;
+static uint32_t dsp_bank_epoch;
+
+/* unit numbers are 1 based, 0 is only found in units not yet initialized */
+static inline uint dsp_schedule_result_index(uint32_t unit)
+{
+    return ((unit == 0) || (unit > MAX_DSP_UNITS)) ? 0 : (unit-1);
+}
+
+void dsp_schedule_build(dsp_schedule *ds, const dsp_parm *dps)
+{
+    bool live[MAX_DSP_UNITS+1];
+    bool keep[MAX_DSP_UNITS+1];
+    uint8_t alias[MAX_DSP_UNITS+1];
+    uint8_t stack[MAX_DSP_UNITS+1];
+    uint sp = 0;
+
+    /* results that reach the output, index 0 is the input */
+    memset(live, 0, sizeof(live));
+    memset(keep, 0, sizeof(keep));
+    ds->reads_back = false;
+    live[MAX_DSP_UNITS] = true;
+    stack[sp++] = MAX_DSP_UNITS;
+    while (sp > 0)
+    {
+        uint r = stack[--sp];
+        if (r == 0) continue;
+        const dsp_parm *dp = &dps[r-1];
+        uint src = dsp_schedule_result_index(dp->dtn.source_unit);
+        if (!live[src])
+        {
+            live[src] = true;
+            stack[sp++] = src;
+        }
+        /* an earlier unit reads this one's previous result */
+        if (src >= r) keep[src] = ds->reads_back = true;
+        if (dp->dtn.dut != DSP_TYPE_COMBINE) continue;
+        for (uint i=0;i<(sizeof(dp->dtcombine.unit)/sizeof(dp->dtcombine.unit[0]));i++)
+        {
+            if (dp->dtcombine.amplitude[i] == 0) continue;
+            uint u = dsp_schedule_result_index(dp->dtcombine.unit[i]);
+            keep[u] = true;
+            if (u >= r) ds->reads_back = true;
+            if (!live[u])
+            {
+                live[u] = true;
+                stack[sp++] = u;
+            }
+        }
+    }
+
+    /* None units read later than themselves are passed over */
+    alias[0] = 0;
+    for (uint r=1;r<=MAX_DSP_UNITS;r++)
+    {
+        const dsp_parm *dp = &dps[r-1];
+        uint src = dsp_schedule_result_index(dp->dtn.source_unit);
+        alias[r] = r;
+        if (live[r] && (!keep[r]) && (dp->dtn.dut == DSP_TYPE_NONE) && (src < r))
+            alias[r] = alias[src];
+    }
+
+    ds->count = 0;
+    for (uint r=1;r<=MAX_DSP_UNITS;r++)
+    {
+        if ((!live[r]) || (alias[r] != r)) continue;
+        dsp_schedule_entry *dse = &ds->entry[ds->count++];
+        dse->unit_no = r-1;
+        dse->source = alias[dsp_schedule_result_index(dps[r-1].dtn.source_unit)];
+    }
+    ds->output = alias[MAX_DSP_UNITS];
+}
+
+static inline dsp_bank *dsp_bank_inactive(void)
+{
+    return (dsp_bank_active == &dsp_banks[0]) ? &dsp_banks[1] : &dsp_banks[0];
+}
+
+/* opens an edit if one is not open, starting from the active parameters */
+dsp_parm *dsp_bank_edit(void)
+{
+    dsp_bank *db = dsp_bank_inactive();
+    if (!dsp_bank_editing)
+    {
+        dsp_bank_editing = true;
+        DMB();
+        memcpy((void *)db->parms, (void *)dsp_bank_active->parms, sizeof(db->parms));
+    }
+    return db->parms;
+}
+
+/* makes the open edit the active bank, its schedule must be built */
+static void dsp_bank_publish(void)
+{
+    dsp_bank *db = dsp_bank_inactive();
+    dsp_overlay_load(db->parms);
+    DMB();
+    dsp_bank_active = db;
+    DMB();
+    dsp_bank_editing = false;
+}
+
+void dsp_bank_abort(void)
+{
+    dsp_bank_editing = false;
+}
+
+/* The outgoing chain while presets are crossfaded.  The audio path runs it
+   while pos < total, gains are fractions of DSP_CROSSFADE_UNITY. */
+
+#define DSP_CROSSFADE_UNITY 32768
+
+typedef struct
+{
+    dsp_bank bank;
+    uint32_t fade;
+    uint32_t tail;
+    uint32_t pos;
+    volatile uint32_t total;
+} dsp_crossfade_state;
+
+static dsp_crossfade_state dsp_crossfade;
+uint32_t dsp_crossfade_ms = 30;
+uint32_t dsp_crossfade_tail_ms = 0;
+volatile uint32_t dsp_crossfade_worst;
+
+bool dsp_crossfade_running(void)
+{
+    return dsp_crossfade.total != 0;
+}
+
+typedef struct
+{
+    uint32_t offset;
+    uint32_t size;
+} dsp_arena_span;
+
+#define DSP_ARENA_SPANS (3*MAX_DSP_UNITS)
+
+static uint dsp_arena_spans_add(dsp_arena_span *spans, uint n, const dsp_bank *db)
+{
+    if (db == NULL) return n;
+    for (uint unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+    {
+        if (db->unit_size[unit_no] == 0) continue;
+        spans[n].offset = db->unit_offset[unit_no];
+        spans[n].size = db->unit_size[unit_no];
+        n++;
+    }
+    return n;
+}
+
+/* the lowest offset at which size bytes overlap none of the spans */
+static bool dsp_arena_fit(const dsp_arena_span *spans, uint n, uint32_t size, uint32_t *offset)
+{
+    uint32_t o = 0;
+    bool moved;
+    do
+    {
+        moved = false;
+        for (uint i=0;i<n;i++)
+        {
+            if ((o < (spans[i].offset + spans[i].size)) && (spans[i].offset < (o + size)))
+            {
+                o = spans[i].offset + spans[i].size;
+                moved = true;
+            }
+        }
+    } while (moved);
+    *offset = o;
+    return (o + size) <= DSP_ARENA_SIZE;
+}
+
+/* Places the units of db that are run.  A unit of keep with the same type
+   and size stays where it is with its epoch, the others are placed clear
+   of it and of the units of avoid and take epoch. */
+static bool dsp_arena_layout(dsp_bank *db, const dsp_bank *keep, const dsp_bank *avoid1, const dsp_bank *avoid2, uint32_t epoch)
+{
+    dsp_arena_span spans[DSP_ARENA_SPANS];
+    const dsp_schedule *ds = &db->schedule;
+    bool kept[MAX_DSP_UNITS];
+    uint n = 0;
+
+    memset((void *)db->unit_size, '\000', sizeof(db->unit_size));
+    for (uint unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+        db->unit_epoch[unit_no] = epoch;
+    n = dsp_arena_spans_add(spans, n, avoid1);
+    n = dsp_arena_spans_add(spans, n, avoid2);
+    for (uint i=0;i<ds->count;i++)
+    {
+        uint unit_no = ds->entry[i].unit_no;
+        uint32_t size = dsp_unit_memory(&db->parms[unit_no]);
+        kept[i] = (keep != NULL) && (keep->unit_size[unit_no] == size) &&
+                  (keep->parms[unit_no].dtn.dut == db->parms[unit_no].dtn.dut);
+        if (!kept[i]) continue;
+        db->unit_offset[unit_no] = keep->unit_offset[unit_no];
+        db->unit_size[unit_no] = size;
+        db->unit_epoch[unit_no] = keep->unit_epoch[unit_no];
+        spans[n].offset = db->unit_offset[unit_no];
+        spans[n++].size = size;
+    }
+    for (uint i=0;i<ds->count;i++)
+    {
+        uint unit_no = ds->entry[i].unit_no;
+        if (kept[i]) continue;
+        uint32_t size = dsp_unit_memory(&db->parms[unit_no]);
+        if (!dsp_arena_fit(spans, n, size, &db->unit_offset[unit_no])) return false;
+        db->unit_size[unit_no] = size;
+        spans[n].offset = db->unit_offset[unit_no];
+        spans[n++].size = size;
+    }
+    return true;
+}
+
+/* Lays out the open edit.  The units that change are first placed clear of
+   the running chains, so these do not write over them before the switch,
+   and if there is not room for that, over the units that are about to be
+   replaced.  As a last resort the largest units are set to None. */
+static void dsp_bank_layout(dsp_bank *db, const dsp_bank *cur)
+{
+    dsp_bank *fade = dsp_crossfade_running() ? &dsp_crossfade.bank : NULL;
+
+    dsp_bank_epoch++;
+    dsp_schedule_build(&db->schedule, db->parms);
+    if (dsp_arena_layout(db, cur, cur, fade, dsp_bank_epoch)) return;
+    if (dsp_arena_layout(db, cur, NULL, fade, dsp_bank_epoch)) return;
+    if (dsp_arena_layout(db, NULL, NULL, fade, dsp_bank_epoch)) return;
+    dsp_crossfade.total = 0;
+    DMB();
+    while (!dsp_arena_layout(db, NULL, NULL, NULL, dsp_bank_epoch))
+    {
+        uint largest = 0;
+        uint32_t largest_size = 0;
+        for (uint i=0;i<db->schedule.count;i++)
+        {
+            uint unit_no = db->schedule.entry[i].unit_no;
+            uint32_t size = dsp_unit_memory(&db->parms[unit_no]);
+            if (size > largest_size)
+            {
+                largest = unit_no;
+                largest_size = size;
+            }
+        }
+        dsp_parm_defaults(&db->parms[largest], largest, DSP_TYPE_NONE);
+        dsp_schedule_build(&db->schedule, db->parms);
+    }
+}
+
+void dsp_bank_commit(void)
+{
+    dsp_bank *db = dsp_bank_inactive();
+    const dsp_bank *cur = dsp_bank_active;
+
+    if (!dsp_bank_editing) return;
+    dsp_bank_layout(db, cur);
+    db->engine = cur->engine;
+    dsp_bank_publish();
+}
+
+/* the unit's state, cleared first if its type or memory changed since it
+   last ran on the engine */
+static inline dsp_unit *dsp_bank_unit(const dsp_bank *db, uint dsp_unit_number)
+{
+    dsp_unit *du = (dsp_unit *)(((uint8_t *)dsp_arena) + db->unit_offset[dsp_unit_number]);
+    uint32_t epoch = db->unit_epoch[dsp_unit_number];
+    if (db->engine->unit_epoch[dsp_unit_number] != epoch)
+    {
+        dsp_unit_type dut = db->parms[dsp_unit_number].dtn.dut;
+        uint32_t state_size = dsp_unit_state_size(dut);
+        dsp_unit_struct_zero(du, dut);
+        du->line.samples = (int16_t *)(((uint8_t *)du) + state_size);
+        du->line.size = (db->unit_size[dsp_unit_number] - state_size) / sizeof(int16_t);
+        db->engine->unit_epoch[dsp_unit_number] = epoch;
+    }
+    return du;
+}
+
+dsp_unit *dsp_unit_entry(uint e)
+{
+    const dsp_bank *db = dsp_bank_active;
+    if ((e >= MAX_DSP_UNITS) || (db->unit_size[e] == 0)) return NULL;
+    return dsp_bank_unit(db, e);
+}
+
+dsp_unit *dsp_arena_scratch(const dsp_parm *dp)
+{
+    dsp_unit_type dut = dp->dtn.dut;
+    uint32_t size = dsp_unit_memory(dp);
+    dsp_unit *du = (dsp_unit *)dsp_arena;
+    if (size > DSP_ARENA_SIZE) return NULL;
+
+    dsp_crossfade.total = 0;
+    memset((void *)dsp_engines[0].unit_epoch, '\000', sizeof(dsp_engines[0].unit_epoch));
+    memset((void *)dsp_engines[1].unit_epoch, '\000', sizeof(dsp_engines[1].unit_epoch));
+    dsp_unit_struct_zero(du, dut);
+    du->line.samples = (int16_t *)(((uint8_t *)du) + dsp_unit_state_size(dut));
+    du->line.size = (size - dsp_unit_state_size(dut)) / sizeof(int16_t);
+    return du;
+}
+
+static void dsp_control_bank_unit(dsp_bank *db, uint dsp_unit_number)
+{
+    dsp_parm *dp = &db->parms[dsp_unit_number];
+    dsp_unit_type dut = dp->dtn.dut;
+    if ((dut < DSP_TYPE_MAX_ENTRY) && (dtcp[dut] != NULL))
+        dtcp[dut](dp, dsp_bank_unit(db, dsp_unit_number));
+}
+
+static void dsp_control_bank(dsp_bank *db)
+{
+    const dsp_schedule *ds = &db->schedule;
+    for (uint i=0;i<ds->count;i++)
+        dsp_control_bank_unit(db, ds->entry[i].unit_no);
+}
+
+void dsp_control_unit(uint dsp_unit_number)
+{
+    dsp_control_bank_unit(dsp_bank_active, dsp_unit_number);
+}
+
+/* The outgoing chain is run only once the incoming bank is active, on the
+   other engine */
+static inline bool dsp_crossfade_active(const dsp_bank *db)
+{
+    return (dsp_crossfade.total != 0) && (dsp_crossfade.bank.engine != db->engine);
+}
+
+/* Reads the controls and recomputes the coefficients of the units that are
+   run, in the outgoing chain too while it is crossfaded so that its
+   modulation and pedals keep moving and a Cabinet keeps its tail.  It must
+   not be called from two places at once, the audio path may interrupt it
+   at any point. */
+void dsp_control_update(void)
+{
+    dsp_bank *db = dsp_bank_active;
+    if (dsp_bank_editing) return;
+    dsp_control_bank(db);
+    if (dsp_crossfade_active(db))
+        dsp_control_bank(&dsp_crossfade.bank);
+}
+
+bool dsp_bank_commit_crossfade(void)
+{
+    dsp_bank *db = dsp_bank_inactive();
+    dsp_engine *engine;
+
+    if ((!dsp_bank_editing) || (dsp_crossfade_ms == 0) || (dsp_split_unit != 0)) return false;
+    if (!dsp_chain_fits(dsp_chain_cost(dsp_bank_active->parms) + dsp_chain_cost(db->parms))) return false;
+
+    /* a crossfade still running is cut short, its engine and memory are
+       reused */
+    dsp_crossfade.total = 0;
+    DMB();
+
+    /* the incoming chain starts from cleared state on the other engine, in
+       memory clear of the outgoing chain, and its controls are applied
+       before the audio path first runs it */
+    dsp_bank_epoch++;
+    dsp_schedule_build(&db->schedule, db->parms);
+    if (!dsp_arena_layout(db, NULL, dsp_bank_active, NULL, dsp_bank_epoch)) return false;
+    engine = (dsp_bank_active->engine == &dsp_engines[0]) ? &dsp_engines[1] : &dsp_engines[0];
+    memcpy((void *)&dsp_crossfade.bank, (void *)dsp_bank_active, sizeof(dsp_bank));
+    memset((void *)engine, '\000', sizeof(dsp_engine));
+    db->engine = engine;
+    dsp_control_bank(db);
+
+    dsp_crossfade.fade = (dsp_crossfade_ms * DSP_SAMPLERATE) / 1000;
+    dsp_crossfade.tail = (dsp_crossfade_tail_ms * DSP_SAMPLERATE) / 1000;
+    dsp_crossfade.pos = 0;
+    DMB();
+    dsp_crossfade.total = dsp_crossfade.fade + dsp_crossfade.tail;
+    dsp_bank_publish();
+    return true;
+}
+
+/* gains of the incoming output, the outgoing input and the outgoing output
+   at the current position, the position is moved on one sample.  Past the
+   end the old chain is silent. */
+static void dsp_crossfade_gains(int32_t *in_out, int32_t *out_in, int32_t *out_out)
+{
+    dsp_crossfade_state *dcf = &dsp_crossfade;
+    uint32_t left = (dcf->pos < dcf->total) ? (dcf->total - dcf->pos) : 0;
+    int32_t g = (dcf->pos >= dcf->fade) ? DSP_CROSSFADE_UNITY : ((int32_t)((dcf->pos * DSP_CROSSFADE_UNITY) / dcf->fade));
+
+    *in_out = g;
+    if (dcf->tail == 0)
+    {
+        *out_in = DSP_CROSSFADE_UNITY;
+        *out_out = DSP_CROSSFADE_UNITY - g;
+    } else
+    {
+        *out_in = DSP_CROSSFADE_UNITY - g;
+        *out_out = (left >= dcf->fade) ? DSP_CROSSFADE_UNITY : ((int32_t)((left * DSP_CROSSFADE_UNITY) / dcf->fade));
+    }
+    if (left != 0) dcf->pos++;
+}
+
+static inline void dsp_crossfade_end(void)
+{
+    if (dsp_crossfade.pos >= dsp_crossfade.total) dsp_crossfade.total = 0;
+}
+
+static inline int32_t dsp_crossfade_mix(int32_t in_sample, int32_t in_out, int32_t out_sample, int32_t out_out)
+{
+    int32_t sample = (in_sample * in_out + out_sample * out_out) / DSP_CROSSFADE_UNITY;
+    if (sample > (ADC_PREC_VALUE/2-1)) sample=ADC_PREC_VALUE/2-1;
+    if (sample < (-ADC_PREC_VALUE/2)) sample=-ADC_PREC_VALUE/2;
+    return sample;
+}
+
+static inline void dsp_crossfade_timed(uint32_t start)
+{
+    uint32_t ticks = dsp_bench_elapsed(start, dsp_bench_ticks());
+    if (ticks > dsp_crossfade_worst) dsp_crossfade_worst = ticks;
+}
+
 void initialize_dsp(void)
 {
     initialize_sample_circ_buf();
+    dsp_loop_clear();
+    memset((void *)dsp_banks, '\000', sizeof(dsp_banks));
+    memset((void *)dsp_engines, '\000', sizeof(dsp_engines));
+    dsp_crossfade.total = 0;
+    dsp_bank_editing = false;
+    dsp_banks[0].engine = &dsp_engines[0];
+    dsp_bank_active = &dsp_banks[0];
+    dsp_parm *dps = dsp_bank_edit();
     for (int unit_number=0;unit_number<MAX_DSP_UNITS;unit_number++) 
-        dsp_unit_initialize(unit_number, DSP_TYPE_NONE);
+        dsp_parm_defaults(&dps[unit_number], unit_number, DSP_TYPE_NONE);
+    dsp_bank_commit();
 }
 
-int32_t dsp_process_all_units(int32_t sample)
+/* runs the scheduled units numbered first to last-1 with unit_result[0]
+   the input of the chain */
+int32_t __not_in_flash_func(dsp_process_units)(dsp_bank *db, int32_t *unit_result, uint first, uint last)
 {
-    dsp_unit_result[0] = sample;
-    for (int unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+    const dsp_schedule *ds = &db->schedule;
+    dsp_core()->unit_result = unit_result;
+    for (uint n=0;n<ds->count;n++)
     {
-        dsp_unit *du = dsp_unit_entry(unit_no);
-        dsp_parm *dp = dsp_parm_entry(unit_no);
-        dsp_unit_result[unit_no+1] = dsp_process(dsp_unit_result[dp->dtn.source_unit-1], dp, du);
+        const dsp_schedule_entry *dse = &ds->entry[n];
+        if (dse->unit_no < first) continue;
+        if (dse->unit_no >= last) break;
+        dsp_unit *du = dsp_bank_unit(db, dse->unit_no);
+        dsp_parm *dp = &db->parms[dse->unit_no];
+        unit_result[dse->unit_no+1] = dsp_process(unit_result[dse->source], dp, du);
     }
-    return dsp_unit_result[MAX_DSP_UNITS];
+    return unit_result[ds->output];
+}
+
+static inline int32_t dsp_process_bank(dsp_bank *db, int32_t sample)
+{
+    db->engine->unit_result[0] = sample;
+    return dsp_process_units(db, db->engine->unit_result, 0, MAX_DSP_UNITS);
+}
+
+int32_t __not_in_flash_func(dsp_process_all_units)(int32_t sample)
+{
+    dsp_bank *db = dsp_bank_active;
+
+    if (!dsp_crossfade_active(db))
+        return dsp_process_bank(db, sample);
+
+    uint32_t start = dsp_bench_ticks();
+    int32_t in_out, out_in, out_out;
+    dsp_crossfade_gains(&in_out, &out_in, &out_out);
+    int32_t out_sample = dsp_process_bank(&dsp_crossfade.bank, (sample * out_in) / DSP_CROSSFADE_UNITY);
+    sample = dsp_crossfade_mix(dsp_process_bank(db, sample), in_out, out_sample, out_out);
+    dsp_crossfade_end();
+    dsp_crossfade_timed(start);
+    return sample;
+}
+
+int16_t __not_in_flash_func(dsp_process_sample)(int16_t sample)
+{
+    insert_sample_circ_buf_clean(sample);
+    return dsp_process_all_units(sample);
+}
+
+/* runs the bank over the block in row 0 of its engine's block_result and
+   returns the row holding the output.  A chain that reads back a sample
+   (feedback, or a Combine of a later unit) is run one sample at a time as
+   without blocks, so the loop stays one sample long. */
+static const int32_t *__not_in_flash_func(dsp_process_block_bank)(dsp_bank *db, uint n)
+{
+    dsp_core_state *dcs = dsp_core();
+    const dsp_schedule *ds = &db->schedule;
+    int32_t (*block_result)[DSP_BLOCK_MAX] = db->engine->block_result;
+
+    if (ds->reads_back)
+    {
+        int32_t *row = block_result[0];
+        for (uint i=0;i<n;i++)
+        {
+            dcs->clean_pos = (sample_circ_buf_clean_offset - (n-1-i)) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1);
+            db->engine->unit_result[0] = row[i];
+            row[i] = dsp_process_units(db, db->engine->unit_result, 0, MAX_DSP_UNITS);
+        }
+        dcs->clean_pos = sample_circ_buf_clean_offset;
+        return row;
+    }
+    dcs->unit_result = db->engine->unit_result;
+    dcs->block_result = block_result;
+    for (uint e=0;e<ds->count;e++)
+    {
+        const dsp_schedule_entry *dse = &ds->entry[e];
+        dsp_unit *du = dsp_bank_unit(db, dse->unit_no);
+        dsp_parm *dp = &db->parms[dse->unit_no];
+        const int32_t *in = block_result[dse->source];
+        int32_t *out = block_result[dse->unit_no+1];
+        dsp_type_process_block *dtpbf = dtpb[(int)dp->dtn.dut];
+        if (dtpbf != NULL)
+        {
+            dtpbf(out, in, n, dp, du);
+            continue;
+        }
+        dsp_type_process *dtpf = dtp[(int)dp->dtn.dut];
+        for (uint i=0;i<n;i++)
+        {
+            dcs->clean_pos = (sample_circ_buf_clean_offset - (n-1-i)) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1);
+            out[i] = dtpf(in[i], dp, du);
+        }
+    }
+    dcs->clean_pos = sample_circ_buf_clean_offset;
+    return block_result[ds->output];
+}
+
+void __not_in_flash_func(dsp_process_block)(int16_t *samples, uint n)
+{
+    dsp_bank *db = dsp_bank_active;
+    int32_t *in_row = db->engine->block_result[0];
+
+    for (uint i=0;i<n;i++)
+    {
+        insert_sample_circ_buf_clean(samples[i]);
+        in_row[i] = samples[i];
+    }
+    if (!dsp_crossfade_active(db))
+    {
+        const int32_t *out_row = dsp_process_block_bank(db, n);
+        for (uint i=0;i<n;i++)
+            samples[i] = out_row[i];
+        return;
+    }
+
+    uint32_t start = dsp_bench_ticks();
+    int32_t in_out[DSP_BLOCK_MAX], out_out[DSP_BLOCK_MAX];
+    int32_t *fade_row = dsp_crossfade.bank.engine->block_result[0];
+    for (uint i=0;i<n;i++)
+    {
+        int32_t out_in;
+        dsp_crossfade_gains(&in_out[i], &out_in, &out_out[i]);
+        fade_row[i] = (samples[i] * out_in) / DSP_CROSSFADE_UNITY;
+    }
+    dsp_crossfade_end();
+    const int32_t *fade_out_row = dsp_process_block_bank(&dsp_crossfade.bank, n);
+    const int32_t *out_row = dsp_process_block_bank(db, n);
+    for (uint i=0;i<n;i++)
+        samples[i] = dsp_crossfade_mix(out_row[i], in_out[i], fade_out_row[i], out_out[i]);
+    dsp_crossfade_timed(start);
 }
 
 dsp_unit_type dsp_unit_get_type(uint dsp_unit_number)
@@ -1606,6 +3434,39 @@ const dsp_parm_configuration_entry *dsp_unit_get_configuration_entry(uint dsp_un
     return NULL;
 }
 
+bool dsp_parm_value_valid(const dsp_parm_configuration_entry *dpce, uint32_t value)
+{
+    if ((value < dpce->minval) || (value > dpce->maxval)) return false;
+    return (dpce->allowed == 0) || ((value < 32) && ((dpce->allowed & (1u << value)) != 0));
+}
+
+uint dsp_parms_validate(dsp_parm *dps)
+{
+    uint replaced = 0;
+    for (uint unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+    {
+        dsp_parm *dp = &dps[unit_no];
+        if (dp->dtn.dut >= DSP_TYPE_MAX_ENTRY)
+        {
+            dsp_parm_defaults(dp, unit_no, DSP_TYPE_NONE);
+            replaced++;
+            continue;
+        }
+        dsp_unit_type dut = dp->dtn.dut;
+        const uint8_t *defaults = (const uint8_t *) dsp_parm_struct_defaults[dut];
+        for (const dsp_parm_configuration_entry *dpce_l = dpce[dut];dpce_l->desc != NULL;dpce_l++)
+        {
+            void *v = ((uint8_t *)dp) + dpce_l->offset;
+            uint32_t value = dsp_read_value_prec(v, dpce_l->size);
+            uint32_t def = dsp_read_value_prec((void *)(defaults + dpce_l->offset), dpce_l->size);
+            if ((value == def) || dsp_parm_value_valid(dpce_l, value)) continue;
+            dsp_set_value_prec(v, dpce_l->size, def);
+            replaced++;
+        }
+    }
+    return replaced;
+}
+
 bool dsp_unit_set_value(uint dsp_unit_number, const char *desc, uint32_t value)
 {
     if (dsp_unit_number >= MAX_DSP_UNITS) return NULL;
@@ -1615,9 +3476,17 @@ bool dsp_unit_set_value(uint dsp_unit_number, const char *desc, uint32_t value)
     {
         if (!strcmp(dpce_l->desc,desc))
         {
-           if ((value >= dpce_l->minval) && (value <= dpce_l->maxval))
+           if (dsp_parm_value_valid(dpce_l, value))
            {
-                dsp_set_value_prec((void *)(((uint8_t *)dsp_parm_entry(dsp_unit_number)) + dpce_l->offset), dpce_l->size, value); 
+                dsp_parm *dps = dsp_bank_edit();
+                dsp_set_value_prec((void *)(((uint8_t *)&dps[dsp_unit_number]) + dpce_l->offset), dpce_l->size, value); 
+                if ((!dsp_chain_fits(dsp_chain_cost(dps))) || (!dsp_chain_memory_fits(dsp_chain_memory(dps))) ||
+                    (!dsp_chain_splits(dps, dsp_split_unit)))
+                {
+                    dsp_bank_abort();
+                    return false;
+                }
+                dsp_bank_commit();
                 return true;
            } else return false;
             
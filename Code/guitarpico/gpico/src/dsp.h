@@ -38,39 +38,265 @@ extern "C"
 
 #define MAX_DSP_UNITS 16
 
-#define MATH_PI_F 3.1415926535f
-
 #define SAMPLE_CIRC_BUF_SIZE (1u<<15)
 #define SAMPLE_CIRC_BUF_CLEAN_SIZE (1u<<15)
+/* the longest Delay, kept as ADPCM past SAMPLE_CIRC_BUF_SIZE */
+#define DSP_DELAY_ADPCM_MAX (SAMPLE_CIRC_BUF_SIZE*4)
 
-extern int16_t sample_circ_buf[];
 extern int16_t sample_circ_buf_clean[];
-extern int sample_circ_buf_offset;
 extern int sample_circ_buf_clean_offset;
 
-inline void insert_sample_circ_buf(int16_t insert_val)
+/* Each core's view of the sample it is working on.  The chain may be split
+   across both cores (dsp_split_unit), and then core 1 runs the end of the
+   chain on an older sample than core 0.
+
+   unit_result  the unit_result array of that sample, Combine reads it
+   block_result in block mode the block_result array, Combine reads it
+   clean_pos    the index of that sample in sample_circ_buf_clean, in
+                block mode the whole input block is in sample_circ_buf_clean
+                before the first unit runs */
+#define DSP_BLOCK_MAX 32
+
+typedef struct
 {
-    sample_circ_buf_offset = (sample_circ_buf_offset+1) & (SAMPLE_CIRC_BUF_SIZE-1);
-    sample_circ_buf[sample_circ_buf_offset] = insert_val;
-};
+    int32_t *unit_result;
+    int clean_pos;
+    int32_t (*block_result)[DSP_BLOCK_MAX];
+} dsp_core_state;
+
+extern dsp_core_state dsp_cores[2];
 
-inline void insert_sample_circ_buf_clean(int16_t insert_val)
+static inline dsp_core_state *dsp_core(void)
+{
+    return &dsp_cores[CORE_NUM()];
+}
+
+/* the newest input becomes the sample being processed */
+static inline void insert_sample_circ_buf_clean(int16_t insert_val)
 {
     sample_circ_buf_clean_offset = (sample_circ_buf_clean_offset+1) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1);
     sample_circ_buf_clean[sample_circ_buf_clean_offset] = insert_val;
+    dsp_core()->clean_pos = sample_circ_buf_clean_offset;
 };
 
-inline int16_t sample_circ_buf_value(int offset)
+static inline int16_t sample_circ_buf_clean_value(int offset)
 {
-    return sample_circ_buf[(sample_circ_buf_offset - offset) & (SAMPLE_CIRC_BUF_SIZE-1)];
+    return sample_circ_buf_clean[(dsp_core()->clean_pos - offset) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1)];
 };
 
-inline int16_t sample_circ_buf_clean_value(int offset)
+void initialize_sample_circ_buf(void);
+
+/* A unit's own delay line, in the arena after its state.  Value 0 is the
+   newest sample put in, samples older than the unit read as silence so
+   the line does not have to be cleared when it is laid out. */
+typedef struct
 {
-    return sample_circ_buf_clean[(sample_circ_buf_clean_offset - offset) & (SAMPLE_CIRC_BUF_CLEAN_SIZE-1)];
-};
+    int16_t  *samples;
+    uint32_t size;
+    uint32_t pos;
+    uint32_t fill;
+} dsp_line;
 
-void initialize_sample_circ_buf(void);
+static inline void dsp_line_insert(dsp_line *dl, int16_t insert_val)
+{
+    if ((++dl->pos) >= dl->size) dl->pos = 0;
+    dl->samples[dl->pos] = insert_val;
+    if (dl->fill < dl->size) dl->fill++;
+}
+
+static inline int16_t dsp_line_value(const dsp_line *dl, uint32_t offset)
+{
+    if (offset >= dl->fill) return 0;
+    return dl->samples[(dl->pos >= offset) ? (dl->pos - offset) : (dl->pos + dl->size - offset)];
+}
+
+/* A delay line kept as 4 bit IMA ADPCM, a little over a quarter of the
+   memory of a dsp_line, for delays too long for that.  The line is a
+   ring of blocks, each starting with the encoder state at its first
+   sample, so that the reader can start decoding at any block.  The reader
+   decodes one sample per read as long as each read is of the sample after
+   the last one, which is what a delay of constant length does, and seeks
+   from the start of the block (dsp_adpcm_seek) when the length changes.
+   The line has a block more than it is read from, so the block being
+   written is never read.  As with dsp_line, samples older than the line
+   read as silence. */
+#define DSP_ADPCM_BLOCK_SAMPLES 128
+#define DSP_ADPCM_STEPS 89
+
+typedef struct
+{
+    int16_t  predictor;
+    uint8_t  step_index;
+    uint8_t  notused;
+    uint8_t  data[DSP_ADPCM_BLOCK_SAMPLES/2];
+} dsp_adpcm_block;
+
+typedef struct
+{
+    int32_t  predictor;
+    int32_t  step_index;
+} dsp_adpcm_state;
+
+typedef struct
+{
+    dsp_adpcm_block *blocks;
+    uint32_t size;
+    uint32_t pos;
+    uint32_t fill;
+    uint32_t read_pos;
+    dsp_adpcm_state encoder;
+    dsp_adpcm_state decoder;
+} dsp_adpcm_line;
+
+extern const int16_t dsp_adpcm_step_table[DSP_ADPCM_STEPS];
+extern const int8_t dsp_adpcm_index_table[8];
+
+/* bytes of line memory for a line read up to delay samples back */
+static inline uint32_t dsp_adpcm_line_bytes(uint32_t delay)
+{
+    return ((delay + DSP_ADPCM_BLOCK_SAMPLES) / DSP_ADPCM_BLOCK_SAMPLES + 1) * sizeof(dsp_adpcm_block);
+}
+
+void dsp_adpcm_line_init(dsp_adpcm_line *al, void *mem, uint32_t bytes);
+void dsp_adpcm_seek(dsp_adpcm_line *al, uint32_t p);
+
+/* the samples are shifted up 2 bits, to use the whole of the step table */
+static inline int32_t dsp_adpcm_decode(dsp_adpcm_state *st, uint32_t code)
+{
+    int32_t step = dsp_adpcm_step_table[st->step_index];
+    int32_t diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    st->predictor += (code & 8) ? -diff : diff;
+    if (st->predictor > 32767) st->predictor = 32767;
+    if (st->predictor < -32768) st->predictor = -32768;
+    st->step_index += dsp_adpcm_index_table[code & 7];
+    if (st->step_index < 0) st->step_index = 0;
+    if (st->step_index > (DSP_ADPCM_STEPS-1)) st->step_index = DSP_ADPCM_STEPS-1;
+    return st->predictor;
+}
+
+static inline uint32_t dsp_adpcm_encode(dsp_adpcm_state *st, int32_t sample)
+{
+    int32_t step = dsp_adpcm_step_table[st->step_index];
+    int32_t diff = (sample * 4) - st->predictor;
+    uint32_t code = 0;
+    if (diff < 0)
+    {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step)
+    {
+        code |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step)
+    {
+        code |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) code |= 1;
+    dsp_adpcm_decode(st, code);
+    return code;
+}
+
+static inline uint32_t dsp_adpcm_block_code(const dsp_adpcm_block *b, uint32_t i)
+{
+    uint8_t d = b->data[i / 2];
+    return (i & 0x01) ? (d >> 4) : (d & 0x0F);
+}
+
+/* encodes sample i of a block, the first sample also writes the header */
+static inline void dsp_adpcm_block_write(dsp_adpcm_block *b, uint32_t i, dsp_adpcm_state *st, int16_t insert_val)
+{
+    if (i == 0)
+    {
+        b->predictor = st->predictor;
+        b->step_index = st->step_index;
+    }
+    uint32_t code = dsp_adpcm_encode(st, insert_val);
+    uint8_t *d = &b->data[i / 2];
+    *d = (i & 0x01) ? ((*d & 0x0F) | (code << 4)) : ((*d & 0xF0) | code);
+}
+
+static inline uint32_t dsp_adpcm_code(const dsp_adpcm_line *al, uint32_t p)
+{
+    return dsp_adpcm_block_code(&al->blocks[p / DSP_ADPCM_BLOCK_SAMPLES], p % DSP_ADPCM_BLOCK_SAMPLES);
+}
+
+static inline void dsp_adpcm_insert(dsp_adpcm_line *al, int16_t insert_val)
+{
+    if ((++al->pos) >= al->size) al->pos = 0;
+    dsp_adpcm_block_write(&al->blocks[al->pos / DSP_ADPCM_BLOCK_SAMPLES], al->pos % DSP_ADPCM_BLOCK_SAMPLES, &al->encoder, insert_val);
+    if (al->fill < al->size) al->fill++;
+}
+
+static inline int16_t dsp_adpcm_value(dsp_adpcm_line *al, uint32_t offset)
+{
+    if (offset >= al->fill) return 0;
+    uint32_t p = (al->pos >= offset) ? (al->pos - offset) : (al->pos + al->size - offset);
+    if (p != al->read_pos) dsp_adpcm_seek(al, p);
+    int32_t value = dsp_adpcm_decode(&al->decoder, dsp_adpcm_code(al, p));
+    al->read_pos = ((p + 1) < al->size) ? (p + 1) : 0;
+    return value >> 2;
+}
+
+/* Oversampling for the units with curves sharp enough to alias.  The
+   unit's curve is run on 2 or 4 samples per input sample: the input is
+   interpolated up by half band low pass filters, 1x to 2x and 2x to 4x, and
+   the outputs of the curve are filtered back down by the same filters.  A
+   half band filter is symmetric with every other tap zero and the center
+   tap a half, so each output only takes the taps in dsp_halfband (from
+   CircuitSim/firhalfband.m), one multiply for each pair.  The filters
+   delay the signal by 7 samples at 2x and 8.5 at 4x (280 and 340 us).
+   dsp_oversample_cost is the worst case cost of the filters at 1x, 2x and
+   4x, measured by dsp_bench_calibrate. */
+#define DSP_OVERSAMPLE_MAX 4
+#define DSP_OVERSAMPLE_RATIOS 3
+#define DSP_HALFBAND_PAIRS_MAX 4
+
+typedef struct
+{
+    uint32_t pairs;
+    int16_t  coefs[DSP_HALFBAND_PAIRS_MAX];
+} dsp_halfband;
+
+typedef struct
+{
+    int16_t  up[DSP_HALFBAND_PAIRS_MAX*2];
+    int16_t  even[DSP_HALFBAND_PAIRS_MAX*2];
+    int16_t  odd[DSP_HALFBAND_PAIRS_MAX];
+} dsp_halfband_state;
+
+typedef struct
+{
+    dsp_halfband_state stage[DSP_OVERSAMPLE_RATIOS-1];
+} dsp_oversample_state;
+
+extern uint32_t dsp_oversample_cost[DSP_OVERSAMPLE_RATIOS];
+
+/* the Oversample parameter is 1, 2 or 4, SET and the menu refuse 3.
+   Settings saved before there was one hold whatever followed the type's
+   defaults there, so a loaded setting outside 1, 2 and 4 is put back to
+   the default by dsp_parms_validate */
+#define DSP_OVERSAMPLE_ALLOWED ((1u << 1) | (1u << 2) | (1u << 4))
+
+static inline uint32_t dsp_oversample_ratio(uint32_t oversample)
+{
+    return (oversample >= 4) ? 4 : ((oversample >= 2) ? 2 : 1);
+}
+
+static inline uint32_t dsp_oversample_index(uint32_t ratio)
+{
+    return (ratio >= 4) ? 2 : (ratio >> 1);
+}
+
+void dsp_oversample_up(dsp_oversample_state *os, uint32_t ratio, int32_t sample, int32_t *out);
+int32_t dsp_oversample_down(dsp_oversample_state *os, uint32_t ratio, const int32_t *in);
 
 void initialize_dsp(void);
 
@@ -102,6 +328,10 @@ typedef enum
     DSP_TYPE_WHAMMY,
     DSP_TYPE_OCTAVE,
     DSP_TYPE_SINE_SYNTH,
+    DSP_TYPE_LOOPER,
+    DSP_TYPE_REVERB,
+    DSP_TYPE_CABINET,
+    DSP_TYPE_WAVESHAPER,
     DSP_TYPE_MAX_ENTRY
 } dsp_unit_type;
 
@@ -166,6 +396,7 @@ typedef struct
     uint32_t notused;
     uint32_t pot_value1;
     uint32_t pot_value2;
+    dsp_adpcm_line adpcm;
 } dsp_type_delay;
 
 typedef struct
@@ -205,15 +436,25 @@ typedef struct
     uint32_t control_number1;
 } dsp_parm_bandpass;
 
+/* the delayed inputs and outputs of a biquad, see dsp_biquad */
+typedef enum
+{
+    DSP_BIQUAD_BANDPASS = 0,
+    DSP_BIQUAD_SYMMETRIC,
+    DSP_BIQUAD_ALLPASS
+} dsp_biquad_form;
+
+typedef struct
+{
+    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+} dsp_biquad_state;
+
 typedef struct
 {
     uint32_t pot_value1;
     uint16_t last_frequency;
     uint16_t last_Q;
-    int32_t filtb0;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
 } dsp_type_bandpass;
 
 typedef struct
@@ -230,11 +471,7 @@ typedef struct
     uint32_t pot_value1;
     uint16_t last_frequency;
     uint16_t last_Q;
-    int32_t filtb0;
-    int32_t filtb1;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
 } dsp_type_lowpass;
 
 typedef struct
@@ -251,11 +488,7 @@ typedef struct
     uint32_t pot_value1;
     uint16_t last_frequency;
     uint16_t last_Q;
-    int32_t filtb0;
-    int32_t filtb1;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
 } dsp_type_highpass;
 
 typedef struct
@@ -272,9 +505,7 @@ typedef struct
     uint32_t pot_value1;
     uint16_t last_frequency;
     uint16_t last_Q;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
 } dsp_type_allpass;
 
 typedef struct
@@ -318,6 +549,26 @@ typedef struct
     uint32_t pot_value2;
 } dsp_type_vibrato;
 
+/* The coefficients of a swept filter at DSP_SWEEP_ENTRIES frequencies
+   evenly spaced from the lower to the higher of freq1 and freq2, which
+   the audio path interpolates between.  As with the coefficient sets
+   there are two tables, the control pass builds the one that is not
+   active when freq1, freq2 or Q change and then switches active. */
+#define DSP_SWEEP_ENTRIES 64
+
+typedef struct
+{
+    int32_t b0;
+    int32_t a1;
+    int32_t a2;
+} dsp_sweep_entry;
+
+typedef struct
+{
+    dsp_sweep_entry entry[2][DSP_SWEEP_ENTRIES];
+    volatile uint32_t active;
+} dsp_sweep;
+
 typedef struct
 {
     dsp_unit_type  dut;
@@ -333,12 +584,8 @@ typedef struct
     uint32_t pot_value1;
     uint16_t last_freq1, last_freq2;
     uint16_t last_Q;
-    int32_t filtb0;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t filta1_interp1;
-    int32_t filta1_interp2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
+    dsp_sweep sweep;
 } dsp_type_wah;
 
 typedef struct
@@ -359,12 +606,8 @@ typedef struct
     uint32_t sine_counter;
     uint32_t sine_counter_inc;
     uint32_t last_frequency;
-    int32_t filtb0;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t filta1_interp1;
-    int32_t filta1_interp2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
+    dsp_sweep sweep;
 } dsp_type_autowah;
 
 typedef struct
@@ -382,13 +625,9 @@ typedef struct
 {
     uint16_t last_freq1, last_freq2;
     uint16_t last_Q;
-    int32_t filtb0;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t filta1_interp1;
-    int32_t filta1_interp2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
     uint32_t envelope;
+    dsp_sweep sweep;
 } dsp_type_envelope;
 
 typedef struct
@@ -399,16 +638,15 @@ typedef struct
     uint32_t noise_gate;
     uint32_t sample_offset;
     uint32_t control_number1;
+    uint32_t oversample;
 } dsp_parm_distortion;
 
 typedef struct
 {
     uint32_t last_noise_gate;
     uint32_t last_sample_offset;
-    int32_t low_threshold;
-    int32_t high_threshold;
-    int32_t offset_value;
     uint32_t pot_value1;
+    dsp_oversample_state os;
 } dsp_type_distortion;
 
 typedef struct
@@ -419,17 +657,15 @@ typedef struct
     uint32_t amplitude;
     uint32_t control_number1;
     uint32_t control_number2;
+    uint32_t oversample;
 } dsp_parm_overdrive;
 
 typedef struct
 {
     uint32_t last_threshold, last_amplitude;
-    int32_t  x0;
-    int32_t  y0;
-    int32_t  y0x0;
-    int32_t  y01;
     uint32_t pot_value1;
     uint32_t pot_value2;
+    dsp_oversample_state os;
 } dsp_type_overdrive;
 
 typedef struct
@@ -532,14 +768,11 @@ typedef struct
     uint32_t last_frequency;
     uint16_t last_freq1, last_freq2;
     uint16_t last_Q;
-    int32_t filta1_interp1;
-    int32_t filta1_interp2;
-    int32_t filta1;
-    int32_t filta2;
     uint32_t sine_counter;
     uint32_t sine_counter_inc;
     uint32_t pot_value1;
-    int32_t sampledly1[PHASER_STAGES], sampledly2[PHASER_STAGES], filtdly1[PHASER_STAGES], filtdly2[PHASER_STAGES];
+    dsp_biquad_state bs[PHASER_STAGES];
+    dsp_sweep sweep;
 } dsp_type_phaser;
 
 typedef struct
@@ -591,11 +824,7 @@ typedef struct
     uint32_t last_frequency;
     uint32_t last_Q;
 
-    int32_t filtb0;
-    int32_t filtb1;
-    int32_t filta1;
-    int32_t filta2;
-    int32_t sampledly1, sampledly2, filtdly1, filtdly2;
+    dsp_biquad_state bs;
 } dsp_type_pitchshift;
 
 typedef struct
@@ -632,44 +861,259 @@ typedef struct
     uint32_t source_unit;
     uint32_t rectify;
     uint32_t multiplier;
+    uint32_t oversample;
 } dsp_parm_octave;
 
 typedef struct
 {
     int32_t  sample_avg;
     int32_t  sample_avg2;
+    dsp_oversample_state os;
 } dsp_type_octave;
 
-typedef union 
+typedef struct
+{
+    dsp_unit_type  dut;
+    uint32_t source_unit;
+    uint32_t level;
+    uint32_t compress;
+    uint32_t control_number1;
+} dsp_parm_looper;
+
+typedef struct
+{
+    uint32_t notused;
+} dsp_type_looper;
+
+/* A feedback delay network of DSP_REVERB_LINES lines mixed by a Hadamard
+   matrix, each line with a one pole low pass for damping.  The read point
+   of each line swings by up to Modulation samples on a 1 Hz sine, a
+   quarter of a cycle apart from line to line, so that the tail does not
+   ring at the modes of the lines.  The lengths of the lines at a Size of
+   100 are dsp_reverb_lengths, Size in percent scales them, and with room
+   for the modulation they take at most DSP_REVERB_LINE_BUDGET samples of
+   the unit's line in the arena.  The sample path only adds, shifts and
+   multiplies. */
+#define DSP_REVERB_LINES 4
+#define DSP_REVERB_MOD_MAX 16
+#define DSP_REVERB_LINE_BUDGET 8192
+
+typedef struct
+{
+    dsp_unit_type  dut;
+    uint32_t source_unit;
+    uint32_t size;
+    uint32_t decay;
+    uint32_t damping;
+    uint32_t modulation;
+    uint32_t mixval;
+    uint32_t control_number1;
+    uint32_t control_number2;
+} dsp_parm_reverb;
+
+typedef struct
+{
+    uint32_t size;
+    uint32_t fill;
+    int16_t  *line[DSP_REVERB_LINES];
+    uint32_t length[DSP_REVERB_LINES];
+    uint32_t delay[DSP_REVERB_LINES];
+    uint32_t pos[DSP_REVERB_LINES];
+    int32_t  damped[DSP_REVERB_LINES];
+    uint32_t lfo_phase;
+    uint32_t pot_value1;
+    uint32_t pot_value2;
+} dsp_type_reverb;
+
+/* A speaker cabinet, the signal convolved with one of the impulse responses
+   of cabinet_irs.  The first CABINET_HEAD taps are run directly in the
+   sample path, so there is no latency.  The rest of the response is cut
+   into partitions of CABINET_BLOCK taps which are convolved a block at a
+   time by overlap-save with CABINET_FFT_SIZE point FFTs.  That is done by
+   the control pass: the tail of an input block is needed two blocks later,
+   when the head has run past its first CABINET_HEAD taps, so the control
+   pass has a whole block period (1.28 ms) to get to it.  A tail that is not
+   ready in time is left out for that block.  The spectra of the partitions
+   are worked out one per control pass after Cabinet is changed, so the
+   full tail builds up over the first 30 ms.  The unit's line holds the FFT
+   work area, the input ring, two blocks of tail, a copy of the head taps,
+   and for each partition its spectrum and the spectrum of one past input
+   block. */
+#define CABINET_BLOCK 32
+#define CABINET_FFT_SIZE (CABINET_BLOCK*2)
+#define CABINET_BINS (CABINET_BLOCK+1)
+#define CABINET_HEAD 64
+#define CABINET_RING 128
+#define CABINET_TAPS_MAX 1024
+#define CABINET_PARTS_MAX ((CABINET_TAPS_MAX-CABINET_HEAD)/CABINET_BLOCK)
+
+typedef struct
+{
+    int32_t re;
+    int32_t im;
+} cabinet_complex;
+
+typedef struct
+{
+    int16_t re;
+    int16_t im;
+} cabinet_bin;
+
+typedef struct
+{
+    dsp_unit_type  dut;
+    uint32_t source_unit;
+    uint32_t cabinet;
+    uint32_t mixval;
+} dsp_parm_cabinet;
+
+/* taps, head and the ring are used by the audio path, pos and block are
+   only written by it, the rest only by the control pass */
+typedef struct
+{
+    const int16_t * volatile taps;
+    uint32_t head;
+    uint32_t pos;
+    volatile uint32_t block;
+    volatile uint32_t done;
+    bool     tail_ok;
+    uint32_t cabinet;
+    uint32_t parts;
+    uint32_t parts_ready;
+    int32_t  shift;
+    uint32_t fdl_pos;
+    cabinet_complex *work;
+    int16_t  *in;
+    int16_t  *tail;
+    cabinet_bin *fdl;
+    cabinet_bin *h;
+} dsp_type_cabinet;
+
+/* A waveshaper, the signal times Drive/32 plus Bias looked up in one of
+   the transfer curves of shapertables and interpolated between its two
+   nearest entries.  The curve of the bias alone is taken off, so there is
+   no offset when the input is silent. */
+
+typedef struct
+{
+    dsp_unit_type  dut;
+    uint32_t source_unit;
+    uint32_t curve;
+    uint32_t drive;
+    uint32_t bias;
+    uint32_t level;
+    uint32_t control_number1;
+    uint32_t oversample;
+} dsp_parm_waveshaper;
+
+typedef struct
+{
+    uint32_t last_curve, last_drive;
+    uint32_t last_bias, last_level;
+    uint32_t pot_value1;
+    dsp_oversample_state os;
+} dsp_type_waveshaper;
+
+/* Filter coefficients and other values derived from the parameters by the
+   control pass (dsp_control_update).  Each unit has two sets: the control
+   pass writes the set the audio path is not using and then switches
+   coefs_active, so the audio path never sees a half written set. */
+typedef struct
 {
-    dsp_type_none         dtn;
-    dsp_type_sine_synth   dtss;
-    dsp_type_noisegate    dtnoise;
-    dsp_type_delay        dtd;
-    dsp_type_room         dtroom;
-    dsp_type_combine      dtcombine;
-    dsp_type_bandpass     dtbp;
-    dsp_type_lowpass      dtlp;
-    dsp_type_highpass     dthp;
-    dsp_type_allpass      dtap;
-    dsp_type_tremolo      dttrem;
-    dsp_type_vibrato      dtvibr;
-    dsp_type_wah          dtwah;
-    dsp_type_autowah      dtautowah;
-    dsp_type_envelope     dtenv;
-    dsp_type_distortion   dtdist;
-    dsp_type_overdrive    dtovr;
-    dsp_type_compressor   dtcomp;
-    dsp_type_ring         dtring;
-    dsp_type_flange       dtflng;
-    dsp_type_chorus       dtchor;
-    dsp_type_phaser       dtphaser;
-    dsp_type_backwards    dtback;
-    dsp_type_pitchshift   dtpitch;
-    dsp_type_whammy       dtwhammy;
-    dsp_type_octave       dtoct;
+    int32_t filtb0;
+    int32_t filtb1;
+    int32_t filta1;
+    int32_t filta2;
+} dsp_coefs_biquad;
+
+typedef struct
+{
+    int32_t low_threshold;
+    int32_t high_threshold;
+    int32_t offset_value;
+} dsp_coefs_distortion;
+
+typedef struct
+{
+    int32_t  x0;
+    int32_t  y0;
+    int32_t  y0x0;
+    int32_t  y01;
+} dsp_coefs_overdrive;
+
+/* the position in the curve is sample*drive+base, in 1/65536 of an entry */
+typedef struct
+{
+    int32_t  drive;
+    int32_t  base;
+    int16_t  dc;
+    int16_t  level;
+    uint32_t curve;
+} dsp_coefs_waveshaper;
+
+typedef union
+{
+    dsp_coefs_biquad      bq;
+    dsp_coefs_distortion  dist;
+    dsp_coefs_overdrive   ovr;
+    dsp_coefs_waveshaper  shape;
+} dsp_coefs;
+
+/* A unit only takes as much of the arena as the member of its type needs
+   (dsp_type_state_size), followed by its delay line if it has one. */
+typedef struct
+{
+    dsp_coefs coefs[2];
+    volatile uint32_t coefs_active;
+    dsp_line line;
+    union
+    {
+        dsp_type_none         dtn;
+        dsp_type_sine_synth   dtss;
+        dsp_type_noisegate    dtnoise;
+        dsp_type_delay        dtd;
+        dsp_type_room         dtroom;
+        dsp_type_combine      dtcombine;
+        dsp_type_bandpass     dtbp;
+        dsp_type_lowpass      dtlp;
+        dsp_type_highpass     dthp;
+        dsp_type_allpass      dtap;
+        dsp_type_tremolo      dttrem;
+        dsp_type_vibrato      dtvibr;
+        dsp_type_wah          dtwah;
+        dsp_type_autowah      dtautowah;
+        dsp_type_envelope     dtenv;
+        dsp_type_distortion   dtdist;
+        dsp_type_overdrive    dtovr;
+        dsp_type_compressor   dtcomp;
+        dsp_type_ring         dtring;
+        dsp_type_flange       dtflng;
+        dsp_type_chorus       dtchor;
+        dsp_type_phaser       dtphaser;
+        dsp_type_backwards    dtback;
+        dsp_type_pitchshift   dtpitch;
+        dsp_type_whammy       dtwhammy;
+        dsp_type_octave       dtoct;
+        dsp_type_looper       dtloop;
+        dsp_type_reverb       dtrev;
+        dsp_type_cabinet      dtcab;
+        dsp_type_waveshaper   dtshape;
+    };
 } dsp_unit;
 
+/* The results passed between the units of a chain, and the epoch each
+   unit's state in the arena was last cleared for.  There are two, so that
+   while presets are crossfaded the outgoing chain keeps running on one
+   while the incoming chain starts on the other. */
+typedef struct
+{
+    uint32_t unit_epoch[MAX_DSP_UNITS];
+    int32_t  unit_result[MAX_DSP_UNITS+1];
+    int32_t  block_result[MAX_DSP_UNITS+1][DSP_BLOCK_MAX];
+} dsp_engine;
+
+extern dsp_engine dsp_engines[2];
+
 typedef union 
 {
     dsp_parm_none         dtn;
@@ -698,27 +1142,149 @@ typedef union
     dsp_parm_pitchshift   dtpitch;
     dsp_parm_whammy       dtwhammy;
     dsp_parm_octave       dtoct;
+    dsp_parm_looper       dtloop;
+    dsp_parm_reverb       dtrev;
+    dsp_parm_cabinet      dtcab;
+    dsp_parm_waveshaper   dtshape;
 } dsp_parm;
 
 typedef bool    (dsp_type_initialize)(void *initialization_data, dsp_unit *du);
 typedef int32_t (dsp_type_process)(int32_t sample, dsp_parm *dp, dsp_unit *du);
 
+/* The controls are read and the coefficients derived from them DSP_CONTROL_RATE
+   times a second by dsp_control_update, outside of the audio interrupt, so
+   the per sample code only runs the filters. */
+#define DSP_CONTROL_RATE 1000u
+#define DSP_CONTROL_SAMPLES (DSP_SAMPLERATE/DSP_CONTROL_RATE)
+
+typedef void    (dsp_type_control)(dsp_parm *dp, dsp_unit *du);
+
+/* The units that are run, compiled from the routing whenever the
+   configuration changes.  A unit is live when its result reaches the
+   output through source_unit or a Combine input with a non-zero
+   amplitude.  A None unit passes its source through, so instead of running
+   it the units that read it read its source directly, unless it is read
+   by a Combine or by an earlier unit (feedback from the previous sample).
+   The live units stay in unit order, so feedback still sees the previous
+   sample.  source is the index in unit_result of the unit's input and
+   output that of the chain output.  reads_back is set when a live unit
+   reads the previous sample of itself or a later unit, which in block mode
+   is only right if the chain is run one sample at a time. */
+typedef struct
+{
+    uint8_t unit_no;
+    uint8_t source;
+} dsp_schedule_entry;
+
+typedef struct
+{
+    uint count;
+    uint output;
+    bool reads_back;
+    dsp_schedule_entry entry[MAX_DSP_UNITS];
+} dsp_schedule;
+
+void dsp_schedule_build(dsp_schedule *ds, const dsp_parm *dps);
+
+/* The configuration the audio path runs, the parameters and the schedule
+   compiled from them, is one of two banks.  Changes are made to the other
+   bank, returned by dsp_bank_edit, and dsp_bank_commit switches the audio
+   path to it with one pointer write, so a sample sees either all of a change
+   or none of it.  unit_offset and unit_size place each unit that is run in
+   the arena, unit_size is 0 for the others.  unit_epoch is the number of
+   the commit that last moved each unit or changed its type, a unit whose
+   epoch differs from the engine's is cleared the first time it is run from
+   the bank, so only units whose type or memory changed lose their state.
+   The control pass is held off while an edit is open because it writes to
+   the active parameters.  dsp_bank_abort discards the open edit. */
+typedef struct
+{
+    dsp_parm     parms[MAX_DSP_UNITS];
+    uint32_t     unit_epoch[MAX_DSP_UNITS];
+    uint32_t     unit_offset[MAX_DSP_UNITS];
+    uint32_t     unit_size[MAX_DSP_UNITS];
+    dsp_schedule schedule;
+    dsp_engine   *engine;
+} dsp_bank;
+
+extern dsp_bank * volatile dsp_bank_active;
+
+dsp_parm *dsp_bank_edit(void);
+void dsp_bank_commit(void);
+void dsp_bank_abort(void);
+
+/* The state and delay lines of the units come from one pool of
+   DSP_ARENA_SIZE bytes, laid out again by every commit.  A unit that is run
+   takes the state of its type and the delay line its parameters ask for
+   (dtline, NULL for types without one), so two delays each have their own
+   line and a short delay does not reserve the memory of a long one.  A unit
+   of the same type and size as before keeps its place.  dsp_chain_memory is
+   what a chain takes, and a chain that does not fit is refused the same
+   way as one over the time budget.  If one is committed anyway its largest
+   units are set to None until it fits.  dsp_arena_scratch gives the
+   benchmark a unit with its line at the start of the arena, audio must be
+   stopped and every unit of the chain is cleared when it starts again. */
+#define DSP_ARENA_SIZE (72u*1024u)
+
+typedef uint32_t (dsp_type_line)(const dsp_parm *dp);
+
+extern dsp_type_line * const dtline[];
+extern const uint16_t dsp_type_state_size[];
+
+uint32_t dsp_chain_memory(const dsp_parm *dps);
+uint32_t dsp_chain_memory_replace(uint dsp_unit_number, dsp_unit_type dut);
+bool dsp_chain_memory_fits(uint32_t bytes);
+dsp_unit *dsp_arena_scratch(const dsp_parm *dp);
+
+/* dsp_bank_commit_crossfade commits the open edit as a new preset on the
+   other engine with its controls already applied.  For dsp_crossfade_ms
+   both chains run and the output fades from the old chain to the new one.
+   If dsp_crossfade_tail_ms is not zero the old chain's input is faded out
+   instead of its output, so that its delay and reverb tails keep ringing
+   until the tail time is up, and its output then fades out over
+   dsp_crossfade_ms.  It returns false, and leaves the edit open for
+   dsp_bank_commit, if crossfading is off, the chain is split across the
+   cores or both chains together would not fit the budget or the arena.
+   dsp_crossfade_worst is the longest time in dsp_bench ticks that the
+   audio path has taken to run both chains. */
+#define DSP_CROSSFADE_MAX_MS 500
+#define DSP_CROSSFADE_TAIL_MAX_MS 10000
+
+extern uint32_t dsp_crossfade_ms;
+extern uint32_t dsp_crossfade_tail_ms;
+extern volatile uint32_t dsp_crossfade_worst;
+
+bool dsp_bank_commit_crossfade(void);
+bool dsp_crossfade_running(void);
+
+int32_t dsp_process_units(dsp_bank *db, int32_t *unit_result, uint first, uint last);
 int32_t dsp_process_all_units(int32_t sample);
-void dsp_unit_struct_zero(dsp_unit *du);
+int16_t dsp_process_sample(int16_t sample);
+
+/* Block processing runs each unit over the whole block before the next
+   unit.  Types with an entry in dtpb work on the arrays directly, the rest
+   are called once per sample.  A source_unit later in the chain (feedback)
+   sees the previous block rather than the previous sample. */
+
+typedef void (dsp_type_process_block)(int32_t *out, const int32_t *in, uint n, dsp_parm *dp, dsp_unit *du);
+
+extern dsp_type_process_block * const dtpb[];
+void dsp_process_block(int16_t *samples, uint n);
+void dsp_unit_struct_zero(dsp_unit *du, dsp_unit_type dut);
 void dsp_unit_initialize(int dsp_unit_number, dsp_unit_type dut);
 
+extern dsp_type_process * const dtp[];
+extern dsp_type_control * const dtcp[];
+void dsp_control_unit(uint dsp_unit_number);
+void dsp_control_update(void);
 extern const void * const dsp_parm_struct_defaults[];
-extern dsp_parm dsp_parms[MAX_DSP_UNITS];
-extern dsp_unit dsp_units[MAX_DSP_UNITS];
+extern const uint16_t dsp_parm_struct_size[];
+void dsp_parm_copy_defaults(dsp_parm *dp, dsp_unit_type dut);
+dsp_unit *dsp_unit_entry(uint e);
 
-inline dsp_unit *dsp_unit_entry(uint e)
+static inline dsp_parm *dsp_parm_entry(uint e)
 {
-    return &dsp_units[e];
-}
-
-inline dsp_parm *dsp_parm_entry(uint e)
-{
-    return &dsp_parms[e];
+    return &dsp_bank_active->parms[e];
 }
 
 typedef struct
@@ -730,8 +1296,15 @@ typedef struct
     uint32_t   minval;
     uint32_t   maxval;
     const char *controldesc;
+    uint32_t   allowed;     /* bit n set if n is allowed, 0 if every value in range is */
 } dsp_parm_configuration_entry;
 
+bool dsp_parm_value_valid(const dsp_parm_configuration_entry *dpce, uint32_t value);
+/* puts back the default of every parameter of a loaded chain that SET
+   would refuse, and makes a unit of no known type None.  A few defaults
+   are outside the range SET takes and are left alone.  Returns the number
+   put back. */
+uint dsp_parms_validate(dsp_parm *dps);
 bool dsp_unit_set_value(uint dsp_unit_number, const char *desc, uint32_t value);
 bool dsp_unit_get_value(uint dsp_unit_number, const char *desc, uint32_t *value);
 dsp_unit_type dsp_unit_get_type(uint dsp_unit_number);
@@ -746,30 +1319,126 @@ void dsp_set_value_prec(void *v, int prec, uint32_t val);
 void dsp_unit_reset(int dsp_unit_number);
 void dsp_unit_reset_all(void);
 
-/************Float to quantized integer offset instructions *******************************/
-
-inline float nyquist_fraction_omega(uint16_t frequency)
-{
-    return ((float)frequency)*(2.0f*MATH_PI_F/((float)DSP_SAMPLERATE));
-}
+/* Admission control.  dsp_type_cost holds the worst case cost of one sample
+   of each type in dsp_bench ticks (processor cycles on the pedal), measured
+   by dsp_bench_calibrate without oversampling.  A unit that oversamples
+   costs that for each sample its curve is run on, plus dsp_oversample_cost
+   (dsp_unit_cost).  A chain fits if its summed cost is within
+   DSP_CHAIN_BUDGET_PERCENT of the sample period, less the decimation of the
+   ADC input in block mode (adccic.h); the rest of the period is left for
+   the control half of the alarm, pitch detection, USB and the UI.  While
+   dsp_chain_budget is zero nothing has been measured and every chain is
+   accepted. */
+
+#define DSP_CHAIN_BUDGET_PERCENT 70
+
+extern uint32_t dsp_type_cost[DSP_TYPE_MAX_ENTRY];
+extern uint32_t dsp_chain_budget;
+
+/* 0 runs the whole chain on core 0, otherwise units from dsp_split_unit
+   on run on core 1 (see dspsplit.h) and each core has the budget to itself */
+extern volatile uint dsp_split_unit;
+
+uint32_t dsp_unit_cost(const dsp_parm *dp);
+uint32_t dsp_chain_cost(const dsp_parm *dps);
+uint32_t dsp_chain_cost_replace(uint dsp_unit_number, dsp_unit_type dut);
+bool dsp_chain_fits(uint32_t cost);
+
+/* A unit on core 0 can not read the result of a unit on core 1 from the
+   sample before, by its source or a Combine input, as core 1 is still
+   running that sample's part of the chain, so such a chain is not split
+   there.  True if split is 0. */
+bool dsp_chain_splits(const dsp_parm *dps, uint split);
+
+/************Looper ************************************************************/
+
+/* The Looper's loop is kept in a pool of its own, DSP_LOOP_POOL_SIZE bytes
+   outside of the arena, so that it is not laid out again by a commit and
+   plays on when a setting with a Looper is loaded from the stomp pedal.
+   There is one loop, shared by every Looper unit.  It holds
+   DSP_LOOP_POOL_SIZE/2 samples (0.65 s) as 16 bit samples, or as ADPCM
+   blocks (2.4 s) when Compress is set; the format is chosen when
+   recording starts.  Nothing is allocated while the loop runs: length
+   counts the samples recorded, and recording stops when the pool is full.
+
+   The buttons of the stomp pedal (dsp_pedal_button) on the Looper's
+   PedalCtrl input are debounced by the control pass, which leaves each
+   press in button for the audio path to act on:
+     1  record, then overdub and play in turn while the loop plays
+     2  play from where the loop is, or from its start when stopped
+     3  stop and go back to the start of the loop
+     4  erase the loop
+   When compressed a press is acted on at the start of the next ADPCM block
+   (5 ms), so that every block is written from its header.  The loop moves
+   on once per sample period however many Loopers run (stamp, the clean_pos
+   of that sample): a second Looper, or the incoming chain of a crossfade,
+   plays the same loop sample (recent) without writing. */
+#define DSP_LOOP_POOL_SIZE (32u*1024u)
+#define DSP_LOOP_DEBOUNCE 20
+
+typedef enum
+{
+    DSP_LOOP_EMPTY = 0,
+    DSP_LOOP_RECORD,
+    DSP_LOOP_PLAY,
+    DSP_LOOP_OVERDUB,
+    DSP_LOOP_STOP
+} dsp_loop_mode;
 
-inline float Q_value(uint16_t Q)
+typedef struct
 {
-    return (((float)Q)*0.01f);
-}
+    volatile uint32_t button;
+    volatile dsp_loop_mode mode;
+    bool     compress;
+    uint32_t length;
+    uint32_t pos;
+    int      stamp;
+    int16_t  recent[DSP_BLOCK_MAX];
+    dsp_adpcm_state encoder;
+    dsp_adpcm_state decoder;
+    /* used by the control pass */
+    bool     compress_next;
+    uint32_t pedal_wait;
+    uint32_t pedal_count;
+} dsp_loop_state;
+
+extern dsp_loop_state dsp_loop;
+
+uint dsp_pedal_button(uint16_t val);
+void dsp_loop_clear(void);
+bool dsp_loop_pedal_input(uint control_number);
+void dsp_loop_bench_start(bool compress);
+void dsp_loop_bench_end(void);
+
+/************Fixed point filter coefficients ************************************/
+
+/* The biquad coefficients are computed in Q24 fixed point with the sine
+   table of waves.c, as the RP2040 has no floating point unit and sinf()
+   and cosf() take thousands of cycles.  fixed_omega_sin() and
+   fixed_omega_cos() are sin and cos of frequency*2*pi/DSP_SAMPLERATE,
+   fixed_a_value() is sin(omega)/(2Q) for Q in hundredths, and
+   fixed_bfpa0_value() is 1/(1+a) in Q30, which fixed_to_sampled_int()
+   multiplies a Q24 value by to give the Q15 coefficient.  The results are
+   within 2 of the Q15 coefficients of the float formulas they replace
+   (gpicocoefs in the host build checks this). */
+
+#define FIXED_COEF_BITS 24
+#define FIXED_COEF_ONE (1<<FIXED_COEF_BITS)
+
+int32_t fixed_omega_sin(uint16_t frequency);
+int32_t fixed_omega_cos(uint16_t frequency);
+int32_t fixed_a_value(int32_t sin_omega, uint16_t Q);
+int32_t fixed_bfpa0_value(int32_t a);
+int32_t fixed_to_sampled_int(int32_t x, int32_t bfpa0);
 
-/* Q = 100 means Q scaled to one */
-inline float float_a_value(float omega_value, uint16_t Q)
-{
-    return sinf(omega_value)*(50.0f)/((float)Q);
-}
+/************Float to quantized integer offset instructions *******************************/
 
-inline int32_t float_to_sampled_int(float x)
+static inline int32_t float_to_sampled_int(float x)
 {
     return (int32_t)(QUANTIZATION_MAX_FLOAT*x+0.5f);
 }
 
-inline int16_t fractional_int_remove_offset(int32_t x)
+static inline int16_t fractional_int_remove_offset(int32_t x)
 {
     return (int32_t)(x/QUANTIZATION_MAX);
 }
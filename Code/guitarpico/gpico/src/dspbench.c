@@ -0,0 +1,528 @@
+/* dspbench.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "dsp.h"
+#include "dspbench.h"
+#include "cabinet.h"
+#include "audioring.h"
+#include "adccic.h"
+
+const char * const dsp_bench_signal_names[] = { "Silence", "Sweep", "Noise", "Clip", NULL };
+const char * const dsp_bench_parms_names[] = { "Default", "Extreme", "Recompute", NULL };
+
+#define DSP_BENCH_RUNS 3
+
+static uint32_t dsp_bench_overhead;
+
+/* the worst of adc_cic_block per sample, which runs in the same interrupt
+   as the chain in block mode and so comes out of its budget */
+static uint32_t dsp_bench_adc_cic_cost;
+
+void dsp_bench_initialize(void)
+{
+#ifndef GUITARPICO_HOST
+    systick_hw->csr = 0;
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;                  /* enabled, processor clock, no interrupt */
+#endif
+    dsp_bench_overhead = 0xFFFFFFFF;
+    for (uint i=0;i<64;i++)
+    {
+        uint32_t start = dsp_bench_ticks();
+        uint32_t ticks = dsp_bench_elapsed(start, dsp_bench_ticks());
+        if (ticks < dsp_bench_overhead) dsp_bench_overhead = ticks;
+    }
+}
+
+uint32_t dsp_bench_ticks_per_sample(void)
+{
+#ifdef GUITARPICO_HOST
+    return 1000000000u / DSP_SAMPLERATE;
+#else
+    return clock_get_hz(clk_sys) / DSP_SAMPLERATE;
+#endif
+}
+
+const char *dsp_bench_tick_unit(void)
+{
+#ifdef GUITARPICO_HOST
+    return "ns";
+#else
+    return "cycles";
+#endif
+}
+
+typedef struct
+{
+    uint32_t phase;
+    uint32_t seed;
+} dsp_bench_signal_state;
+
+static int32_t dsp_bench_next_sample(dsp_bench_signal dbs, dsp_bench_signal_state *st, uint32_t n, uint32_t samples)
+{
+    switch (dbs)
+    {
+        case DSP_BENCH_SIGNAL_SWEEP:
+        {
+            /* 20 Hz to the Nyquist frequency over the run */
+            uint32_t freq = 20 + (uint32_t)((((uint64_t)(DSP_SAMPLERATE/2 - 20)) * n) / samples);
+            st->phase += (uint32_t)((((uint64_t)freq) << 32) / DSP_SAMPLERATE);
+            return table_sine[st->phase >> 22] / (QUANTIZATION_MAX / (ADC_PREC_VALUE/2));
+        }
+        case DSP_BENCH_SIGNAL_NOISE:
+            st->seed = st->seed * 1664525u + 1013904223u;
+            return ((int32_t)(st->seed >> 18)) - (ADC_PREC_VALUE/2);
+        case DSP_BENCH_SIGNAL_CLIP:
+            /* 1 kHz full scale square wave bursts, 512 samples on, 512 off */
+            if ((n / 512) & 0x01) return 0;
+            return ((n / 12) & 0x01) ? (ADC_PREC_VALUE/2-1) : (-ADC_PREC_VALUE/2);
+        default:
+            return 0;
+    }
+}
+
+static void dsp_bench_set_parms(dsp_unit_type dut, dsp_bench_parms dbp, dsp_parm *dp, bool minimum)
+{
+    const dsp_parm_configuration_entry *dpce_l = dpce[dut];
+
+    if (dbp == DSP_BENCH_PARMS_DEFAULT) return;
+    while (dpce_l->desc != NULL)
+    {
+        /* leave control assignments, unit routing and oversampling alone,
+           the cost of oversampling is measured by dsp_bench_oversample */
+        if ((dpce_l->controldesc == NULL) && strcmp(dpce_l->desc, "SourceUnit") && strncmp(dpce_l->desc, "Unit", 4) &&
+            strcmp(dpce_l->desc, "Oversample"))
+            dsp_set_value_prec((void *)(((uint8_t *)dp) + dpce_l->offset), dpce_l->size, minimum ? dpce_l->minval : dpce_l->maxval);
+        dpce_l++;
+    }
+}
+
+static void dsp_bench_type_run(dsp_unit_type dut, dsp_bench_parms dbp, dsp_bench_signal dbs, uint32_t samples, dsp_bench_result *dbr)
+{
+    dsp_bench_signal_state st = { 0, 1 };
+    dsp_parm dp;
+    dsp_unit *du;
+
+    dsp_parm_copy_defaults(&dp, dut);
+    dp.dtn.source_unit = 1;
+    dsp_bench_set_parms(dut, dbp, &dp, false);
+    initialize_sample_circ_buf();
+
+    dbr->samples = samples;
+    dbr->total_ticks = 0;
+    dbr->max_ticks = 0;
+    /* the unit and its delay line are sized for the maximum parameters */
+    if ((du = dsp_arena_scratch(&dp)) == NULL) return;
+    /* the Looper is timed overdubbing, and the player's loop is put back
+       afterwards */
+    if (dut == DSP_TYPE_LOOPER) dsp_loop_bench_start(dp.dtloop.compress != 0);
+    for (uint32_t n=0;n<samples;n++)
+    {
+        int32_t sample = dsp_bench_next_sample(dbs, &st, n, samples);
+        if (dbp == DSP_BENCH_PARMS_RECOMPUTE)
+            dsp_bench_set_parms(dut, dbp, &dp, (n & 0x01) != 0);
+        insert_sample_circ_buf_clean(sample);
+        /* the control pass runs outside of the sample period and is not timed */
+        if (dtcp[dut] != NULL) dtcp[dut](&dp, du);
+#ifndef GUITARPICO_HOST
+        uint32_t ints = save_and_disable_interrupts();
+#endif
+        uint32_t start = dsp_bench_ticks();
+        sample = dtp[dut](sample, &dp, du);
+        uint32_t ticks = dsp_bench_elapsed(start, dsp_bench_ticks());
+#ifndef GUITARPICO_HOST
+        restore_interrupts(ints);
+#endif
+        ticks = (ticks > dsp_bench_overhead) ? (ticks - dsp_bench_overhead) : 0;
+        dbr->total_ticks += ticks;
+        if (ticks > dbr->max_ticks) dbr->max_ticks = ticks;
+    }
+    if (dut == DSP_TYPE_LOOPER) dsp_loop_bench_end();
+}
+
+/* The case is run DSP_BENCH_RUNS times and the smallest mean is kept.  On
+   the pedal interrupts are off while each sample is timed, so the largest
+   worst case is kept: a run that missed the flash cache is one the audio
+   path sees too, and the budget has to allow for it.  On the host the
+   smallest is kept, so that a context switch does not show up as the worst
+   case of the effect itself. */
+static inline uint32_t dsp_bench_worst_of(uint32_t a, uint32_t b)
+{
+#ifdef GUITARPICO_HOST
+    return (a < b) ? a : b;
+#else
+    return (a > b) ? a : b;
+#endif
+}
+
+void dsp_bench_type(dsp_unit_type dut, dsp_bench_parms dbp, dsp_bench_signal dbs, uint32_t samples, dsp_bench_result *dbr)
+{
+    dsp_bench_type_run(dut, dbp, dbs, samples, dbr);
+    for (uint run=1;run<DSP_BENCH_RUNS;run++)
+    {
+        dsp_bench_result dbr_run;
+        dsp_bench_type_run(dut, dbp, dbs, samples, &dbr_run);
+        if (dbr_run.total_ticks < dbr->total_ticks) dbr->total_ticks = dbr_run.total_ticks;
+        dbr->max_ticks = dsp_bench_worst_of(dbr->max_ticks, dbr_run.max_ticks);
+    }
+}
+
+/* worst case of one type over every parameter set and signal, each case
+   is printed if put_string is not NULL */
+static uint32_t dsp_bench_type_worst(dsp_unit_type dut, dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+    uint32_t budget = dsp_bench_ticks_per_sample();
+    uint32_t worst = 0;
+
+    for (uint dbp=0;dbp<DSP_BENCH_PARMS_MAX_ENTRY;dbp++)
+    {
+        for (uint dbs=0;dbs<DSP_BENCH_SIGNAL_MAX_ENTRY;dbs++)
+        {
+            dsp_bench_result dbr;
+            dsp_bench_type(dut, (dsp_bench_parms)dbp, (dsp_bench_signal)dbs, samples, &dbr);
+            if (put_string != NULL)
+            {
+                uint32_t mean = (uint32_t)(dbr.total_ticks / dbr.samples);
+                uint32_t permille = (uint32_t)((((uint64_t)dbr.max_ticks) * 1000) / budget);
+                sprintf(s,"%-11s %-10s %-8s %8u %8u %5u.%u\r\n", dtnames[dut], dsp_bench_parms_names[dbp], dsp_bench_signal_names[dbs],
+                        mean, dbr.max_ticks, permille / 10, permille % 10);
+                put_string(s);
+            }
+            if (dbr.max_ticks > worst) worst = dbr.max_ticks;
+        }
+    }
+    return worst;
+}
+
+typedef struct
+{
+    uint64_t total_ticks;
+    uint32_t max_ticks;
+} dsp_bench_ticks_sum;
+
+static void dsp_bench_ticks_add(dsp_bench_ticks_sum *sum, uint32_t start, uint32_t end)
+{
+    uint32_t ticks = dsp_bench_elapsed(start, end);
+    ticks = (ticks > dsp_bench_overhead) ? (ticks - dsp_bench_overhead) : 0;
+    sum->total_ticks += ticks;
+    if (ticks > sum->max_ticks) sum->max_ticks = ticks;
+}
+
+/* The ADPCM line of a long Delay on its own: one sample encoded and one
+   decoded per sample period, and the seek when the length of the delay
+   changes, which decodes up to a block of samples at once. */
+static void dsp_bench_adpcm(dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+    dsp_bench_signal_state st = { 0, 1 };
+    dsp_bench_ticks_sum encode = { 0, 0 }, decode = { 0, 0 }, seek = { 0, 0 };
+    dsp_parm dp;
+    dsp_unit *du;
+    uint32_t delay = DSP_ADPCM_BLOCK_SAMPLES * 2;
+
+    dsp_parm_copy_defaults(&dp, DSP_TYPE_DELAY);
+    dp.dtd.delay_samples = DSP_DELAY_ADPCM_MAX;
+    if ((du = dsp_arena_scratch(&dp)) == NULL) return;
+    dsp_adpcm_line *al = &du->dtd.adpcm;
+    dsp_adpcm_line_init(al, du->line.samples, du->line.size * sizeof(int16_t));
+    for (uint32_t n=0;n<(samples+delay);n++)
+    {
+        int32_t sample = dsp_bench_next_sample(DSP_BENCH_SIGNAL_NOISE, &st, n, samples+delay);
+#ifndef GUITARPICO_HOST
+        uint32_t ints = save_and_disable_interrupts();
+#endif
+        uint32_t start = dsp_bench_ticks();
+        dsp_adpcm_insert(al, sample);
+        uint32_t end = dsp_bench_ticks();
+        if (n >= delay) dsp_bench_ticks_add(&encode, start, end);
+        start = dsp_bench_ticks();
+        dsp_adpcm_value(al, delay);
+        end = dsp_bench_ticks();
+        if (n >= delay) dsp_bench_ticks_add(&decode, start, end);
+        if ((n >= delay) && ((n % DSP_ADPCM_BLOCK_SAMPLES) == 0))
+        {
+            /* the last sample of a block is the furthest from its header */
+            uint32_t p = (al->pos / DSP_ADPCM_BLOCK_SAMPLES) * DSP_ADPCM_BLOCK_SAMPLES;
+            p = (p >= DSP_ADPCM_BLOCK_SAMPLES) ? (p - 1) : (al->size - 1);
+            start = dsp_bench_ticks();
+            dsp_adpcm_seek(al, p);
+            dsp_bench_ticks_add(&seek, start, dsp_bench_ticks());
+            al->read_pos = al->size;
+        }
+#ifndef GUITARPICO_HOST
+        restore_interrupts(ints);
+#endif
+    }
+    sprintf(s,"ADPCM delay line, mean/worst %s: encode %u/%u decode %u/%u seek -/%u\r\n", dsp_bench_tick_unit(),
+            (uint32_t)(encode.total_ticks / samples), encode.max_ticks,
+            (uint32_t)(decode.total_ticks / samples), decode.max_ticks, seek.max_ticks);
+    put_string(s);
+}
+
+static void dsp_bench_oversample_run(uint32_t ratio, uint32_t samples, dsp_bench_ticks_sum *filters)
+{
+    dsp_bench_signal_state st = { 0, 1 };
+    dsp_oversample_state os;
+    int32_t up[DSP_OVERSAMPLE_MAX];
+
+    memset((void *)&os, '\000', sizeof(os));
+    filters->total_ticks = 0;
+    filters->max_ticks = 0;
+    for (uint32_t n=0;n<samples;n++)
+    {
+        int32_t sample = dsp_bench_next_sample(DSP_BENCH_SIGNAL_NOISE, &st, n, samples);
+#ifndef GUITARPICO_HOST
+        uint32_t ints = save_and_disable_interrupts();
+#endif
+        uint32_t start = dsp_bench_ticks();
+        dsp_oversample_up(&os, ratio, sample, up);
+        dsp_oversample_down(&os, ratio, up);
+        dsp_bench_ticks_add(filters, start, dsp_bench_ticks());
+#ifndef GUITARPICO_HOST
+        restore_interrupts(ints);
+#endif
+    }
+}
+
+/* The filters of oversampling on their own, up and back down again with
+   nothing in between, at each ratio.  The runs are kept as for the types
+   (dsp_bench_worst_of), and the worst cases are the dsp_oversample_cost
+   table. */
+static void dsp_bench_oversample(dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+
+    dsp_oversample_cost[0] = 0;
+    for (uint i=1;i<DSP_OVERSAMPLE_RATIOS;i++)
+    {
+        dsp_bench_ticks_sum filters;
+        uint32_t ratio = 1u << i;
+
+        dsp_bench_oversample_run(ratio, samples, &filters);
+        for (uint run=1;run<DSP_BENCH_RUNS;run++)
+        {
+            dsp_bench_ticks_sum filters_run;
+            dsp_bench_oversample_run(ratio, samples, &filters_run);
+            if (filters_run.total_ticks < filters.total_ticks) filters.total_ticks = filters_run.total_ticks;
+            filters.max_ticks = dsp_bench_worst_of(filters.max_ticks, filters_run.max_ticks);
+        }
+        dsp_oversample_cost[i] = filters.max_ticks;
+        if (put_string != NULL)
+        {
+            sprintf(s,"Oversampling %ux filters, mean/worst %s: %u/%u\r\n", ratio, dsp_bench_tick_unit(),
+                    (uint32_t)(filters.total_ticks / samples), filters.max_ticks);
+            put_string(s);
+        }
+    }
+}
+
+/* the cost of each type that has an Oversample parameter at each ratio,
+   the type's cost for every sample its curve is run on and the filters */
+static void dsp_bench_oversample_table(dsp_bench_put_string *put_string)
+{
+    char s[100];
+    const char *unit = dsp_bench_tick_unit();
+
+    sprintf(s,"Worst case oversampled, %s:\r\n%-11s %8s %8s %8s\r\n", unit, "Type", "1x", "2x", "4x");
+    put_string(s);
+    for (uint dut=0;dut<DSP_TYPE_MAX_ENTRY;dut++)
+    {
+        const dsp_parm_configuration_entry *dpce_l = dpce[dut];
+        while ((dpce_l->desc != NULL) && strcmp(dpce_l->desc, "Oversample")) dpce_l++;
+        if (dpce_l->desc == NULL) continue;
+        sprintf(s,"%-11s", dtnames[dut]);
+        put_string(s);
+        for (uint i=0;i<DSP_OVERSAMPLE_RATIOS;i++)
+        {
+            sprintf(s," %8u", dsp_type_cost[dut] * (1u << i) + dsp_oversample_cost[i]);
+            put_string(s);
+        }
+        put_string("\r\n");
+    }
+}
+
+/* The tail of a Cabinet with the longest IR, which the control pass works
+   out once per CABINET_BLOCK samples.  It is not run in the sample period
+   but it takes its time from the same processor, so the worst case per
+   sample is added to the cost of the type. */
+static uint32_t dsp_bench_cabinet(dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+    dsp_bench_signal_state st = { 0, 1 };
+    dsp_bench_ticks_sum tail = { 0, 0 };
+    uint32_t blocks = 0;
+    dsp_parm dp;
+    dsp_unit *du;
+
+    dsp_parm_copy_defaults(&dp, DSP_TYPE_CABINET);
+    dp.dtcab.cabinet = CABINET_IRS;
+    initialize_sample_circ_buf();
+    if ((du = dsp_arena_scratch(&dp)) == NULL) return 0;
+    /* the spectra of the partitions first */
+    do dtcp[DSP_TYPE_CABINET](&dp, du);
+    while (du->dtcab.parts_ready < du->dtcab.parts);
+    for (uint32_t n=0;n<samples;n++)
+    {
+        int32_t sample = dsp_bench_next_sample(DSP_BENCH_SIGNAL_NOISE, &st, n, samples);
+        insert_sample_circ_buf_clean(sample);
+        dtp[DSP_TYPE_CABINET](sample, &dp, du);
+        if (du->dtcab.block == du->dtcab.done) continue;
+#ifndef GUITARPICO_HOST
+        uint32_t ints = save_and_disable_interrupts();
+#endif
+        uint32_t start = dsp_bench_ticks();
+        dtcp[DSP_TYPE_CABINET](&dp, du);
+        dsp_bench_ticks_add(&tail, start, dsp_bench_ticks());
+#ifndef GUITARPICO_HOST
+        restore_interrupts(ints);
+#endif
+        blocks++;
+    }
+    if ((put_string != NULL) && (blocks != 0))
+    {
+        uint32_t permille = (uint32_t)((((uint64_t)tail.max_ticks) * 1000) / (dsp_bench_ticks_per_sample() * CABINET_BLOCK));
+        sprintf(s,"Cabinet tail of %u taps per %u samples, mean/worst %s: %u/%u, %u.%u%% of the period\r\n",
+                cabinet_irs[CABINET_IRS-1].length, CABINET_BLOCK, dsp_bench_tick_unit(),
+                (uint32_t)(tail.total_ticks / blocks), tail.max_ticks, permille / 10, permille % 10);
+        put_string(s);
+    }
+    return tail.max_ticks;
+}
+
+/* The decimation of block mode's oversampled ADC input on its own, from
+   noise, a block of the default size at a time.  The cost per sample is the
+   worst block divided by its size. */
+static void dsp_bench_adc_cic(dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+    dsp_bench_signal_state st = { 0, 1 };
+    dsp_bench_ticks_sum blocks = { 0, 0 };
+    adc_cic_state acs;
+    uint16_t adc[2*ADC_CIC_RATIO*AUDIO_RING_BLOCK_DEFAULT];
+    int16_t out[AUDIO_RING_BLOCK_DEFAULT];
+    uint32_t nblocks = (samples + AUDIO_RING_BLOCK_DEFAULT - 1) / AUDIO_RING_BLOCK_DEFAULT;
+
+    adc_cic_reset(&acs);
+    for (uint32_t b=0;b<nblocks;b++)
+    {
+        for (uint i=0;i<(ADC_CIC_RATIO*AUDIO_RING_BLOCK_DEFAULT);i++)
+        {
+            int32_t sample = dsp_bench_next_sample(DSP_BENCH_SIGNAL_NOISE, &st, i, samples);
+            adc[2*i] = (sample + (ADC_PREC_VALUE/2)) / (ADC_PREC_VALUE/ADC_MAX_VALUE);
+            adc[2*i+1] = ADC_MAX_VALUE/2;
+        }
+#ifndef GUITARPICO_HOST
+        uint32_t ints = save_and_disable_interrupts();
+#endif
+        uint32_t start = dsp_bench_ticks();
+        adc_cic_block(&acs, adc, out, AUDIO_RING_BLOCK_DEFAULT);
+        dsp_bench_ticks_add(&blocks, start, dsp_bench_ticks());
+#ifndef GUITARPICO_HOST
+        restore_interrupts(ints);
+#endif
+    }
+    dsp_bench_adc_cic_cost = (blocks.max_ticks + AUDIO_RING_BLOCK_DEFAULT - 1) / AUDIO_RING_BLOCK_DEFAULT;
+    if (put_string != NULL)
+    {
+        sprintf(s,"ADC decimation %ux, mean/worst %s per sample: %u/%u\r\n", ADC_CIC_RATIO, dsp_bench_tick_unit(),
+                (uint32_t)(blocks.total_ticks / (nblocks*AUDIO_RING_BLOCK_DEFAULT)), dsp_bench_adc_cic_cost);
+        put_string(s);
+    }
+}
+
+static void dsp_bench_set_budget(void)
+{
+    uint32_t budget = (uint32_t)((((uint64_t)dsp_bench_ticks_per_sample()) * DSP_CHAIN_BUDGET_PERCENT) / 100);
+    dsp_chain_budget = (budget > dsp_bench_adc_cic_cost) ? (budget - dsp_bench_adc_cic_cost) : 1;
+}
+
+/* fills in dsp_type_cost for admission control.  The audio alarm must not
+   be running, the sample buffers and the units of the chain are cleared
+   afterwards. */
+void dsp_bench_calibrate(uint32_t samples)
+{
+    dsp_bench_initialize();
+    for (uint dut=0;dut<DSP_TYPE_MAX_ENTRY;dut++)
+        dsp_type_cost[dut] = dsp_bench_type_worst((dsp_unit_type)dut, NULL, samples);
+    dsp_type_cost[DSP_TYPE_CABINET] += dsp_bench_cabinet(NULL, samples) / CABINET_BLOCK;
+    dsp_bench_oversample(NULL, samples);
+    dsp_bench_adc_cic(NULL, samples);
+    dsp_bench_set_budget();
+    initialize_sample_circ_buf();
+}
+
+/* prints every type/parameter/signal combination and a per type summary,
+   returns the number of types of which MAX_DSP_UNITS would not fit in one
+   sample period.  The worst cases replace the dsp_type_cost table. */
+uint32_t dsp_bench_report(dsp_bench_put_string *put_string, uint32_t samples)
+{
+    char s[100];
+    uint32_t budget = dsp_bench_ticks_per_sample();
+    uint32_t over_budget = 0;
+    const char *unit = dsp_bench_tick_unit();
+
+    dsp_bench_initialize();
+    sprintf(s,"Sample period %u %s at %u Hz, %u samples per case\r\n", budget, unit, DSP_SAMPLERATE, samples);
+    put_string(s);
+    sprintf(s,"%-11s %-10s %-8s %8s %8s %7s\r\n", "Type", "Parms", "Signal", "Mean", "Worst", "%Period");
+    put_string(s);
+    for (uint dut=0;dut<DSP_TYPE_MAX_ENTRY;dut++)
+        dsp_type_cost[dut] = dsp_bench_type_worst((dsp_unit_type)dut, put_string, samples);
+    dsp_type_cost[DSP_TYPE_CABINET] += dsp_bench_cabinet(put_string, samples) / CABINET_BLOCK;
+    dsp_bench_oversample(put_string, samples);
+    dsp_bench_adc_cic(put_string, samples);
+    dsp_bench_set_budget();
+    initialize_sample_circ_buf();
+    put_string("Worst case per type, units that fit in one period:\r\n");
+    for (uint dut=0;dut<DSP_TYPE_MAX_ENTRY;dut++)
+    {
+        uint32_t worst = dsp_type_cost[dut];
+        uint32_t fit = worst ? (budget / worst) : MAX_DSP_UNITS;
+        uint32_t permille = (uint32_t)((((uint64_t)worst) * 1000) / budget);
+        bool over = fit < MAX_DSP_UNITS;
+        sprintf(s,"%-11s %8u %s %5u.%u%% %4u", dtnames[dut], worst, unit, permille / 10, permille % 10, fit > 999 ? 999 : fit);
+        put_string(s);
+        if (over)
+        {
+            sprintf(s," over budget with %u units", MAX_DSP_UNITS);
+            put_string(s);
+        }
+        put_string("\r\n");
+        if (over) over_budget++;
+    }
+    dsp_bench_oversample_table(put_string);
+    dsp_bench_adpcm(put_string, samples);
+    initialize_sample_circ_buf();
+    return over_budget;
+}
@@ -0,0 +1,104 @@
+/* dspbench.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __DSPBENCH_H
+#define __DSPBENCH_H
+
+#ifndef GUITARPICO_HOST
+#include "hardware/structs/systick.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Times each dsp_type_process_* function one call at a time.  On the pedal a
+   tick is one processor clock (SysTick), on the host it is one nanosecond. */
+
+/* samples per case for the cost table measured at boot, enough for the
+   sweep to cover most of each curve */
+#define DSP_BENCH_CALIBRATE_SAMPLES 256
+
+typedef enum
+{
+    DSP_BENCH_SIGNAL_SILENCE = 0,
+    DSP_BENCH_SIGNAL_SWEEP,
+    DSP_BENCH_SIGNAL_NOISE,
+    DSP_BENCH_SIGNAL_CLIP,
+    DSP_BENCH_SIGNAL_MAX_ENTRY
+} dsp_bench_signal;
+
+typedef enum
+{
+    DSP_BENCH_PARMS_DEFAULT = 0,   /* dsp_parm_struct_defaults */
+    DSP_BENCH_PARMS_EXTREME,       /* every setting at its maximum */
+    DSP_BENCH_PARMS_RECOMPUTE,     /* settings flipped every sample, as a moving pot does */
+    DSP_BENCH_PARMS_MAX_ENTRY
+} dsp_bench_parms;
+
+typedef struct
+{
+    uint32_t samples;
+    uint64_t total_ticks;
+    uint32_t max_ticks;
+} dsp_bench_result;
+
+typedef void (dsp_bench_put_string)(const char *s);
+
+/* SysTick is left running by dsp_bench_initialize, so other code may time
+   itself with these */
+static inline uint32_t dsp_bench_ticks(void)
+{
+#ifdef GUITARPICO_HOST
+    return (uint32_t) host_time_ns();
+#else
+    return systick_hw->cvr;
+#endif
+}
+
+static inline uint32_t dsp_bench_elapsed(uint32_t start, uint32_t end)
+{
+#ifdef GUITARPICO_HOST
+    return end - start;
+#else
+    return (start - end) & 0x00FFFFFF;     /* SysTick counts down from 2^24-1 */
+#endif
+}
+
+extern const char * const dsp_bench_signal_names[];
+extern const char * const dsp_bench_parms_names[];
+
+void dsp_bench_initialize(void);
+uint32_t dsp_bench_ticks_per_sample(void);
+const char *dsp_bench_tick_unit(void);
+void dsp_bench_type(dsp_unit_type dut, dsp_bench_parms dbp, dsp_bench_signal dbs, uint32_t samples, dsp_bench_result *dbr);
+void dsp_bench_calibrate(uint32_t samples);
+uint32_t dsp_bench_report(dsp_bench_put_string *put_string, uint32_t samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DSPBENCH_H */
@@ -0,0 +1,138 @@
+/* dspoverlay.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "dsp.h"
+#include "dspoverlay.h"
+
+typedef struct
+{
+    const char     *name;
+    const int16_t  *table;
+    const int16_t **read_through;
+    uint32_t       length;
+} dsp_overlay_table;
+
+/* in the order they are given room in a half */
+static const dsp_overlay_table dsp_overlay_tables[DSP_OVERLAY_TABLES] =
+{
+    { "sine",     table_sine,            &wavetables[0],   WAVETABLES_LENGTH },
+    { "tanh",     table_shaper_tanh,     &shapertables[0], SHAPER_LENGTH+1 },
+    { "diode",    table_shaper_diode,    &shapertables[1], SHAPER_LENGTH+1 },
+    { "tube",     table_shaper_tube,     &shapertables[2], SHAPER_LENGTH+1 },
+    { "foldback", table_shaper_foldback, &shapertables[3], SHAPER_LENGTH+1 }
+};
+
+static int16_t dsp_overlay_ram[2][DSP_OVERLAY_BYTES/sizeof(int16_t)];
+static uint32_t dsp_overlay_half;
+static uint32_t dsp_overlay_used;
+static uint32_t dsp_overlay_mask;
+static bool dsp_overlay_enabled = true;
+
+/* the tables a unit reads in the audio path */
+static uint32_t dsp_overlay_unit(const dsp_parm *dp)
+{
+    switch (dp->dtn.dut)
+    {
+        case DSP_TYPE_SINE_SYNTH:
+        case DSP_TYPE_TREMOLO:
+        case DSP_TYPE_VIBRATO:
+        case DSP_TYPE_AUTOWAH:
+        case DSP_TYPE_ENVELOPE:
+        case DSP_TYPE_RING:
+        case DSP_TYPE_FLANGER:
+        case DSP_TYPE_CHORUS:
+        case DSP_TYPE_PHASER:
+        case DSP_TYPE_REVERB:
+            return DSP_OVERLAY_SINE;
+        case DSP_TYPE_WAVESHAPER:
+            if ((dp->dtshape.curve < 1) || (dp->dtshape.curve > SHAPERTABLES_NUMBER)) return DSP_OVERLAY_TANH;
+            return DSP_OVERLAY_TANH << (dp->dtshape.curve - 1);
+        default:
+            return 0;
+    }
+}
+
+/* Called before parms is switched in.  The pointers of tables that are not
+   copied go back to flash, which holds the same values, so a chain still
+   running with the last bank, or crossfading out, reads the same either
+   way. */
+void dsp_overlay_load(const dsp_parm *parms)
+{
+    uint32_t mask = 0;
+    uint32_t used = 0;
+    uint32_t loaded = 0;
+    int16_t *ram = dsp_overlay_ram[dsp_overlay_half ^ 1];
+
+    if (dsp_overlay_enabled)
+    {
+        for (uint unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+            mask |= dsp_overlay_unit(&parms[unit_no]);
+    }
+    for (uint i=0;i<DSP_OVERLAY_TABLES;i++)
+    {
+        const dsp_overlay_table *dot = &dsp_overlay_tables[i];
+        const int16_t *table = dot->table;
+        if ((mask & (1u << i)) && ((used + dot->length)*sizeof(int16_t) <= DSP_OVERLAY_BYTES))
+        {
+            memcpy((void *)&ram[used], (const void *)dot->table, dot->length*sizeof(int16_t));
+            table = &ram[used];
+            used += (dot->length + 1) & ~1;
+            loaded |= 1u << i;
+        }
+        DMB();
+        *dot->read_through = table;
+    }
+    DMB();
+    dsp_overlay_half ^= 1;
+    dsp_overlay_used = used*sizeof(int16_t);
+    dsp_overlay_mask = loaded;
+}
+
+void dsp_overlay_enable(bool enable, const dsp_parm *parms)
+{
+    dsp_overlay_enabled = enable;
+    dsp_overlay_load(parms);
+}
+
+uint32_t dsp_overlay_bytes(void)
+{
+    return dsp_overlay_used;
+}
+
+uint32_t dsp_overlay_loaded(void)
+{
+    return dsp_overlay_mask;
+}
+
+const char *dsp_overlay_name(uint table)
+{
+    return (table < DSP_OVERLAY_TABLES) ? dsp_overlay_tables[table].name : NULL;
+}
@@ -0,0 +1,65 @@
+/* dspoverlay.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __DSPOVERLAY_H
+#define __DSPOVERLAY_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Table overlays.  The tables the audio path reads are in flash, behind the
+   16 kB XIP cache, which the rest of the firmware also runs through.  When
+   a bank is switched in, the tables its units use are copied into a region
+   of SRAM and the pointers the audio path reads them through are moved to
+   the copies.  The rest stay in flash.
+
+   The region is in two halves, used in turn, so the copies the running
+   chain may be reading are not written over by the next bank.  A table
+   that does not fit in a half is left in flash.  The code of the sample
+   path that is shared by every chain is placed in SRAM when the firmware
+   is linked (__not_in_flash_func), the code of the units is not. */
+
+#define DSP_OVERLAY_BYTES 4096
+
+#define DSP_OVERLAY_SINE      0x01
+#define DSP_OVERLAY_TANH      0x02
+#define DSP_OVERLAY_DIODE     0x04
+#define DSP_OVERLAY_TUBE      0x08
+#define DSP_OVERLAY_FOLDBACK  0x10
+
+#define DSP_OVERLAY_TABLES 5
+
+void dsp_overlay_load(const dsp_parm *parms);
+void dsp_overlay_enable(bool enable, const dsp_parm *parms);
+uint32_t dsp_overlay_bytes(void);
+uint32_t dsp_overlay_loaded(void);
+const char *dsp_overlay_name(uint table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DSPOVERLAY_H */
@@ -0,0 +1,161 @@
+/* dspsplit.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "pico/multicore.h"
+#include "dsp.h"
+#include "dspsplit.h"
+
+/* Both FIFOs are rings indexed by free running counters.  Only core 0
+   writes the in head and the out tail, only core 1 the in tail and the out
+   head, so no lock is needed, just a barrier between filling an entry and
+   publishing it. */
+
+typedef struct
+{
+    int32_t unit_result[MAX_DSP_UNITS+1];
+    dsp_bank *bank;
+    int clean_pos;
+} dsp_split_entry;
+
+static dsp_split_entry dsp_split_in[DSP_SPLIT_FIFO_SIZE];
+static volatile uint32_t dsp_split_in_head, dsp_split_in_tail;
+
+static int16_t dsp_split_out[DSP_SPLIT_FIFO_SIZE];
+static volatile uint32_t dsp_split_out_head, dsp_split_out_tail;
+
+static int16_t dsp_split_last;
+volatile uint32_t dsp_split_late_samples;
+
+/* Each entry starts with the results of the entry before for the units of
+   the core running it, so that a unit reading a result from the sample
+   before, by feedback or a Combine input, gets it as it would with the
+   chain on one core.  Core 0 may be refilling the entry before while core 1
+   copies from it, but each core only writes the results of its own units. */
+static inline void dsp_split_carry(uint32_t n, uint first, uint last)
+{
+    const int32_t *prev = dsp_split_in[(n-1) & (DSP_SPLIT_FIFO_SIZE-1)].unit_result;
+    int32_t *cur = dsp_split_in[n & (DSP_SPLIT_FIFO_SIZE-1)].unit_result;
+    for (uint r=first+1;r<=last;r++)
+        cur[r] = prev[r];
+}
+
+static void __no_inline_not_in_flash_func(dsp_split_core1)(void)
+{
+    multicore_lockout_victim_init();
+    for (;;)
+    {
+        uint32_t tail = dsp_split_in_tail;
+        while (tail == dsp_split_in_head) {};
+        __dmb();
+        dsp_split_entry *dse = &dsp_split_in[tail & (DSP_SPLIT_FIFO_SIZE-1)];
+        dsp_cores[1].clean_pos = dse->clean_pos;
+        dsp_split_carry(tail, dsp_split_unit, MAX_DSP_UNITS);
+        int16_t sample = dsp_process_units(dse->bank, dse->unit_result, dsp_split_unit, MAX_DSP_UNITS);
+        __dmb();
+        dsp_split_in_tail = tail + 1;
+
+        uint32_t head = dsp_split_out_head;
+        if ((head - dsp_split_out_tail) < DSP_SPLIT_FIFO_SIZE)
+        {
+            dsp_split_out[head & (DSP_SPLIT_FIFO_SIZE-1)] = sample;
+            __dmb();
+            dsp_split_out_head = head + 1;
+        }
+    }
+}
+
+/* called from the sample alarm on core 0 in place of dsp_process_sample */
+int16_t __no_inline_not_in_flash_func(dsp_split_process_sample)(int16_t sample)
+{
+    insert_sample_circ_buf_clean(sample);
+    uint32_t head = dsp_split_in_head;
+    if ((head - dsp_split_in_tail) < DSP_SPLIT_FIFO_SIZE)
+    {
+        dsp_split_entry *dse = &dsp_split_in[head & (DSP_SPLIT_FIFO_SIZE-1)];
+        dse->bank = dsp_bank_active;
+        dse->unit_result[0] = sample;
+        dsp_split_carry(head, 0, dsp_split_unit);
+        dsp_process_units(dse->bank, dse->unit_result, 0, dsp_split_unit);
+        dse->clean_pos = sample_circ_buf_clean_offset;
+        __dmb();
+        dsp_split_in_head = head + 1;
+    } else
+        dsp_split_late_samples++;       /* core 1 is behind, the sample is dropped */
+
+    /* normally the previous sample is the only one waiting.  If core 1 has
+       caught up after running late, the older outputs are dropped so that
+       the latency stays at one sample. */
+    uint32_t tail = dsp_split_out_tail;
+    uint32_t waiting = dsp_split_out_head - tail;
+    if (waiting == 0)
+    {
+        dsp_split_late_samples++;
+        return dsp_split_last;
+    }
+    __dmb();
+    tail += waiting - 1;
+    dsp_split_last = dsp_split_out[tail & (DSP_SPLIT_FIFO_SIZE-1)];
+    __dmb();
+    dsp_split_out_tail = tail + 1;
+    return dsp_split_last;
+}
+
+/* the caller must have stopped audio and the VGA driver.  Core 1 is reset
+   and starts running units split_unit+1 to MAX_DSP_UNITS.  Refused if a
+   unit on core 0 reads back from a unit on core 1 (dsp_chain_splits). */
+bool dsp_split_start(uint split_unit)
+{
+    if ((split_unit == 0) || (split_unit >= MAX_DSP_UNITS))
+        return false;
+    if (!dsp_chain_splits(dsp_bank_active->parms, split_unit))
+        return false;
+    multicore_reset_core1();
+    memset(dsp_split_in, 0, sizeof(dsp_split_in));
+    dsp_split_in_head = dsp_split_in_tail = 0;
+    dsp_split_out[0] = 0;
+    dsp_split_out_head = 1;
+    dsp_split_out_tail = 0;
+    dsp_split_last = 0;
+    dsp_split_late_samples = 0;
+    dsp_split_unit = split_unit;
+    __dmb();
+    multicore_launch_core1(dsp_split_core1);
+    return true;
+}
+
+/* the caller must have stopped audio, and restarts the VGA driver after */
+void dsp_split_stop(void)
+{
+    if (dsp_split_unit == 0) return;
+    multicore_reset_core1();
+    dsp_split_unit = 0;
+}
@@ -0,0 +1,65 @@
+/* dspsplit.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef __DSPSPLIT_H
+#define __DSPSPLIT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Split chain mode.  Core 0 runs units 1 to dsp_split_unit from the sample
+   alarm and passes the unit results to core 1 through a single producer,
+   single consumer FIFO.  Core 1 runs the rest of the chain and passes the
+   output back through a second FIFO.  The output FIFO starts with one
+   sample of silence in it, so the output is always one sample period
+   (40 us) later than with the whole chain on core 0, and core 1 has a full
+   sample period for its part of the chain.
+
+   Each core carries the results of its own units from one FIFO entry to
+   the next, so feedback and Combine inputs within either part read the
+   sample before as they do unsplit.  A unit on core 0 reading back from a
+   unit on core 1 would need core 1's result before it is made, so a chain
+   that does is refused by SPLIT, and while split by SET, the menus and
+   bank loading (dsp_chain_splits).
+
+   Core 1 is otherwise used by the VGA driver, so video has to be stopped
+   while the chain is split.  Only per sample processing is split, not
+   block mode. */
+
+#define DSP_SPLIT_FIFO_SIZE 4
+
+bool dsp_split_start(uint split_unit);
+void dsp_split_stop(void);
+int16_t dsp_split_process_sample(int16_t sample);
+
+extern volatile uint32_t dsp_split_late_samples;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DSPSPLIT_H */
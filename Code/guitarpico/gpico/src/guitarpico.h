@@ -25,6 +25,9 @@
 #ifndef _GUITARPICO_H
 #define _GUITARPICO_H
 
+#ifdef GUITARPICO_HOST
+#include "host_pico.h"
+#else
 #include "pico.h"
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
@@ -36,9 +39,19 @@
 #include "hardware/timer.h"
 #include "hardware/sync.h"
 #include "hardware/flash.h"
+#include "hardware/structs/sio.h"
+#endif /* GUITARPICO_HOST */
 
 #define DMB() __dmb()
 
+/* get_core_num() is static in the SDK, this can also be used from the
+   inline functions of dsp.h */
+#ifdef GUITARPICO_HOST
+#define CORE_NUM() 0u
+#else
+#define CORE_NUM() (sio_hw->cpuid)
+#endif
+
 #define DAC_PWM_B3 15
 #define DAC_PWM_B2 14
 #define DAC_PWM_B1 13
@@ -77,6 +90,8 @@ uint16_t read_potentiometer_value(uint v);
 
 #define POTENTIOMETER_VALUE_SENSITIVITY 20
 #define POTENTIOMETER_MAX 6
+/* the control input the stomp pedal is plugged into */
+#define PEDAL_SWITCH_INPUT 6
 
 #ifdef __cplusplus
 }
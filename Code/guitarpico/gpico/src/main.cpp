@@ -24,9 +24,17 @@
 
 #include "main.h"
 #include "guitarpico.h"
+#include "hardware/structs/xip_ctrl.h"
 #include "ssd1306_i2c.h"
 #include "buttons.h"
 #include "dsp.h"
+#include "dspbench.h"
+#include "audioring.h"
+#include "audiodma.h"
+#include "adcdnl.h"
+#include "adccic.h"
+#include "dspsplit.h"
+#include "dspoverlay.h"
 #include "pitch.h"
 #include "ui.h"
 #include "tinycl.h"
@@ -117,7 +125,22 @@ uint16_t read_potentiometer_value(uint v)
 volatile uint32_t last1=0,last2=0,last3=0;
 volatile uint32_t dly1,dly2,dly3;
 
+/* The spread of the audio sample alarm for JITTER, dly1 and dly2 in us and
+   the time the alarm takes in processor clocks, gathered while jitter_on
+   is set */
+typedef struct
+{
+    uint32_t samples;
+    uint32_t dly1_min, dly1_max;
+    uint32_t dly2_min, dly2_max;
+    uint32_t ticks_total, ticks_max;
+} jitter_stats;
+
+volatile bool jitter_on = false;
+jitter_stats jitter;
+
 volatile uint16_t next_sample = 0;
+volatile uint32_t late_samples = 0;
 
 absolute_time_t last_time;
 
@@ -131,11 +154,48 @@ static inline absolute_time_t update_next_timeout(const absolute_time_t last_tim
 int32_t sample_avg;
 uint32_t mag_avg;
 
+static inline void control_sample_next(uint16_t sample)
+{
+    control_samples[control_sample_no] = sample;
+    control_sample_no = (control_sample_no >= 7) ? 0 : (control_sample_no+1);
+    gpio_put(GPIO_ADC_SEL0, (control_sample_no & 0x01) == 0);
+    gpio_put(GPIO_ADC_SEL1, (control_sample_no & 0x02) == 0);
+    gpio_put(GPIO_ADC_SEL2, (control_sample_no & 0x04) == 0);
+}
+
+/* a single conversion corrected by the DNL table, scaled as adc_cic_block
+   scales its samples */
+static inline int16_t audio_input_level(uint16_t sample)
+{
+    return ((int16_t)adc_dnl.table[sample & (ADC_MAX_VALUE-1)]) - (ADC_PREC_VALUE/2);
+}
+
+static inline int16_t audio_input_sample(int16_t s)
+{
+    sample_avg = (sample_avg*511)/512 + s;
+    s -= (sample_avg / 512);
+    if (s < (-ADC_PREC_VALUE/2)) s = (-ADC_PREC_VALUE/2);
+    if (s > (ADC_PREC_VALUE/2-1)) s = (ADC_PREC_VALUE/2-1);
+    mag_avg = (mag_avg*511)/512 + ((uint32_t)abs(s));
+    if (mag_avg < (512*ADC_PREC_VALUE/512))
+        pitch_current_entry = 0;
+    insert_pitch_edge(s, counter);
+    return s;
+}
+
+static inline uint16_t audio_output_level(int16_t s)
+{
+    if (s > (ADC_PREC_VALUE/2-1)) return DAC_PWM_WRAP_VALUE-1;
+    if (s < (-ADC_PREC_VALUE/2)) return 0;
+    return (s+(ADC_PREC_VALUE/2)) / (ADC_PREC_VALUE/DAC_PWM_WRAP_VALUE);
+}
+
 static void __no_inline_not_in_flash_func(alarm_func)(uint alarm_num)
 {
     uint16_t sample;
     uint32_t cur_time;
     absolute_time_t next_alarm_time;
+    uint32_t start_ticks = dsp_bench_ticks();
 
     sample = adc_hw->result;
     cur_time = timer_hw->timelr;
@@ -147,11 +207,7 @@ static void __no_inline_not_in_flash_func(alarm_func)(uint alarm_num)
         pwm_set_both_levels(dac_pwm_b3_slice_num, next_sample, next_sample);
         pwm_set_both_levels(dac_pwm_b1_slice_num, next_sample, next_sample);
         dly3 = cur_time-last3;
-        control_samples[control_sample_no] = sample;
-        control_sample_no = (control_sample_no >= 7) ? 0 : (control_sample_no+1);
-        gpio_put(GPIO_ADC_SEL0, (control_sample_no & 0x01) == 0);
-        gpio_put(GPIO_ADC_SEL1, (control_sample_no & 0x02) == 0);
-        gpio_put(GPIO_ADC_SEL2, (control_sample_no & 0x04) == 0);
+        control_sample_next(sample);
         last_time = delayed_by_us(last_time, 10);
         do
         {
@@ -161,32 +217,69 @@ static void __no_inline_not_in_flash_func(alarm_func)(uint alarm_num)
         return;
     } 
 
-    dly1 = cur_time-last1;
+    uint32_t d1 = cur_time-last1;
+    uint32_t d2 = cur_time-last2;
+    dly1 = d1;
     last1 = cur_time;
     last3 = cur_time;
-    dly2 = cur_time-last2;
+    dly2 = d2;
 
-    int16_t s = (sample - (ADC_MAX_VALUE/2))*(ADC_PREC_VALUE/ADC_MAX_VALUE);
-    sample_avg = (sample_avg*511)/512 + s;
-    s -= (sample_avg / 512);
-    if (s < (-ADC_PREC_VALUE/2)) s = (-ADC_PREC_VALUE/2);
-    if (s > (ADC_PREC_VALUE/2-1)) s = (ADC_PREC_VALUE/2-1);
-    mag_avg = (mag_avg*511)/512 + ((uint32_t)abs(s));
-    if (mag_avg < (512*ADC_PREC_VALUE/512))
-        pitch_current_entry = 0;
-    insert_pitch_edge(s, counter);
-    insert_sample_circ_buf_clean(s);
-    s = dsp_process_all_units(s);
-    insert_sample_circ_buf(s);
-    if (s > (ADC_PREC_VALUE/2-1)) next_sample = DAC_PWM_WRAP_VALUE-1;
-    else if (s < (-ADC_PREC_VALUE/2)) next_sample = 0;
-    else next_sample = (s+(ADC_PREC_VALUE/2)) / (ADC_PREC_VALUE/DAC_PWM_WRAP_VALUE);
+    int16_t s = audio_input_sample(audio_input_level(sample));
+    s = dsp_split_unit ? dsp_split_process_sample(s) : dsp_process_sample(s);
+    next_sample = audio_output_level(s);
     last_time = delayed_by_us(last_time, 30);
     do
     {
         next_alarm_time = update_next_timeout(last_time, 0, 8);
     } while (hardware_alarm_set_target(claimed_alarm_num, next_alarm_time));
+    /* the next sample could not be scheduled on time, it slips */
+    if (to_us_since_boot(next_alarm_time) != to_us_since_boot(last_time)) late_samples++;
     counter++;
+    if (jitter_on)
+    {
+        uint32_t ticks = dsp_bench_elapsed(start_ticks, dsp_bench_ticks());
+        jitter.samples++;
+        if (d1 < jitter.dly1_min) jitter.dly1_min = d1;
+        if (d1 > jitter.dly1_max) jitter.dly1_max = d1;
+        if (d2 < jitter.dly2_min) jitter.dly2_min = d2;
+        if (d2 > jitter.dly2_max) jitter.dly2_max = d2;
+        jitter.ticks_total += ticks;
+        if (ticks > jitter.ticks_max) jitter.ticks_max = ticks;
+    }
+}
+
+/* Block mode: adc holds audio and control conversions interleaved,
+   ADC_CIC_RATIO of each per sample, and the audio is decimated to the sample
+   rate.  The control mux moves on once per block, the last control sample of
+   the block has had the longest to settle.  The mux select pins are driven
+   through SIO, which the DMA can not reach, so this is the only place it
+   can move: each of the 8 control inputs is read every 8 blocks (2.56 ms
+   at a block of 8, 10.24 ms at 32) rather than every 8 samples.  The decimator's state is in
+   main SRAM, the scratch banks are left to the core stacks. */
+static adc_cic_state adc_cic;
+
+static void __no_inline_not_in_flash_func(audio_block)(const uint16_t *adc, uint32_t *pwm, uint n)
+{
+    int16_t samples[AUDIO_DMA_BLOCK_MAX];
+    uint32_t cur_time = timer_hw->timelr;
+
+    /* the time between block interrupts for debugstuff */
+    dly1 = cur_time-last1;
+    last1 = cur_time;
+
+    adc_cic_block(&adc_cic, adc, samples, n);
+    for (uint i=0;i<n;i++)
+    {
+        samples[i] = audio_input_sample(samples[i]);
+        counter++;
+    }
+    control_sample_next(adc[2*ADC_CIC_RATIO*n-1]);
+    dsp_process_block(samples, n);
+    for (uint i=0;i<n;i++)
+    {
+        uint32_t level = audio_output_level(samples[i]);
+        pwm[i] = level | (level << 16);
+    }
 }
 
 void reset_periodic_alarm(void)
@@ -204,15 +297,11 @@ void reset_periodic_alarm(void)
 }
 
 
+/* only claims the alarm, start_audio starts it if the block size is 0 */
 void initialize_periodic_alarm(void)
 {
-    if (claimed_alarm_num != UNCLAIMED_ALARM)
-    {
-        reset_periodic_alarm();
-        return;
-    }
+    if (claimed_alarm_num != UNCLAIMED_ALARM) return;
     claimed_alarm_num = hardware_alarm_claim_unused(true);
-    reset_periodic_alarm();
     /*for (uint alarm_no=0;alarm_no<4;alarm_no++)
     {
         if (!hardware_alarm_is_claimed(alarm_no))
@@ -225,6 +314,66 @@ void initialize_periodic_alarm(void)
     } */
 }
 
+/* The control pass of the effects runs from a repeating timer on an alarm
+   pool of its own, on a hardware alarm of its own.  That alarm's interrupt
+   is given the lowest priority so that the audio alarm and DMA interrupts
+   always preempt it, without slowing the SDK's sleeps and timers on the
+   default pool. */
+static alarm_pool_t *control_pool;
+static repeating_timer_t control_timer;
+
+static bool control_timer_func(repeating_timer_t *rt)
+{
+    dsp_control_update();
+    return true;
+}
+
+void initialize_control_timer(void)
+{
+    if (control_pool == NULL)
+    {
+        control_pool = alarm_pool_create_with_unused_hardware_alarm(1);
+        irq_set_priority(TIMER_IRQ_0 + alarm_pool_hardware_alarm_num(control_pool), PICO_LOWEST_IRQ_PRIORITY);
+    }
+    alarm_pool_add_repeating_timer_us(control_pool, -((int64_t)(1000000u/DSP_CONTROL_RATE)), control_timer_func, NULL, &control_timer);
+}
+
+void stop_control_timer(void)
+{
+    cancel_repeating_timer(&control_timer);
+}
+
+/* the block size of the DMA block mode, or 0 to run the chain per sample
+   from the alarm */
+uint audio_block_size = AUDIO_RING_BLOCK_DEFAULT;
+
+void stop_audio(void)
+{
+    if (claimed_alarm_num != UNCLAIMED_ALARM)
+        hardware_alarm_cancel(claimed_alarm_num);
+    audio_dma_stop();
+}
+
+/* holds the output at its middle level, silent, until audio is started */
+void park_audio_output(void)
+{
+    next_sample = DAC_PWM_WRAP_VALUE/2;
+    pwm_set_both_levels(dac_pwm_b3_slice_num, next_sample, next_sample);
+    pwm_set_both_levels(dac_pwm_b1_slice_num, next_sample, next_sample);
+}
+
+void start_audio(void)
+{
+    stop_audio();
+    if (audio_block_size == 0)
+        reset_periodic_alarm();
+    else
+    {
+        adc_cic_reset(&adc_cic);
+        audio_dma_start(audio_block_size, ADC_CIC_RATIO, dac_pwm_b1_slice_num, dac_pwm_b3_slice_num, audio_block);
+    }
+}
+
 void initialize_adc(void)
 {
     
@@ -257,6 +406,8 @@ void initialize_gpio(void)
     gpio_put(23, 1);
 }
 
+void message_to_display(const char *msg);
+
 char buttonpressed(uint8_t b)
 {
     return button_readbutton(b) ? '1' : '0';
@@ -268,20 +419,20 @@ void adjust_parms(uint8_t unit_no)
     button_clear();
     for (;;)
     {
-        const dsp_parm_configuration_entry *d = dpce[dsp_parms[unit_no].dtn.dut];
+        const dsp_parm_configuration_entry *d = dpce[dsp_parm_entry(unit_no)->dtn.dut];
         idle_task();
         if (redraw)
         {
             if (sel == 0)
             {
                 write_str_with_spaces(0,2,"Type",16);
-                write_str_with_spaces(0,3,dtnames[dsp_parms[unit_no].dtn.dut],16);
+                write_str_with_spaces(0,3,dtnames[dsp_parm_entry(unit_no)->dtn.dut],16);
             } else
             {
                 char s[20];
                 write_str_with_spaces(0,2,d[sel-1].desc,16);
                 char *c = number_str(s, 
-                    dsp_read_value_prec((void *)(((uint8_t *)&dsp_parms[unit_no]) + d[sel-1].offset), d[sel-1].size), 
+                    dsp_read_value_prec((void *)(((uint8_t *)dsp_parm_entry(unit_no)) + d[sel-1].offset), d[sel-1].size), 
                     d[sel-1].digits, 0);
                 write_str_with_spaces(0,3,c,16);
             }
@@ -310,7 +461,7 @@ void adjust_parms(uint8_t unit_no)
             {
                 write_str_with_spaces(0,2,"Type select",16);
                 menu_str mst = { dtnames,0,3,10,0,0 };
-                mst.item = mst.itemesc = dsp_parms[unit_no].dtn.dut;
+                mst.item = mst.itemesc = dsp_parm_entry(unit_no)->dtn.dut;
                 int res;
                 do_show_menu_item(&mst);
                 do
@@ -320,10 +471,14 @@ void adjust_parms(uint8_t unit_no)
                 } while (res == 0);
                 if (res == 3)
                 {
-                    if (mst.item != dsp_parms[unit_no].dtn.dut)
+                    if (mst.item != dsp_parm_entry(unit_no)->dtn.dut)
                     {
-                        dsp_unit_initialize(unit_no, (dsp_unit_type)mst.item);
-                        dsp_unit_reset_all();
+                        if (!dsp_chain_fits(dsp_chain_cost_replace(unit_no, (dsp_unit_type)mst.item)))
+                            message_to_display("Over budget");
+                        else if (!dsp_chain_memory_fits(dsp_chain_memory_replace(unit_no, (dsp_unit_type)mst.item)))
+                            message_to_display("Out of memory");
+                        else
+                            dsp_unit_initialize(unit_no, (dsp_unit_type)mst.item);
                     }
                 }
             } else
@@ -334,7 +489,7 @@ void adjust_parms(uint8_t unit_no)
                                           d[sel-1].minval,
                                           d[sel-1].maxval,
                                           0,
-                                          dsp_read_value_prec((void *)(((uint8_t *)&dsp_parms[unit_no]) + d[sel-1].offset), d[sel-1].size),
+                                          dsp_read_value_prec((void *)(((uint8_t *)dsp_parm_entry(unit_no)) + d[sel-1].offset), d[sel-1].size),
                                           0, 0 };
                 scroll_number_start(&snd);
                 do
@@ -342,8 +497,28 @@ void adjust_parms(uint8_t unit_no)
                     idle_task();
                     scroll_number_key(&snd);
                 } while (!snd.entered);
-                if (snd.changed)
-                   dsp_set_value_prec((void *)(((uint8_t *)&dsp_parms[unit_no]) + d[sel-1].offset), d[sel-1].size, snd.n);
+                if (snd.changed && !dsp_parm_value_valid(&d[sel-1], snd.n))
+                    message_to_display("Not allowed");
+                else if (snd.changed)
+                {
+                   dsp_parm *dps = dsp_bank_edit();
+                   dsp_set_value_prec((void *)(((uint8_t *)&dps[unit_no]) + d[sel-1].offset), d[sel-1].size, snd.n);
+                   if (!dsp_chain_fits(dsp_chain_cost(dps)))
+                   {
+                       dsp_bank_abort();
+                       message_to_display("Over budget");
+                   } else if (!dsp_chain_splits(dps, dsp_split_unit))
+                   {
+                       dsp_bank_abort();
+                       message_to_display("Reads across split");
+                   } else if (dsp_chain_memory_fits(dsp_chain_memory(dps)))
+                       dsp_bank_commit();
+                   else
+                   {
+                       dsp_bank_abort();
+                       message_to_display("Out of memory");
+                   }
+                }
             }
             redraw = 1;
         }
@@ -367,7 +542,7 @@ void adjust_dsp_params(void)
             write_str(0,0,"DSP Adj");
             sprintf(s,"Unit #%d", unit_no+1);
             write_str_with_spaces(0,1,s,16);
-            write_str_with_spaces(0,2,dtnames[dsp_parms[unit_no].dtn.dut],16);
+            write_str_with_spaces(0,2,dtnames[dsp_parm_entry(unit_no)->dtn.dut],16);
             display_refresh();
             redraw = 0;
         }
@@ -434,6 +609,18 @@ inline static const uint8_t *flash_offset_address_bank(uint bankno)
     return &flashadr[flash_offset_bank(bankno)];
 }
 
+/* The ADC's DNL table is kept in the pages below the banks */
+typedef union _flash_adc_dnl
+{
+    adc_dnl_data add;
+    uint8_t      space[FLASH_PAGES(sizeof(adc_dnl_data))];
+} flash_adc_dnl;
+
+inline static uint32_t flash_offset_adc_dnl(void)
+{
+    return flash_offset_bank(FLASH_BANKS-1) - sizeof(flash_adc_dnl);
+}
+
 void message_to_display(const char *msg)
 {
     write_str_with_spaces(0,5,msg,16);
@@ -453,13 +640,17 @@ int write_data_to_flash(uint32_t flash_offset, const uint8_t *data, uint core, u
     flash_offset = FLASH_PAGES(flash_offset);
     if (!multicore_lockout_victim_is_initialized(core))
         return -1;
+    /* in block mode the PWM DMA would replay its ring for as long as the
+       write takes, a buzz at the block rate */
+    stop_audio();
+    park_audio_output();
     multicore_lockout_start_blocking();
     uint32_t ints = save_and_disable_interrupts();
     flash_range_erase(flash_offset, length);
     flash_range_program(flash_offset, data, length);
     restore_interrupts(ints);
     multicore_lockout_end_blocking();
-    reset_periodic_alarm();
+    start_audio();
     return 0;
 }
 
@@ -529,8 +720,6 @@ void pedal_control_cmd()
   }
 }
 
-#define PEDAL_SWITCH_INPUT 6
-
 static uint pedal_current_state = 0;
 static uint pedal_wait_state = 0;
 static uint pedal_current_count = 0;
@@ -553,9 +742,22 @@ int flash_load_bank(uint bankno)
     {
         if (fl->fld.gen_no > last_gen_no)
             last_gen_no = fl->fld.gen_no;
+        /* checked as loaded, settings saved by older code can hold values
+           SET would refuse */
+        dsp_parm *dps = dsp_bank_edit();
+        memcpy((void *)dps, (void *) &fl->fld.dsp_parms, sizeof(fl->fld.dsp_parms));
+        dsp_parms_validate(dps);
+        int res = 0;
+        if (!dsp_chain_fits(dsp_chain_cost(dps))) res = -2;
+        else if (!dsp_chain_memory_fits(dsp_chain_memory(dps))) res = -3;
+        else if (!dsp_chain_splits(dps, dsp_split_unit)) res = -4;
+        if (res != 0)
+        {
+            dsp_bank_abort();
+            return res;
+        }
         memcpy(desc, fl->fld.desc, sizeof(desc));
-        memcpy((void *)dsp_parms, (void *) &fl->fld.dsp_parms, sizeof(dsp_parms));
-        dsp_unit_reset_all();
+        if (!dsp_bank_commit_crossfade()) dsp_bank_commit();
     } else return -1;
     return 0;
 }
@@ -570,13 +772,7 @@ void pedal_switch(void)
 
     if (!pedal_onoff) return;
 
-    uint val = read_potentiometer_value(PEDAL_SWITCH_INPUT);
-    uint state = 0;
-
-    if ((val>=(POT_MAX_VALUE*2/16)) && (val<(POT_MAX_VALUE*4/16))) state = 1;
-    if ((val>=(POT_MAX_VALUE*4/16)) && (val<(POT_MAX_VALUE*6/16))) state = 2;
-    if ((val>=(POT_MAX_VALUE*7/16)) && (val<(POT_MAX_VALUE*9/16))) state = 3;
-    if ((val>=(POT_MAX_VALUE*10/16)) && (val<(POT_MAX_VALUE*12/16))) state = 4;
+    uint state = dsp_pedal_button(read_potentiometer_value(PEDAL_SWITCH_INPUT));
 
     if (pedal_wait_state != state)
     {
@@ -590,15 +786,17 @@ void pedal_switch(void)
     {
         pedal_current_state = pedal_wait_state;
         pedal_display_state();
-        if (pedal_current_state > 0)
+        /* a Looper on the pedal input takes the buttons for itself */
+        if ((pedal_current_state > 0) && (!dsp_loop_pedal_input(PEDAL_SWITCH_INPUT)))
         {
-            if (flash_load_bank(pedal_control[pedal_current_state-1]-1) == 0)
+            int res = flash_load_bank(pedal_control[pedal_current_state-1]-1);
+            if (res == 0)
             {
                 char s[20];
                 sprintf(s,"Bank loaded %02u",pedal_control[pedal_current_state-1]);
                 write_str_with_spaces(0,5,s,16);
             } else
-                write_str_with_spaces(0,5,"Bank NOT loaded",16);
+                write_str_with_spaces(0,5,res == -2 ? "Bank over budget" : (res == -3 ? "Bank out of mem" : (res == -4 ? "Bank reads split" : "Bank NOT loaded")),16);
         } 
         set_cursor(15,5);
         display_refresh();
@@ -610,7 +808,8 @@ int flash_load(void)
 {
     uint bankno;
     if ((bankno = select_bankno(1)) == 0) return -1;
-    message_to_display(flash_load_bank(bankno-1) ? "Not Loaded" : "Loaded");
+    int res = flash_load_bank(bankno-1);
+    message_to_display(res == 0 ? "Loaded" : (res == -2 ? "Over budget" : (res == -3 ? "Out of memory" : (res == -4 ? "Reads split" : "Not Loaded"))));
     return 0;
 }
 
@@ -650,12 +849,35 @@ int flash_save_bank(uint bankno)
     fl->fld.magic_number = FLASH_MAGIC_NUMBER;
     fl->fld.gen_no = (++last_gen_no);
     memcpy(fl->fld.desc, desc, sizeof(fl->fld.desc));
-    memcpy((void *)&fl->fld.dsp_parms, (void *)dsp_parms, sizeof(fl->fld.dsp_parms));
+    memcpy((void *)&fl->fld.dsp_parms, (void *)dsp_bank_active->parms, sizeof(fl->fld.dsp_parms));
     int ret = write_data_to_flash(flash_offset_bank(bankno), (uint8_t *) fl, 1, sizeof(flash_layout));
     free(fl);
     return ret;
 }
 
+/* a table that was never saved, or was torn by a power failure while it
+   was written, leaves the straight line */
+void flash_load_adc_dnl(void)
+{
+    const adc_dnl_data *add = (const adc_dnl_data *) &((const uint8_t *) FLASH_BASE_ADR)[flash_offset_adc_dnl()];
+    if (adc_dnl_valid(add))
+        memcpy((void *)&adc_dnl, (const void *)add, sizeof(adc_dnl));
+    else
+        adc_dnl_reset(&adc_dnl);
+}
+
+int flash_save_adc_dnl(void)
+{
+    flash_adc_dnl *fad;
+
+    if ((fad = (flash_adc_dnl *)malloc(sizeof(flash_adc_dnl))) == NULL) return -1;
+    memset((void *)fad,'\000',sizeof(flash_adc_dnl));
+    memcpy((void *)&fad->add, (const void *)&adc_dnl, sizeof(fad->add));
+    int ret = write_data_to_flash(flash_offset_adc_dnl(), (uint8_t *) fad, 1, sizeof(flash_adc_dnl));
+    free(fad);
+    return ret;
+}
+
 void flash_save(void)
 {
     uint bankno;
@@ -795,7 +1017,10 @@ void debugstuff(void)
         sprintf(str,"%u %c%c%c%c%c",counter,buttonpressed(0),buttonpressed(1),buttonpressed(2),buttonpressed(3),buttonpressed(4));
         ssd1306_set_cursor(0,0);
         ssd1306_printstring(str);
-        sprintf(str,"dlys: %u %u %u",dly1,dly2,dly3);
+        if (audio_block_size == 0)
+            sprintf(str,"dlys: %u %u %u",dly1,dly2,dly3);
+        else
+            sprintf(str,"blk: %u us late %u",dly1,audio_dma_late_blocks);
         ssd1306_set_cursor(0,1);
         ssd1306_printstring(str);
         sprintf(str,"c1: %u %u %u",control_samples[0],control_samples[1],control_samples[2]);
@@ -804,7 +1029,7 @@ void debugstuff(void)
         sprintf(str,"c2: %u %u %u",control_samples[3],control_samples[4],control_samples[6]);
         ssd1306_set_cursor(0,3);
         ssd1306_printstring(str);
-        sprintf(str,"buf: %d",sample_circ_buf_value(0));
+        sprintf(str,"buf: %d",sample_circ_buf_clean_value(0));
         ssd1306_set_cursor(0,4);
         ssd1306_printstring(str);
          sprintf(str,"rate %u",(uint32_t)((((uint64_t)counter)*1000000)/time_us_32()));
@@ -864,10 +1089,25 @@ int init_cmd(int args, tinycl_parameter* tp, void *v)
   uint unit_no=tp[0].ti.i;
   uint type_no=tp[1].ti.i;  
   
-  if (unit_no > 0)
+  if ((unit_no > 0) && (unit_no <= MAX_DSP_UNITS) && (type_no < DSP_TYPE_MAX_ENTRY))
   {
+    uint32_t cost = dsp_chain_cost_replace(unit_no-1, (dsp_unit_type) type_no);
+    if (!dsp_chain_fits(cost))
+    {
+        char s[80];
+        sprintf(s,"Not applied, chain cost %u over budget %u\r\n", cost, dsp_chain_budget);
+        tinycl_put_string(s);
+        return 1;
+    }
+    uint32_t memory = dsp_chain_memory_replace(unit_no-1, (dsp_unit_type) type_no);
+    if (!dsp_chain_memory_fits(memory))
+    {
+        char s[80];
+        sprintf(s,"Not applied, chain memory %u over %u bytes\r\n", memory, DSP_ARENA_SIZE);
+        tinycl_put_string(s);
+        return 1;
+    }
     dsp_unit_initialize(unit_no-1, (dsp_unit_type) type_no);
-    dsp_unit_reset_all();
   }
   return 1;
 }
@@ -960,8 +1200,9 @@ int save_cmd(int args, tinycl_parameter* tp, void *v)
 int load_cmd(int args, tinycl_parameter* tp, void *v)
 {
   uint bankno=tp[0].ti.i;
+  int res = (bankno == 0) ? -1 : flash_load_bank(bankno-1);
  
-  tinycl_put_string((bankno == 0) || flash_load_bank(bankno-1) ? "Not Loaded\r\n" : "Loaded\r\n");
+  tinycl_put_string(res == 0 ? "Loaded\r\n" : (res == -2 ? "Not Loaded, over budget\r\n" : (res == -3 ? "Not Loaded, out of memory\r\n" : (res == -4 ? "Not Loaded, reads back across the split\r\n" : "Not Loaded\r\n"))));
   return 1;
 }
 
@@ -1035,6 +1276,325 @@ int a_cmd(int args, tinycl_parameter* tp, void *v)
     return 1;
 }
 
+int bench_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    uint samples = tp[0].ti.i;
+    if (samples == 0) samples = 256;
+    tinycl_put_string("Audio paused during benchmark\r\n");
+    /* the benchmark runs its unit at the start of the arena, where the
+       control pass would otherwise clear the units of the chain over it */
+    stop_control_timer();
+    stop_audio();
+    dsp_bench_report(tinycl_put_string, samples);
+    initialize_control_timer();
+    start_audio();
+    return 1;
+}
+
+int cost_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    const dsp_bank *db = dsp_bank_active;
+    uint32_t cost = dsp_chain_cost(db->parms);
+    for (uint unit_no=0;unit_no<MAX_DSP_UNITS;unit_no++)
+    {
+        dsp_unit_type dut = db->parms[unit_no].dtn.dut;
+        if (dut == DSP_TYPE_NONE) continue;
+        sprintf(s,"%2u %-11s %6u\r\n", unit_no+1, dtnames[dut], dsp_unit_cost(&db->parms[unit_no]));
+        tinycl_put_string(s);
+    }
+    sprintf(s,"Chain %u of budget %u cycles (%u%% of sample period)\r\n", cost, dsp_chain_budget, DSP_CHAIN_BUDGET_PERCENT);
+    tinycl_put_string(s);
+    sprintf(s,"%u units reach the output and are run\r\n", db->schedule.count);
+    tinycl_put_string(s);
+    sprintf(s,"Memory %u of %u bytes\r\n", dsp_chain_memory(db->parms), DSP_ARENA_SIZE);
+    tinycl_put_string(s);
+    if (dsp_split_unit != 0)
+    {
+        sprintf(s,"Split after unit %u, cost is of the busier core\r\n", dsp_split_unit);
+        tinycl_put_string(s);
+    }
+    sprintf(s,"Late samples %u, late blocks %u, late split %u\r\n", late_samples, audio_dma_late_blocks, dsp_split_late_samples);
+    tinycl_put_string(s);
+    sprintf(s,"Crossfade %u ms, tails %u ms, worst %u cycles per %s\r\n", dsp_crossfade_ms, dsp_crossfade_tail_ms, dsp_crossfade_worst,
+                audio_block_size ? "block" : "sample");
+    tinycl_put_string(s);
+    return 1;
+}
+
+int fade_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    uint fade_ms = tp[0].ti.i;
+    uint tail_ms = tp[1].ti.i;
+
+    if ((fade_ms > DSP_CROSSFADE_MAX_MS) || (tail_ms > DSP_CROSSFADE_TAIL_MAX_MS))
+    {
+        sprintf(s,"Crossfade must be 0 to %u ms, tails 0 to %u ms\r\n", DSP_CROSSFADE_MAX_MS, DSP_CROSSFADE_TAIL_MAX_MS);
+        tinycl_put_string(s);
+        return 1;
+    }
+    if (dsp_crossfade_running())
+    {
+        tinycl_put_string("Crossfade running, try again\r\n");
+        return 1;
+    }
+    dsp_crossfade_ms = fade_ms;
+    dsp_crossfade_tail_ms = tail_ms;
+    dsp_crossfade_worst = 0;
+    if (fade_ms == 0)
+        tinycl_put_string("Bank loads switch at once\r\n");
+    else
+    {
+        sprintf(s,"Bank loads crossfade over %u ms, old chain runs %u ms more\r\n", fade_ms, tail_ms);
+        tinycl_put_string(s);
+    }
+    return 1;
+}
+
+int block_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    uint block_size = tp[0].ti.i;
+
+    if ((block_size != 0) && (!audio_dma_block_size_valid(block_size)))
+    {
+        tinycl_put_string("Block size must be 0 (per sample), 4, 8, 16 or 32\r\n");
+        return 1;
+    }
+    if ((block_size != 0) && (dsp_split_unit != 0))
+    {
+        tinycl_put_string("Block mode does not run with the chain split, SPLIT 0 first\r\n");
+        return 1;
+    }
+    audio_block_size = block_size;
+    start_audio();
+    if (audio_block_size == 0)
+        tinycl_put_string("Per sample processing\r\n");
+    else
+    {
+        sprintf(s,"Blocks of %u samples, %u us latency, controls read every %u us\r\n", audio_block_size,
+                (audio_ring_latency(audio_block_size)*1000000u)/GUITARPICO_SAMPLERATE + ADC_CIC_DELAY_US,
+                (8*audio_block_size*1000000u)/GUITARPICO_SAMPLERATE);
+        tinycl_put_string(s);
+    }
+    return 1;
+}
+
+int split_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    uint split_unit = tp[0].ti.i;
+
+    if (split_unit >= MAX_DSP_UNITS)
+    {
+        sprintf(s,"Split must be 0 (one core) or 1 to %u\r\n", MAX_DSP_UNITS-1);
+        tinycl_put_string(s);
+        return 1;
+    }
+    if ((split_unit != 0) && (audio_block_size != 0))
+    {
+        tinycl_put_string("The chain is only split per sample, BLOCK 0 first\r\n");
+        return 1;
+    }
+    if (!dsp_chain_splits(dsp_bank_active->parms, split_unit))
+    {
+        sprintf(s,"Not split, a unit up to %u reads back from a later unit\r\n", split_unit);
+        tinycl_put_string(s);
+        return 1;
+    }
+    stop_audio();
+    if (split_unit == 0)
+    {
+        if (dsp_split_unit != 0)
+        {
+            dsp_split_stop();
+            initialize_video();
+        }
+        tinycl_put_string("Chain on core 0, video on\r\n");
+    } else
+    {
+        if (dsp_split_unit == 0) halt_video();
+        dsp_split_start(split_unit);
+        sprintf(s,"Units 1-%u on core 0, %u-%u on core 1, video off, %u us more latency\r\n",
+                    split_unit, split_unit+1, MAX_DSP_UNITS, 1000000u/GUITARPICO_SAMPLERATE);
+        tinycl_put_string(s);
+    }
+    start_audio();
+    return 1;
+}
+
+#define OVERLAY_MEASURE_MS 200
+
+/* XIP cache accesses that missed over OVERLAY_MEASURE_MS, of everything
+   running on both cores */
+static uint32_t overlay_xip_misses(void)
+{
+    xip_ctrl_hw->ctr_hit = 0;
+    xip_ctrl_hw->ctr_acc = 0;
+    sleep_ms(OVERLAY_MEASURE_MS);
+    return xip_ctrl_hw->ctr_acc - xip_ctrl_hw->ctr_hit;
+}
+
+int overlay_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    uint enable = tp[0].ti.i;
+
+    uint32_t before = overlay_xip_misses();
+    dsp_overlay_enable(enable != 0, dsp_bank_active->parms);
+    uint32_t after = overlay_xip_misses();
+    sprintf(s,"Overlay %u of %u bytes:", dsp_overlay_bytes(), DSP_OVERLAY_BYTES);
+    tinycl_put_string(s);
+    for (uint i=0;i<DSP_OVERLAY_TABLES;i++)
+    {
+        if (!(dsp_overlay_loaded() & (1u << i))) continue;
+        sprintf(s," %s", dsp_overlay_name(i));
+        tinycl_put_string(s);
+    }
+    sprintf(s,"\r\nXIP misses in %u ms, before %u, after %u\r\n", OVERLAY_MEASURE_MS, before, after);
+    tinycl_put_string(s);
+    return 1;
+}
+
+#define JITTER_MS_MAX 1000
+#define JITTER_SETTLE_MS 20
+
+static void jitter_measure(uint ms, jitter_stats *js)
+{
+    sleep_ms(JITTER_SETTLE_MS);
+    jitter.samples = 0;
+    jitter.dly1_min = UINT32_MAX;
+    jitter.dly1_max = 0;
+    jitter.dly2_min = UINT32_MAX;
+    jitter.dly2_max = 0;
+    jitter.ticks_total = 0;
+    jitter.ticks_max = 0;
+    DMB();
+    jitter_on = true;
+    sleep_ms(ms);
+    jitter_on = false;
+    DMB();
+    *js = jitter;
+}
+
+static void jitter_print(const char *video, const jitter_stats *js)
+{
+    char s[80];
+    if (js->samples == 0)
+        sprintf(s,"%-5s   no samples\r\n", video);
+    else
+        sprintf(s,"%-5s %7u %4u-%-4u %4u-%-4u %6u/%u\r\n", video, js->samples, js->dly1_min, js->dly1_max,
+                js->dly2_min, js->dly2_max, js->ticks_total / js->samples, js->ticks_max);
+    tinycl_put_string(s);
+}
+
+/* The audio alarm with the VGA DMA and core 1 drawing, and again with video
+   halted, so that the time lost waiting on the bus shows in the spread */
+int jitter_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[80];
+    uint ms = tp[0].ti.i;
+    jitter_stats video_on, video_off;
+
+    if ((ms == 0) || (ms > JITTER_MS_MAX))
+    {
+        sprintf(s,"Time must be 1 to %u ms\r\n", JITTER_MS_MAX);
+        tinycl_put_string(s);
+        return 1;
+    }
+    if ((audio_block_size != 0) || (dsp_split_unit != 0))
+    {
+        tinycl_put_string("The sample alarm is timed with video on, BLOCK 0 and SPLIT 0 first\r\n");
+        return 1;
+    }
+    jitter_measure(ms, &video_on);
+    stop_audio();
+    halt_video();
+    start_audio();
+    jitter_measure(ms, &video_off);
+    stop_audio();
+    initialize_video();
+    start_audio();
+    tinycl_put_string("Video Samples dly1 us    dly2 us    clocks mean/worst\r\n");
+    jitter_print("on", &video_on);
+    jitter_print("off", &video_off);
+    return 1;
+}
+
+#define ADC_DNL_CONVERSIONS (1u << 20)
+#define ADC_DNL_CHUNK 4096
+
+/* Counts the codes of ADC_DNL_CONVERSIONS conversions of the audio input,
+   back to back at the ADC's full rate, with audio stopped.  The USB and
+   buttons are serviced between chunks.  The caller starts audio again. */
+static void adc_dnl_capture(uint16_t *hist)
+{
+    stop_audio();
+    memset((void *)hist,'\000',ADC_MAX_VALUE*sizeof(uint16_t));
+    adc_run(false);
+    adc_set_round_robin(0);
+    adc_select_input(0);
+    adc_set_clkdiv(0);
+    adc_fifo_setup(true, false, 1, false, false);
+    for (uint32_t n=0;n<ADC_DNL_CONVERSIONS;n+=ADC_DNL_CHUNK)
+    {
+        adc_fifo_drain();
+        adc_run(true);
+        for (uint i=0;i<ADC_DNL_CHUNK;i++)
+        {
+            uint16_t code = adc_fifo_get_blocking() & (ADC_MAX_VALUE-1);
+            if (hist[code] < 0xFFFF) hist[code]++;
+        }
+        adc_run(false);
+        idle_task();
+    }
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    initialize_adc();
+}
+
+/* ADCCAL 1 with a steady sine at the input that swings over most of the
+   ADC's range without clipping builds and saves the DNL table, ADCCAL 0
+   saves the straight line */
+int adccal_cmd(int args, tinycl_parameter* tp, void *v)
+{
+    char s[100];
+    uint16_t *hist;
+    adc_dnl_report adr;
+
+    if (tp[0].ti.i == 0)
+    {
+        stop_audio();
+        adc_dnl_reset(&adc_dnl);
+        start_audio();
+        tinycl_put_string(flash_save_adc_dnl() ? "Straight line, not saved\r\n" : "Straight line saved\r\n");
+        return 1;
+    }
+    if ((hist = (uint16_t *)malloc(ADC_MAX_VALUE*sizeof(uint16_t))) == NULL)
+    {
+        tinycl_put_string("Out of memory\r\n");
+        return 1;
+    }
+    tinycl_put_string("Counting codes\r\n");
+    adc_dnl_capture(hist);
+    bool built = adc_dnl_build(hist, &adc_dnl, &adr);
+    free(hist);
+    start_audio();
+    if (!built)
+    {
+        sprintf(s,"Needs a sine over at least %u codes, not clipped\r\n", ADC_DNL_MIN_CODES);
+        tinycl_put_string(s);
+        return 1;
+    }
+    uint worst = abs(adr.worst_correction)*(100/(ADC_PREC_VALUE/ADC_MAX_VALUE));
+    sprintf(s,"Codes %u-%u corrected, most %c%u.%02u codes at %u\r\n", adr.first_code, adr.last_code,
+            adr.worst_correction < 0 ? '-' : '+', worst / 100, worst % 100, adr.worst_code);
+    tinycl_put_string(s);
+    tinycl_put_string(flash_save_adc_dnl() ? "Not saved\r\n" : "Saved\r\n");
+    return 1;
+}
+
 int help_cmd(int args, tinycl_parameter *tp, void *v);
 
 const tinycl_command tcmds[] =
@@ -1048,6 +1608,14 @@ const tinycl_command tcmds[] =
   { "CONF", "Get configuration list", conf_cmd, TINYCL_PARM_INT, TINYCL_PARM_INT, TINYCL_PARM_END },
   { "INIT", "Set type of effect", init_cmd, TINYCL_PARM_INT, TINYCL_PARM_INT, TINYCL_PARM_END },
   { "TYPE", "Get type of effect", type_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "BENCH", "Benchmark effect types", bench_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "COST", "Chain cost and budget", cost_cmd, TINYCL_PARM_END },
+  { "BLOCK", "Set block size", block_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "SPLIT", "Split chain across cores", split_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "FADE", "Set bank crossfade", fade_cmd, TINYCL_PARM_INT, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "OVERLAY", "Tables in SRAM, misses", overlay_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "JITTER", "Time sample alarm, video on/off", jitter_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
+  { "ADCCAL", "Calibrate ADC DNL, 0 clears", adccal_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
   { "A", "Test autocorrelation", a_cmd, TINYCL_PARM_END },
   { "TEST", "Test", test_cmd, TINYCL_PARM_INT, TINYCL_PARM_END },
   { "HELP", "Display This Help", help_cmd, {TINYCL_PARM_END } }
@@ -1070,8 +1638,12 @@ int main()
     initialize_pwm();
     ssd1306_Initialize();
     initialize_video();
+    dsp_bench_calibrate(DSP_BENCH_CALIBRATE_SAMPLES);
     initialize_adc();
+    initialize_control_timer();
     initialize_periodic_alarm();
+    flash_load_adc_dnl();
+    start_audio();
     flash_load_most_recent();
     
     for (;;)
@@ -1,6 +1,7 @@
 /* waves.c */
 
 #include <stdint.h>
+#include "waves.h"
 
 const int16_t table_sine[1024]={
     0,201,402,603,804,1005,1206,1407,1608,1809,2009,2210,2410,2611,2811,3012,
@@ -69,4 +70,185 @@ const int16_t table_sine[1024]={
     -3212,-3012,-2811,-2611,-2410,-2210,-2009,-1809,-1608,-1407,-1206,-1005,-804,-603,-402,-201};
 
 
+/* a quarter of a sine wave in Q30 for the filter coefficients, which need
+   more than the 16 bits of table_sine */
+const int32_t table_sine_quarter[SINE_QUARTER_LENGTH+1]={
+    0,6588356,13176464,19764076,26350943,32936819,39521455,46104602,
+    52686014,59265442,65842639,72417357,78989349,85558366,92124163,98686491,
+    105245103,111799753,118350194,124896179,131437462,137973796,144504935,151030634,
+    157550647,164064728,170572633,177074115,183568930,190056834,196537583,203010932,
+    209476638,215934457,222384147,228825464,235258165,241682010,248096755,254502159,
+    260897982,267283981,273659918,280025552,286380643,292724951,299058239,305380268,
+    311690799,317989595,324276419,330551034,336813204,343062693,349299266,355522689,
+    361732726,367929144,374111709,380280190,386434353,392573967,398698801,404808624,
+    410903207,416982319,423045732,429093217,435124548,441139496,447137835,453119340,
+    459083786,465030947,470960600,476872522,482766489,488642281,494499676,500338453,
+    506158392,511959275,517740883,523502998,529245404,534967884,540670223,546352205,
+    552013618,557654248,563273883,568872310,574449320,580004702,585538248,591049748,
+    596538995,602005783,607449906,612871159,618269338,623644239,628995660,634323400,
+    639627258,644907034,650162530,655393548,660599890,665781362,670937767,676068911,
+    681174602,686254647,691308855,696337036,701339000,706314559,711263525,716185713,
+    721080937,725949013,730789757,735602987,740388522,745146182,749875788,754577161,
+    759250125,763894504,768510122,773096806,777654384,782182683,786681534,791150767,
+    795590213,799999706,804379079,808728167,813046808,817334838,821592095,825818421,
+    830013654,834177638,838310216,842411232,846480531,850517961,854523370,858496606,
+    862437520,866345964,870221790,874064853,877875009,881652112,885396022,889106597,
+    892783698,896427186,900036924,903612776,907154608,910662286,914135678,917574653,
+    920979082,924348837,927683790,930983817,934248793,937478595,940673101,943832191,
+    946955747,950043650,953095785,956112036,959092290,962036435,964944360,967815955,
+    970651112,973449725,976211688,978936898,981625251,984276646,986890984,989468165,
+    992008094,994510675,996975812,999403415,1001793390,1004145648,1006460100,1008736660,
+    1010975242,1013175761,1015338134,1017462281,1019548121,1021595575,1023604567,1025575020,
+    1027506862,1029400018,1031254418,1033069992,1034846671,1036584389,1038283080,1039942680,
+    1041563127,1043144360,1044686319,1046188946,1047652185,1049075980,1050460278,1051805027,
+    1053110176,1054375676,1055601479,1056787540,1057933813,1059040255,1060106826,1061133483,
+    1062120190,1063066909,1063973603,1064840240,1065666786,1066453210,1067199483,1067905576,
+    1068571464,1069197120,1069782521,1070327646,1070832474,1071296985,1071721163,1072104991,
+    1072448455,1072751542,1073014240,1073236540,1073418433,1073559913,1073660973,1073721611,
+    1073741824};
+
 const int16_t *wavetables[1]= { table_sine };
+
+/* the transfer curves of the Waveshaper from -8 to 8 in steps of 1/32,
+   printed by CircuitSim/genshaper.m */
+const int16_t table_shaper_tanh[SHAPER_LENGTH+1]={
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,
+    -32766,-32766,-32766,-32766,-32766,-32766,-32765,-32765,-32765,-32765,-32765,-32765,-32765,-32765,-32764,-32764,
+    -32764,-32764,-32764,-32763,-32763,-32763,-32763,-32762,-32762,-32762,-32761,-32761,-32761,-32760,-32760,-32759,
+    -32759,-32758,-32758,-32757,-32757,-32756,-32755,-32754,-32754,-32753,-32752,-32751,-32750,-32749,-32748,-32746,
+    -32745,-32744,-32742,-32740,-32739,-32737,-32735,-32733,-32731,-32728,-32726,-32723,-32720,-32717,-32714,-32711,
+    -32707,-32703,-32699,-32695,-32690,-32685,-32680,-32675,-32669,-32662,-32656,-32648,-32641,-32633,-32624,-32615,
+    -32605,-32595,-32583,-32572,-32559,-32546,-32531,-32516,-32500,-32483,-32465,-32446,-32425,-32403,-32380,-32355,
+    -32328,-32300,-32270,-32239,-32205,-32169,-32131,-32090,-32047,-32001,-31952,-31900,-31845,-31787,-31725,-31658,
+    -31588,-31514,-31435,-31350,-31261,-31166,-31066,-30959,-30846,-30726,-30599,-30464,-30321,-30169,-30009,-29839,
+    -29659,-29469,-29267,-29054,-28829,-28592,-28340,-28075,-27796,-27501,-27190,-26863,-26518,-26156,-25775,-25375,
+    -24955,-24515,-24053,-23570,-23065,-22537,-21986,-21411,-20812,-20189,-19541,-18869,-18173,-17451,-16706,-15936,
+    -15142,-14325,-13486,-12625,-11742,-10840,-9919,-8980,-8025,-7056,-6073,-5079,-4075,-3063,-2045,-1024,
+    0,1024,2045,3063,4075,5079,6073,7056,8025,8980,9919,10840,11742,12625,13486,14325,
+    15142,15936,16706,17451,18173,18869,19541,20189,20812,21411,21986,22537,23065,23570,24053,24515,
+    24955,25375,25775,26156,26518,26863,27190,27501,27796,28075,28340,28592,28829,29054,29267,29469,
+    29659,29839,30009,30169,30321,30464,30599,30726,30846,30959,31066,31166,31261,31350,31435,31514,
+    31588,31658,31725,31787,31845,31900,31952,32001,32047,32090,32131,32169,32205,32239,32270,32300,
+    32328,32355,32380,32403,32425,32446,32465,32483,32500,32516,32531,32546,32559,32572,32583,32595,
+    32605,32615,32624,32633,32641,32648,32656,32662,32669,32675,32680,32685,32690,32695,32699,32703,
+    32707,32711,32714,32717,32720,32723,32726,32728,32731,32733,32735,32737,32739,32740,32742,32744,
+    32745,32746,32748,32749,32750,32751,32752,32753,32754,32754,32755,32756,32757,32757,32758,32758,
+    32759,32759,32760,32760,32761,32761,32761,32762,32762,32762,32763,32763,32763,32763,32764,32764,
+    32764,32764,32764,32765,32765,32765,32765,32765,32765,32765,32765,32766,32766,32766,32766,32766,
+    32766,32766,32766,32766,32766,32766,32766,32766,32766,32766,32766,32766,32766,32767,32767,32767,
+    32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,
+    32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,
+    32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,
+    32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,32767,
+    32767};
+
+const int16_t table_shaper_diode[SHAPER_LENGTH+1]={
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,-16383,
+    -16383,-16383,-16383,-16383,-16383,-16382,-16382,-16382,-16382,-16382,-16382,-16382,-16382,-16382,-16382,-16382,
+    -16381,-16381,-16381,-16381,-16381,-16381,-16381,-16380,-16380,-16380,-16380,-16379,-16379,-16379,-16379,-16378,
+    -16378,-16378,-16377,-16377,-16376,-16376,-16376,-16375,-16374,-16374,-16373,-16373,-16372,-16371,-16370,-16369,
+    -16369,-16368,-16367,-16365,-16364,-16363,-16362,-16360,-16359,-16357,-16356,-16354,-16352,-16350,-16348,-16345,
+    -16343,-16340,-16337,-16335,-16331,-16328,-16324,-16321,-16317,-16312,-16308,-16303,-16298,-16292,-16286,-16280,
+    -16273,-16266,-16258,-16250,-16242,-16233,-16223,-16213,-16201,-16190,-16177,-16164,-16150,-16135,-16119,-16102,
+    -16083,-16064,-16043,-16022,-15998,-15973,-15947,-15919,-15889,-15857,-15823,-15787,-15748,-15707,-15664,-15617,
+    -15568,-15515,-15459,-15400,-15336,-15269,-15197,-15120,-15039,-14952,-14860,-14761,-14657,-14545,-14427,-14301,
+    -14166,-14023,-13871,-13709,-13536,-13353,-13157,-12949,-12728,-12492,-12241,-11974,-11690,-11387,-11065,-10722,
+    -10356,-9968,-9554,-9113,-8644,-8145,-7614,-7048,-6446,-5806,-5123,-4397,-3624,-2801,-1925,-993,
+    0,1008,1985,2932,3850,4740,5602,6438,7248,8033,8794,9532,10247,10939,11611,12262,
+    12893,13504,14097,14671,15228,15768,16291,16798,17289,17765,18227,18674,19108,19528,19935,20330,
+    20713,21084,21443,21791,22129,22456,22774,23081,23379,23668,23948,24219,24482,24737,24984,25224,
+    25456,25681,25899,26110,26315,26513,26706,26892,27073,27248,27418,27583,27742,27897,28046,28192,
+    28332,28469,28601,28729,28854,28974,29091,29204,29313,29420,29523,29622,29719,29813,29904,29992,
+    30077,30160,30240,30318,30393,30466,30537,30606,30672,30737,30799,30860,30918,30975,31030,31084,
+    31136,31186,31234,31282,31327,31372,31415,31456,31496,31536,31573,31610,31646,31680,31714,31746,
+    31778,31808,31837,31866,31894,31921,31947,31972,31996,32020,32043,32065,32087,32108,32128,32148,
+    32167,32185,32203,32221,32237,32254,32269,32285,32300,32314,32328,32341,32355,32367,32380,32391,
+    32403,32414,32425,32436,32446,32456,32465,32475,32484,32492,32501,32509,32517,32525,32532,32539,
+    32546,32553,32560,32566,32572,32578,32584,32590,32595,32600,32605,32610,32615,32620,32624,32629,
+    32633,32637,32641,32645,32649,32652,32656,32659,32663,32666,32669,32672,32675,32678,32681,32683,
+    32686,32688,32691,32693,32695,32698,32700,32702,32704,32706,32708,32709,32711,32713,32715,32716,
+    32718,32719,32721,32722,32724,32725,32726,32727,32729,32730,32731,32732,32733,32734,32735,32736,
+    32737,32738,32739,32740,32741,32741,32742,32743,32744,32744,32745,32746,32746,32747,32748,32748,
+    32749,32749,32750,32750,32751,32751,32752,32752,32753,32753,32754,32754,32755,32755,32755,32756,
+    32756};
+
+const int16_t table_shaper_tube[SHAPER_LENGTH+1]={
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,-32767,
+    -32767,-32767,-32767,-32767,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,-32766,
+    -32766,-32766,-32766,-32766,-32766,-32766,-32765,-32765,-32765,-32765,-32765,-32765,-32765,-32765,-32764,-32764,
+    -32764,-32764,-32764,-32763,-32763,-32763,-32763,-32762,-32762,-32762,-32761,-32761,-32761,-32760,-32760,-32759,
+    -32759,-32758,-32758,-32757,-32757,-32756,-32755,-32754,-32754,-32753,-32752,-32751,-32750,-32749,-32748,-32746,
+    -32745,-32744,-32742,-32740,-32739,-32737,-32735,-32733,-32731,-32728,-32726,-32723,-32720,-32717,-32714,-32711,
+    -32707,-32703,-32699,-32695,-32690,-32685,-32680,-32675,-32669,-32662,-32656,-32648,-32641,-32633,-32624,-32615,
+    -32605,-32595,-32583,-32572,-32559,-32546,-32531,-32516,-32500,-32483,-32465,-32446,-32425,-32403,-32380,-32355,
+    -32328,-32300,-32270,-32239,-32205,-32169,-32131,-32090,-32047,-32001,-31952,-31900,-31845,-31787,-31725,-31658,
+    -31588,-31514,-31435,-31350,-31261,-31166,-31066,-30959,-30846,-30726,-30599,-30464,-30321,-30169,-30009,-29839,
+    -29659,-29469,-29267,-29054,-28829,-28592,-28340,-28075,-27796,-27501,-27190,-26863,-26518,-26156,-25775,-25375,
+    -24955,-24515,-24053,-23570,-23065,-22537,-21986,-21411,-20812,-20189,-19541,-18869,-18173,-17451,-16706,-15936,
+    -15142,-14325,-13486,-12625,-11742,-10840,-9919,-8980,-8025,-7056,-6073,-5079,-4075,-3063,-2045,-1024,
+    0,1024,2048,3071,4093,5113,6130,7143,8150,9148,10138,11115,12079,13027,13956,14866,
+    15753,16615,17452,18261,19041,19791,20510,21198,21855,22479,23072,23635,24166,24669,25142,25588,
+    26007,26401,26771,27117,27442,27747,28032,28299,28549,28783,29001,29206,29398,29578,29746,29904,
+    30052,30190,30320,30442,30557,30665,30766,30861,30951,31035,31114,31189,31260,31327,31390,31449,
+    31505,31559,31609,31657,31702,31745,31785,31824,31861,31895,31929,31960,31990,32019,32046,32072,
+    32096,32120,32142,32164,32184,32204,32223,32241,32258,32274,32290,32305,32320,32334,32347,32360,
+    32372,32384,32395,32406,32417,32427,32437,32446,32455,32464,32472,32480,32488,32495,32502,32509,
+    32516,32523,32529,32535,32541,32547,32552,32557,32562,32567,32572,32577,32581,32586,32590,32594,
+    32598,32602,32606,32609,32613,32616,32620,32623,32626,32629,32632,32635,32638,32640,32643,32646,
+    32648,32650,32653,32655,32657,32660,32662,32664,32666,32668,32670,32671,32673,32675,32677,32678,
+    32680,32682,32683,32685,32686,32688,32689,32691,32692,32693,32694,32696,32697,32698,32699,32700,
+    32702,32703,32704,32705,32706,32707,32708,32709,32710,32711,32712,32712,32713,32714,32715,32716,
+    32717,32717,32718,32719,32720,32720,32721,32722,32722,32723,32724,32724,32725,32726,32726,32727,
+    32727,32728,32728,32729,32730,32730,32731,32731,32732,32732,32733,32733,32733,32734,32734,32735,
+    32735,32736,32736,32736,32737,32737,32738,32738,32738,32739,32739,32739,32740,32740,32740,32741,
+    32741,32741,32742,32742,32742,32743,32743,32743,32744,32744,32744,32744,32745,32745,32745,32745,
+    32746};
+
+const int16_t table_shaper_foldback[SHAPER_LENGTH+1]={
+    0,1024,2048,3072,4096,5120,6144,7168,8192,9216,10240,11264,12288,13312,14336,15360,
+    16384,17407,18431,19455,20479,21503,22527,23551,24575,25599,26623,27647,28671,29695,30719,31743,
+    32767,31743,30719,29695,28671,27647,26623,25599,24575,23551,22527,21503,20479,19455,18431,17407,
+    16384,15360,14336,13312,12288,11264,10240,9216,8192,7168,6144,5120,4096,3072,2048,1024,
+    0,-1024,-2048,-3072,-4096,-5120,-6144,-7168,-8192,-9216,-10240,-11264,-12288,-13312,-14336,-15360,
+    -16384,-17407,-18431,-19455,-20479,-21503,-22527,-23551,-24575,-25599,-26623,-27647,-28671,-29695,-30719,-31743,
+    -32767,-31743,-30719,-29695,-28671,-27647,-26623,-25599,-24575,-23551,-22527,-21503,-20479,-19455,-18431,-17407,
+    -16383,-15360,-14336,-13312,-12288,-11264,-10240,-9216,-8192,-7168,-6144,-5120,-4096,-3072,-2048,-1024,
+    0,1024,2048,3072,4096,5120,6144,7168,8192,9216,10240,11264,12288,13312,14336,15360,
+    16384,17407,18431,19455,20479,21503,22527,23551,24575,25599,26623,27647,28671,29695,30719,31743,
+    32767,31743,30719,29695,28671,27647,26623,25599,24575,23551,22527,21503,20479,19455,18431,17407,
+    16383,15360,14336,13312,12288,11264,10240,9216,8192,7168,6144,5120,4096,3072,2048,1024,
+    0,-1024,-2048,-3072,-4096,-5120,-6144,-7168,-8192,-9216,-10240,-11264,-12288,-13312,-14336,-15360,
+    -16384,-17407,-18431,-19455,-20479,-21503,-22527,-23551,-24575,-25599,-26623,-27647,-28671,-29695,-30719,-31743,
+    -32767,-31743,-30719,-29695,-28671,-27647,-26623,-25599,-24575,-23551,-22527,-21503,-20479,-19455,-18431,-17407,
+    -16383,-15360,-14336,-13312,-12288,-11264,-10240,-9216,-8192,-7168,-6144,-5120,-4096,-3072,-2048,-1024,
+    0,1024,2048,3072,4096,5120,6144,7168,8192,9216,10240,11264,12288,13312,14336,15360,
+    16383,17407,18431,19455,20479,21503,22527,23551,24575,25599,26623,27647,28671,29695,30719,31743,
+    32767,31743,30719,29695,28671,27647,26623,25599,24575,23551,22527,21503,20479,19455,18431,17407,
+    16384,15360,14336,13312,12288,11264,10240,9216,8192,7168,6144,5120,4096,3072,2048,1024,
+    0,-1024,-2048,-3072,-4096,-5120,-6144,-7168,-8192,-9216,-10240,-11264,-12288,-13312,-14336,-15360,
+    -16383,-17407,-18431,-19455,-20479,-21503,-22527,-23551,-24575,-25599,-26623,-27647,-28671,-29695,-30719,-31743,
+    -32767,-31743,-30719,-29695,-28671,-27647,-26623,-25599,-24575,-23551,-22527,-21503,-20479,-19455,-18431,-17407,
+    -16384,-15360,-14336,-13312,-12288,-11264,-10240,-9216,-8192,-7168,-6144,-5120,-4096,-3072,-2048,-1024,
+    0,1024,2048,3072,4096,5120,6144,7168,8192,9216,10240,11264,12288,13312,14336,15360,
+    16383,17407,18431,19455,20479,21503,22527,23551,24575,25599,26623,27647,28671,29695,30719,31743,
+    32767,31743,30719,29695,28671,27647,26623,25599,24575,23551,22527,21503,20479,19455,18431,17407,
+    16384,15360,14336,13312,12288,11264,10240,9216,8192,7168,6144,5120,4096,3072,2048,1024,
+    0,-1024,-2048,-3072,-4096,-5120,-6144,-7168,-8192,-9216,-10240,-11264,-12288,-13312,-14336,-15360,
+    -16384,-17407,-18431,-19455,-20479,-21503,-22527,-23551,-24575,-25599,-26623,-27647,-28671,-29695,-30719,-31743,
+    -32767,-31743,-30719,-29695,-28671,-27647,-26623,-25599,-24575,-23551,-22527,-21503,-20479,-19455,-18431,-17407,
+    -16384,-15360,-14336,-13312,-12288,-11264,-10240,-9216,-8192,-7168,-6144,-5120,-4096,-3072,-2048,-1024,
+    0};
+
+const int16_t *shapertables[SHAPERTABLES_NUMBER]= { table_shaper_tanh, table_shaper_diode, table_shaper_tube, table_shaper_foldback };
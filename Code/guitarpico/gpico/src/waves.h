@@ -37,6 +37,20 @@ extern "C" {
 extern const int16_t *wavetables[WAVETABLES_NUMBER];
 
 extern const int16_t table_sine[];
+
+#define SINE_QUARTER_LENGTH 256
+
+extern const int32_t table_sine_quarter[];
+
+#define SHAPERTABLES_NUMBER 4
+#define SHAPER_LENGTH 512
+
+extern const int16_t *shapertables[SHAPERTABLES_NUMBER];
+
+extern const int16_t table_shaper_tanh[];
+extern const int16_t table_shaper_diode[];
+extern const int16_t table_shaper_tube[];
+extern const int16_t table_shaper_foldback[];
  
 #ifdef __cplusplus
 }
@@ -0,0 +1,62 @@
+/* gpicobench.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "dsp.h"
+#include "dspbench.h"
+
+/* Runs the same benchmark as the BENCH command on the pedal.  Host
+   timings are in nanoseconds against the 40 us sample period, the
+   pedal reports processor cycles against clk_sys / DSP_SAMPLERATE. */
+
+static void bench_put_string(const char *s)
+{
+    for (;*s != '\000';s++)
+        if (*s != '\r') putchar(*s);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = 20000;
+
+    if (argc > 1)
+    {
+        samples = strtoul(argv[1], NULL, 10);
+        if (samples == 0)
+        {
+            fprintf(stderr, "usage: gpicobench [samples per case]\n");
+            return 1;
+        }
+    }
+    initialize_dsp();
+    uint32_t over = dsp_bench_report(bench_put_string, samples);
+    printf("%u types over budget\n", over);
+    return 0;
+}
@@ -0,0 +1,210 @@
+/* gpicocic.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "adcdnl.h"
+#include "adccic.h"
+
+/* Checks the decimation of block mode's oversampled ADC input, adccic.c.
+   A constant input at every ADC code must come out exactly as the per
+   sample path scales a single conversion.  Tones in the passband must come
+   out within CIC_FLAT_DB of their level, and tones that fold down to
+   CIC_ALIAS_FREQ or below must be CIC_ALIAS_DB down.  Noise of the size the
+   RP2040's ADC has must come out at least CIC_BITS_MIN bits lower than it
+   is in a single conversion.  The DNL table is the straight line. */
+
+#define CIC_SAMPLERATE GUITARPICO_SAMPLERATE
+#define CIC_INPUTRATE (CIC_SAMPLERATE*ADC_CIC_RATIO)
+#define CIC_SETTLE 16
+/* one second, so each tone of a whole number of Hz is a whole number of
+   cycles */
+#define CIC_MEASURE CIC_SAMPLERATE
+
+#define CIC_AMPLITUDE 1800.0
+#define CIC_FLAT_DB 0.5
+#define CIC_FLAT_FREQ 8000
+#define CIC_ALIAS_DB 35.0
+#define CIC_ALIAS_FREQ 5000
+#define CIC_NOISE 4
+#define CIC_BITS_MIN 1.0
+
+static const uint32_t cic_passband[] = { 100, 500, 1000, 2000, 3000, 5000, 6000, 8000, 10000, 12000 };
+static const uint32_t cic_aliases[] = { 20000, 22000, 24000, 24900, 25100, 26000, 28000, 30000,
+                                        45000, 49000, 51000, 55000, 70000, 74000, 76000, 80000,
+                                        95000, 99000, 101000, 105000 };
+
+typedef struct
+{
+    double phase;
+    double step;
+    uint32_t seed;
+} cic_signal;
+
+/* one block of ADC conversions, the audio from a tone or from noise around
+   the middle of the range and the control input held in the middle */
+static void cic_fill(cic_signal *cs, uint16_t *adc, uint n)
+{
+    for (uint i=0;i<(n*ADC_CIC_RATIO);i++)
+    {
+        double v = ADC_MAX_VALUE/2;
+        if (cs->step != 0.0)
+        {
+            v += CIC_AMPLITUDE*sin(cs->phase);
+            cs->phase += cs->step;
+            if (cs->phase > (2.0*M_PI)) cs->phase -= 2.0*M_PI;
+        } else
+        {
+            cs->seed = cs->seed * 1664525u + 1013904223u;
+            v += ((int32_t)(cs->seed >> 16) % (2*CIC_NOISE+1)) - CIC_NOISE;
+        }
+        adc[2*i] = (uint16_t)floor(v + 0.5);
+        adc[2*i+1] = ADC_MAX_VALUE/2;
+    }
+}
+
+static uint cic_check_dc(void)
+{
+    uint wrong = 0;
+    uint16_t adc[2*ADC_CIC_RATIO*CIC_SETTLE];
+    int16_t out[CIC_SETTLE];
+
+    for (uint code=0;code<ADC_MAX_VALUE;code++)
+    {
+        adc_cic_state acs;
+        adc_cic_reset(&acs);
+        for (uint i=0;i<(2*ADC_CIC_RATIO*CIC_SETTLE);i++)
+            adc[i] = code;
+        adc_cic_block(&acs, adc, out, CIC_SETTLE);
+        if (out[CIC_SETTLE-1] != (((int32_t)code) - (ADC_MAX_VALUE/2))*(ADC_PREC_VALUE/ADC_MAX_VALUE))
+            wrong++;
+    }
+    printf("DC: %u of %u ADC codes wrong%s\n", wrong, ADC_MAX_VALUE, wrong ? " FAILED" : "");
+    return wrong ? 1 : 0;
+}
+
+/* the level in dB of a tone of the input at the frequency it comes out at,
+   relative to the level it went in at */
+static double cic_tone(uint32_t freq, uint32_t *out_freq)
+{
+    cic_signal cs = { 0.0, 2.0*M_PI*((double)freq)/((double)CIC_INPUTRATE), 0 };
+    adc_cic_state acs;
+    uint16_t adc[2*ADC_CIC_RATIO*CIC_SETTLE];
+    int16_t out[CIC_SETTLE];
+    double re = 0.0, im = 0.0;
+    uint32_t folded = freq % CIC_SAMPLERATE;
+
+    if (folded > (CIC_SAMPLERATE/2)) folded = CIC_SAMPLERATE - folded;
+    *out_freq = folded;
+    adc_cic_reset(&acs);
+    cic_fill(&cs, adc, CIC_SETTLE);
+    adc_cic_block(&acs, adc, out, CIC_SETTLE);
+    for (uint32_t n=0;n<CIC_MEASURE;n+=CIC_SETTLE)
+    {
+        cic_fill(&cs, adc, CIC_SETTLE);
+        adc_cic_block(&acs, adc, out, CIC_SETTLE);
+        for (uint i=0;i<CIC_SETTLE;i++)
+        {
+            double w = 2.0*M_PI*((double)folded)*((double)(n+i))/((double)CIC_SAMPLERATE);
+            re += out[i]*cos(w);
+            im += out[i]*sin(w);
+        }
+    }
+    double amplitude = 2.0*sqrt(re*re + im*im)/CIC_MEASURE;
+    return 20.0*log10(amplitude/(CIC_AMPLITUDE*(ADC_PREC_VALUE/ADC_MAX_VALUE)));
+}
+
+static uint cic_check_tones(void)
+{
+    uint failed = 0;
+
+    for (uint i=0;i<(sizeof(cic_passband)/sizeof(cic_passband[0]));i++)
+    {
+        uint32_t out_freq;
+        double db = cic_tone(cic_passband[i], &out_freq);
+        bool fail = (cic_passband[i] <= CIC_FLAT_FREQ) && (fabs(db) > CIC_FLAT_DB);
+        printf("Tone %6u Hz: %7.2f dB%s\n", cic_passband[i], db, fail ? " FAILED" : "");
+        if (fail) failed++;
+    }
+    for (uint i=0;i<(sizeof(cic_aliases)/sizeof(cic_aliases[0]));i++)
+    {
+        uint32_t out_freq;
+        double db = cic_tone(cic_aliases[i], &out_freq);
+        bool fail = (out_freq <= CIC_ALIAS_FREQ) && (db > -CIC_ALIAS_DB);
+        printf("Tone %6u Hz: %7.2f dB at %5u Hz%s\n", cic_aliases[i], db, out_freq, fail ? " FAILED" : "");
+        if (fail) failed++;
+    }
+    return failed;
+}
+
+static uint cic_check_noise(void)
+{
+    cic_signal cs = { 0.0, 0.0, 1 };
+    adc_cic_state acs;
+    uint16_t adc[2*ADC_CIC_RATIO*CIC_SETTLE];
+    int16_t out[CIC_SETTLE];
+    double in_power = 0.0, out_power = 0.0, out_mean = 0.0;
+
+    adc_cic_reset(&acs);
+    cic_fill(&cs, adc, CIC_SETTLE);
+    adc_cic_block(&acs, adc, out, CIC_SETTLE);
+    for (uint32_t n=0;n<CIC_MEASURE;n+=CIC_SETTLE)
+    {
+        cic_fill(&cs, adc, CIC_SETTLE);
+        adc_cic_block(&acs, adc, out, CIC_SETTLE);
+        for (uint i=0;i<CIC_SETTLE;i++)
+        {
+            /* the first conversion of the sample is what the per sample
+               path would have taken */
+            double in = (adc[2*ADC_CIC_RATIO*i] - (ADC_MAX_VALUE/2))*(ADC_PREC_VALUE/ADC_MAX_VALUE);
+            in_power += in*in;
+            out_power += ((double)out[i])*out[i];
+            out_mean += out[i];
+        }
+    }
+    in_power /= CIC_MEASURE;
+    out_mean /= CIC_MEASURE;
+    out_power = out_power/CIC_MEASURE - out_mean*out_mean;
+    double bits = 10.0*log10(in_power/out_power)/(20.0*log10(2.0));
+    bool fail = bits < CIC_BITS_MIN;
+    printf("Noise of +/-%u codes: %.2f bits lower%s\n", CIC_NOISE, bits, fail ? " FAILED" : "");
+    return fail ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    adc_dnl_reset(&adc_dnl);
+    uint failed = cic_check_dc();
+    failed += cic_check_tones();
+    failed += cic_check_noise();
+    printf("%u checks failed\n", failed);
+    return failed ? 1 : 0;
+}
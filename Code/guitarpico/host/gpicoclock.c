@@ -0,0 +1,264 @@
+/* gpicoclock.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "guitarpico.h"
+#include "audioring.h"
+#include "adccic.h"
+
+/* A model of the sample clock of block mode, to check the ring bookkeeping
+   of audioring.c off the pedal.
+
+   First every system clock the PLL can make in the range picovga asks for
+   is given the DMA timer fraction audio_dma_start would set, and the sample
+   rate it plays at is compared with the rate the ADC converts at from the
+   48 MHz USB clock.  Fails if they differ by more than CLOCK_PPM_MAX, as the
+   rings would then slip against each other.
+
+   Then the DMA is run one conversion at a time: the ADC writes audio and
+   control conversions round robin, ADC_CIC_RATIO of each per sample, into
+   the ping and pong halves, which chain to
+   each other and raise their completion flags, and the PWM reads one entry
+   of its ring each sample.  The interrupt takes the halves given by
+   audio_ring_next_half after an entry latency, copies the audio of the
+   block to its half of the PWM ring and writes it back after a processing
+   time.  Each case checks that every sample comes out audio_ring_latency
+   samples after it went in with its control sample beside it, or that
+   the late blocks are counted when the processing does not keep up or the
+   interrupts are held off as for a flash write. */
+
+#define CLOCK_XOSC_HZ 12000000u
+#define CLOCK_ADC_HZ 48000000u
+#define CLOCK_VCO_MIN_HZ 750000000u
+#define CLOCK_VCO_MAX_HZ 1600000000u
+/* VgaCfgDef's freq and fmax */
+#define CLOCK_SYS_MIN_HZ 120000000u
+#define CLOCK_SYS_MAX_HZ 270000000u
+#define CLOCK_PPM_MAX 1.0
+
+#define CLOCK_SAMPLES 40000
+/* what the PWM ring is filled with at the start */
+#define CLOCK_SILENCE 0xFFFFu
+
+/* the cases give times in half sample periods, the model runs in
+   conversions */
+#define CLOCK_HALF_US (1000000u/(2*GUITARPICO_SAMPLERATE))
+#define CLOCK_CONVERSIONS (2*ADC_CIC_RATIO)
+
+typedef struct
+{
+    uint block_size;
+    uint irq_latency;
+    uint processing;
+    uint stall_start;
+    uint stall_length;
+    bool expect_late;
+} clock_case;
+
+static const clock_case clock_cases[] =
+{
+    /* the processing takes all but the entry of the block period */
+    {  4, 1,  7, 0, 0, false },
+    {  8, 1, 15, 0, 0, false },
+    { 16, 1, 31, 0, 0, false },
+    { 32, 1, 63, 0, 0, false },
+    /* a little more than the block period */
+    {  8, 1, 17, 0, 0, true },
+    /* interrupts off for 45 ms, as long as erasing a sector of flash */
+    {  8, 1,  8, 20001, 2250, true },
+};
+
+typedef struct
+{
+    uint32_t late_blocks;
+    uint wrong_samples;
+    uint wrong_control;
+    uint wrong_after;
+} clock_result;
+
+static uint16_t clock_audio_value(uint32_t sample)
+{
+    return sample & 0x7FFF;
+}
+
+static uint16_t clock_control_value(uint32_t sample)
+{
+    return 0x8000 | (sample & 0x7FFF);
+}
+
+static void clock_run(const clock_case *cc, clock_result *cr)
+{
+    static uint16_t adc_buf[2][CLOCK_CONVERSIONS*AUDIO_RING_BLOCK_MAX];
+    static uint16_t pwm_ring[2*AUDIO_RING_BLOCK_MAX];
+    uint16_t block[AUDIO_RING_BLOCK_MAX];
+    uint n = cc->block_size;
+    uint latency = audio_ring_latency(n);
+    uint adc_active = 0, adc_pos = 0;
+    uint pending = 0;
+    bool in_irq = false, in_block = false;
+    uint32_t irq_at = 0, commit_at = 0;
+    int half = -1;
+    volatile uint32_t late_blocks = 0;
+    /* samples out before then may be wrong from the stall, without one
+       only wrong_samples is counted */
+    uint32_t recovered = cc->stall_length ?
+            ((cc->stall_start + cc->stall_length)/2 + latency + n) : UINT32_MAX;
+    uint32_t stall_start = cc->stall_start*ADC_CIC_RATIO;
+    uint32_t stall_end = stall_start + cc->stall_length*ADC_CIC_RATIO;
+
+    memset(cr, '\000', sizeof(*cr));
+    memset(adc_buf, '\000', sizeof(adc_buf));
+    for (uint i=0;i<(2*n);i++)
+        pwm_ring[i] = CLOCK_SILENCE;
+
+    for (uint32_t t=1;t<=(CLOCK_CONVERSIONS*CLOCK_SAMPLES);t++)
+    {
+        /* the block function writes its half of the PWM ring */
+        if (in_block && (t == commit_at))
+        {
+            for (uint i=0;i<n;i++)
+                pwm_ring[half*n+i] = block[i];
+            in_block = false;
+        }
+        /* conversion t-1 completes, audio then control */
+        uint32_t c = t-1;
+        adc_buf[adc_active][adc_pos] = (c & 1) ? clock_control_value(c/CLOCK_CONVERSIONS) :
+                                                 clock_audio_value(c/CLOCK_CONVERSIONS);
+        if (++adc_pos == (CLOCK_CONVERSIONS*n))
+        {
+            adc_pos = 0;
+            if (!in_irq && (pending == 0)) irq_at = t + cc->irq_latency*ADC_CIC_RATIO;
+            pending |= adc_active ? AUDIO_RING_PONG : AUDIO_RING_PING;
+            adc_active ^= 1;
+        }
+        /* the DMA timer plays sample j, the PWM latches it at the next wrap */
+        if ((t % CLOCK_CONVERSIONS) == 0)
+        {
+            uint32_t j = t/CLOCK_CONVERSIONS - 1;
+            uint16_t expected = (j < latency) ? CLOCK_SILENCE : clock_audio_value(j - latency);
+            if (pwm_ring[j % (2*n)] != expected)
+            {
+                cr->wrong_samples++;
+                if (j >= recovered) cr->wrong_after++;
+            }
+        }
+        /* the interrupt is entered, or goes on to the next half */
+        if (!in_irq && (pending != 0) && (t >= irq_at) && ((t < stall_start) || (t >= stall_end)))
+            in_irq = true;
+        if (in_irq && !in_block)
+        {
+            half = audio_ring_next_half(pending, &late_blocks);
+            if (half < 0)
+            {
+                in_irq = false;
+                continue;
+            }
+            pending &= ~(half ? AUDIO_RING_PONG : AUDIO_RING_PING);
+            const uint16_t *adc = adc_buf[half];
+            for (uint i=0;i<n;i++)
+            {
+                /* a half taken late can be torn by the ADC between an
+                   audio sample and its control sample */
+                const uint16_t *pair = &adc[CLOCK_CONVERSIONS*i];
+                if ((pair[1] != (pair[0] | 0x8000)) && !(cc->stall_length && ((t/CLOCK_CONVERSIONS) < recovered)))
+                    cr->wrong_control++;
+                block[i] = pair[0];
+            }
+            in_block = true;
+            commit_at = t + cc->processing*ADC_CIC_RATIO;
+        }
+    }
+    cr->late_blocks = late_blocks;
+}
+
+static uint clock_check_rates(void)
+{
+    uint clocks = 0, exact = 0;
+    double worst = 0.0;
+    uint32_t worst_clk = 0;
+    uint16_t worst_num = 0, worst_den = 0;
+    uint32_t clkdiv = audio_ring_adc_clkdiv(CLOCK_ADC_HZ, GUITARPICO_SAMPLERATE, ADC_CIC_RATIO);
+    double adc_rate = ((double)CLOCK_ADC_HZ) / (CLOCK_CONVERSIONS*(clkdiv+1.0));
+
+    for (uint32_t vco=CLOCK_XOSC_HZ*((CLOCK_VCO_MIN_HZ+CLOCK_XOSC_HZ-1)/CLOCK_XOSC_HZ);vco<=CLOCK_VCO_MAX_HZ;vco+=CLOCK_XOSC_HZ)
+    {
+        for (uint pd1=1;pd1<=7;pd1++)
+        {
+            for (uint pd2=1;pd2<=pd1;pd2++)
+            {
+                uint32_t clk = vco / (pd1*pd2);
+                uint16_t num, den;
+                if ((clk < CLOCK_SYS_MIN_HZ) || (clk > CLOCK_SYS_MAX_HZ)) continue;
+                audio_ring_timer_fraction(clk, GUITARPICO_SAMPLERATE, &num, &den);
+                double rate = ((double)clk) * num / den;
+                double ppm = 1.0e6 * (rate - adc_rate) / adc_rate;
+                if (ppm < 0.0) ppm = -ppm;
+                clocks++;
+                if (ppm == 0.0) exact++;
+                if (ppm > worst)
+                {
+                    worst = ppm;
+                    worst_clk = clk;
+                    worst_num = num;
+                    worst_den = den;
+                }
+            }
+        }
+    }
+    printf("ADC %.3f Hz, %u system clocks %u to %u MHz, %u exact\n", adc_rate, clocks,
+           CLOCK_SYS_MIN_HZ/1000000u, CLOCK_SYS_MAX_HZ/1000000u, exact);
+    printf("worst drift %.4f ppm at %u Hz, timer %u/%u%s\n", worst, worst_clk, worst_num, worst_den,
+           (worst > CLOCK_PPM_MAX) ? " FAILED" : "");
+    return (worst > CLOCK_PPM_MAX) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint failed = clock_check_rates();
+    uint cases = sizeof(clock_cases)/sizeof(clock_cases[0]);
+    uint failed_cases = 0;
+
+    for (uint i=0;i<cases;i++)
+    {
+        const clock_case *cc = &clock_cases[i];
+        clock_result cr;
+        clock_run(cc, &cr);
+        bool fail = (cr.wrong_control != 0) || (cr.wrong_after != 0) ||
+                    (cc->expect_late ? (cr.late_blocks == 0) :
+                     ((cr.late_blocks != 0) || (cr.wrong_samples != 0)));
+        printf("Block %2u irq %3u us processing %4u us stall %5u us: latency %2u, %3u late blocks, %5u wrong samples, %u after, %u control%s\n",
+               cc->block_size, cc->irq_latency*CLOCK_HALF_US, cc->processing*CLOCK_HALF_US,
+               cc->stall_length*CLOCK_HALF_US, audio_ring_latency(cc->block_size),
+               cr.late_blocks, cr.wrong_samples, cr.wrong_after, cr.wrong_control, fail ? " FAILED" : "");
+        if (fail) failed_cases++;
+    }
+    printf("%u of %u cases failed\n", failed_cases, cases);
+    return (failed || failed_cases) ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/* gpicocoefs.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "dsp.h"
+
+/* Compares the fixed point biquad coefficients of dsp.c with the float
+   formulas they replace, over every frequency from 20 Hz to just under
+   the Nyquist frequency and every Q the parameters allow.  Fails if any
+   coefficient is further than COEFS_TOLERANCE from the float one.  Also
+   checks that every entry of the Waveshaper's curves is within
+   SHAPER_TOLERANCE of the formula CircuitSim/genshaper.m made it from. */
+
+#define COEFS_TOLERANCE 2
+
+#define COEFS_FREQ_MIN 20
+#define COEFS_FREQ_MAX (DSP_SAMPLERATE/2 - 1)
+#define COEFS_Q_MIN 50
+#define COEFS_Q_MAX 999
+
+#define SHAPER_TOLERANCE 1
+#define SHAPER_INPUT_MAX 8.0
+
+typedef enum
+{
+    COEFS_BP_B0 = 0, COEFS_A1, COEFS_A2, COEFS_LP_B0, COEFS_LP_B1,
+    COEFS_HP_B0, COEFS_HP_B1, COEFS_PH_A1, COEFS_PH_A2, COEFS_MAX_ENTRY
+} coefs_entry;
+
+static const char * const coefs_names[] = { "BP b0", "a1", "a2", "LP b0", "LP b1",
+                                            "HP b0", "HP b1", "Phaser a1", "Phaser a2" };
+
+/* the float formulas as the filters used them */
+static void coefs_float(uint16_t frequency, uint16_t Q, int32_t *c)
+{
+    float w0 = ((float)frequency)*(2.0f*3.1415926535f/((float)DSP_SAMPLERATE));
+    float c0 = cosf(w0);
+    float a = sinf(w0)*(50.0f)/((float)Q);
+    float bfpa0 = 1.0f/(1.0f+a);
+    float pbfpa0 = 0.999f/(1.0f+a);
+    c[COEFS_BP_B0] = float_to_sampled_int(a * bfpa0);
+    c[COEFS_A1] = float_to_sampled_int(-2.0f*c0*bfpa0);
+    c[COEFS_A2] = float_to_sampled_int((1.0f-a)*bfpa0);
+    c[COEFS_LP_B0] = float_to_sampled_int(0.5*(1.0f-c0)*bfpa0);
+    c[COEFS_LP_B1] = float_to_sampled_int((1.0f-c0)*bfpa0);
+    c[COEFS_HP_B0] = float_to_sampled_int(0.5*(1.0f+c0)*bfpa0);
+    c[COEFS_HP_B1] = float_to_sampled_int(-(1.0f+c0)*bfpa0);
+    c[COEFS_PH_A1] = float_to_sampled_int(-2.0f*c0*pbfpa0);
+    c[COEFS_PH_A2] = float_to_sampled_int((1.0f-a)*pbfpa0);
+}
+
+static void coefs_fixed(uint16_t frequency, uint16_t Q, int32_t *c)
+{
+    int32_t c0 = fixed_omega_cos(frequency);
+    int32_t a = fixed_a_value(fixed_omega_sin(frequency), Q);
+    int32_t bfpa0 = fixed_bfpa0_value(a);
+    int32_t pbfpa0 = bfpa0 - bfpa0 / 1000;
+    c[COEFS_BP_B0] = fixed_to_sampled_int(a, bfpa0);
+    c[COEFS_A1] = fixed_to_sampled_int(-2*c0, bfpa0);
+    c[COEFS_A2] = fixed_to_sampled_int(FIXED_COEF_ONE - a, bfpa0);
+    c[COEFS_LP_B0] = fixed_to_sampled_int((FIXED_COEF_ONE - c0) / 2, bfpa0);
+    c[COEFS_LP_B1] = fixed_to_sampled_int(FIXED_COEF_ONE - c0, bfpa0);
+    c[COEFS_HP_B0] = fixed_to_sampled_int((FIXED_COEF_ONE + c0) / 2, bfpa0);
+    c[COEFS_HP_B1] = fixed_to_sampled_int(-(FIXED_COEF_ONE + c0), bfpa0);
+    c[COEFS_PH_A1] = fixed_to_sampled_int(-2*c0, pbfpa0);
+    c[COEFS_PH_A2] = fixed_to_sampled_int(FIXED_COEF_ONE - a, pbfpa0);
+}
+
+static const char * const shaper_names[] = { "tanh", "diode", "tube", "foldback" };
+
+static double shaper_float(uint curve, double x)
+{
+    switch (curve)
+    {
+        case 0:  return tanh(x);
+        case 1:  return (x >= 0.0) ? (1.0 - exp(-x)) : (-0.5*(1.0 - exp(2.0*x)));
+        case 2:  return (x >= 0.0) ? (x / cbrt(1.0 + x*x*x)) : tanh(x);
+        default: return (2.0/M_PI)*asin(sin((M_PI/2.0)*x));
+    }
+}
+
+/* the largest difference of the entries of a curve from its formula */
+static int32_t shaper_worst(uint curve, uint *worst_entry)
+{
+    int32_t worst = 0;
+    *worst_entry = 0;
+    for (uint i=0;i<=SHAPER_LENGTH;i++)
+    {
+        double x = (((double)i) - SHAPER_LENGTH/2) * (2.0*SHAPER_INPUT_MAX/SHAPER_LENGTH);
+        int32_t diff = abs(shapertables[curve][i] - (int32_t)floor(32767.0*shaper_float(curve, x) + 0.5));
+        if (diff > worst)
+        {
+            worst = diff;
+            *worst_entry = i;
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t worst[COEFS_MAX_ENTRY];
+    uint16_t worst_frequency[COEFS_MAX_ENTRY], worst_Q[COEFS_MAX_ENTRY];
+    uint failed = 0;
+
+    memset(worst, 0, sizeof(worst));
+    memset(worst_frequency, 0, sizeof(worst_frequency));
+    memset(worst_Q, 0, sizeof(worst_Q));
+    for (uint frequency=COEFS_FREQ_MIN;frequency<=COEFS_FREQ_MAX;frequency++)
+    {
+        for (uint Q=COEFS_Q_MIN;Q<=COEFS_Q_MAX;Q++)
+        {
+            int32_t cf[COEFS_MAX_ENTRY], cx[COEFS_MAX_ENTRY];
+            coefs_float(frequency, Q, cf);
+            coefs_fixed(frequency, Q, cx);
+            for (uint e=0;e<COEFS_MAX_ENTRY;e++)
+            {
+                int32_t diff = abs(cx[e] - cf[e]);
+                if (diff > worst[e])
+                {
+                    worst[e] = diff;
+                    worst_frequency[e] = frequency;
+                    worst_Q[e] = Q;
+                }
+            }
+        }
+    }
+    for (uint e=0;e<COEFS_MAX_ENTRY;e++)
+    {
+        bool fail = worst[e] > COEFS_TOLERANCE;
+        printf("%-10s worst difference %d at %u Hz Q %u.%02u%s\n", coefs_names[e], worst[e],
+               worst_frequency[e], worst_Q[e] / 100, worst_Q[e] % 100, fail ? " FAILED" : "");
+        if (fail) failed++;
+    }
+    printf("%u of %u coefficients differ by more than %d\n", failed, COEFS_MAX_ENTRY, COEFS_TOLERANCE);
+    uint failed_curves = 0;
+    for (uint curve=0;curve<SHAPERTABLES_NUMBER;curve++)
+    {
+        uint worst_entry;
+        int32_t worst_curve = shaper_worst(curve, &worst_entry);
+        bool fail = worst_curve > SHAPER_TOLERANCE;
+        printf("%-10s worst difference %d at entry %u%s\n", shaper_names[curve], worst_curve, worst_entry,
+               fail ? " FAILED" : "");
+        if (fail) failed_curves++;
+    }
+    printf("%u of %u curves differ by more than %d\n", failed_curves, SHAPERTABLES_NUMBER, SHAPER_TOLERANCE);
+    return (failed || failed_curves) ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+/* gpicocic.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "adcdnl.h"
+
+/* Checks the ADC's DNL correction, adcdnl.c, against a model of an ADC
+   whose codes around 512, 1536, 2560 and 3584 are DNL_WIDE_CODES wider
+   than the rest, and whose other codes vary a little in width.  A table
+   built from the codes of DNL_CONVERSIONS conversions of a sine, as ADCCAL
+   counts them, must put each code within DNL_INL_MAX codes of the middle of
+   its input range, after the straight line through them is taken out.  The
+   sine is not a whole number of cycles, as it would not be on the bench.
+   A 1 kHz tone through the table must come out with DNL_SINAD_DB less
+   noise and distortion than through the straight line.  A sine that is too
+   quiet or is clipped must leave the table alone, and a damaged table must
+   be found out. */
+
+#define DNL_CONVERSIONS (1u << 20)
+#define DNL_WIDE_CODES 8.0
+#define DNL_RIPPLE 0.15
+#define DNL_SPREAD 0.1
+#define DNL_CAL_AMPLITUDE (0.95*ADC_MAX_VALUE/2)
+#define DNL_CAL_STEP 0.0123456789
+#define DNL_DITHER 0.5
+#define DNL_INL_MAX 0.6
+#define DNL_TONE_AMPLITUDE (0.9*ADC_MAX_VALUE/2)
+#define DNL_TONE_FREQ 1000
+#define DNL_SINAD_DB 10.0
+#define DNL_QUIET_AMPLITUDE 300.0
+#define DNL_CLIPPED_AMPLITUDE (1.1*ADC_MAX_VALUE/2)
+
+/* the lower edge of each code and the top of the last one, in codes of a
+   perfect ADC */
+static double dnl_edge[ADC_MAX_VALUE+1];
+static uint32_t dnl_seed = 1;
+
+static double dnl_random(void)
+{
+    dnl_seed = dnl_seed * 1664525u + 1013904223u;
+    return ((double)(dnl_seed >> 8)) / 16777216.0;
+}
+
+/* gaussian, of unit deviation */
+static double dnl_gauss(void)
+{
+    double u = dnl_random() + 1.0/33554432.0;
+    return sqrt(-2.0*log(u))*cos(2.0*M_PI*dnl_random());
+}
+
+static void dnl_model(void)
+{
+    double width[ADC_MAX_VALUE];
+    double total = 0.0;
+
+    for (uint k=0;k<ADC_MAX_VALUE;k++)
+    {
+        width[k] = 1.0 + DNL_RIPPLE*sin(2.0*M_PI*k/64.0) + DNL_SPREAD*(2.0*dnl_random()-1.0);
+        if ((k % 1024) == 512) width[k] += DNL_WIDE_CODES;
+        total += width[k];
+    }
+    dnl_edge[0] = 0.0;
+    for (uint k=0;k<ADC_MAX_VALUE;k++)
+        dnl_edge[k+1] = dnl_edge[k] + width[k]*ADC_MAX_VALUE/total;
+}
+
+static uint16_t dnl_convert(double v)
+{
+    uint lo = 0, hi = ADC_MAX_VALUE;
+
+    if (v < 0.0) return 0;
+    while ((hi - lo) > 1)
+    {
+        uint mid = (lo + hi) / 2;
+        if (dnl_edge[mid] <= v) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void dnl_histogram(uint16_t *hist, double amplitude)
+{
+    double phase = 0.0;
+
+    memset(hist, '\000', ADC_MAX_VALUE*sizeof(uint16_t));
+    for (uint32_t n=0;n<DNL_CONVERSIONS;n++)
+    {
+        uint16_t code = dnl_convert(ADC_MAX_VALUE/2 + amplitude*sin(phase) + DNL_DITHER*dnl_gauss());
+        if (hist[code] < 0xFFFF) hist[code]++;
+        phase += DNL_CAL_STEP;
+        if (phase > (2.0*M_PI)) phase -= 2.0*M_PI;
+    }
+}
+
+/* the worst distance of a code's value from the middle of its input range,
+   after the straight line through them is taken out */
+static double dnl_inl(const adc_dnl_data *add, uint first, uint last)
+{
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, worst = 0.0;
+    uint n = last + 1 - first;
+
+    for (uint k=first;k<=last;k++)
+    {
+        double x = 0.5*(dnl_edge[k] + dnl_edge[k+1]);
+        double y = ((double)add->table[k])/(ADC_PREC_VALUE/ADC_MAX_VALUE);
+        sx += x; sy += y; sxx += x*x; sxy += x*y;
+    }
+    double slope = (n*sxy - sx*sy)/(n*sxx - sx*sx);
+    double offset = (sy - slope*sx)/n;
+    for (uint k=first;k<=last;k++)
+    {
+        double x = 0.5*(dnl_edge[k] + dnl_edge[k+1]);
+        double y = ((double)add->table[k])/(ADC_PREC_VALUE/ADC_MAX_VALUE);
+        double r = fabs(y - (slope*x + offset));
+        if (r > worst) worst = r;
+    }
+    return worst;
+}
+
+/* noise and distortion of one second of a tone as the per sample path
+   takes it, through the table, in dB below the tone */
+static double dnl_sinad(const adc_dnl_data *add)
+{
+    double re = 0.0, im = 0.0, sum = 0.0, power = 0.0;
+    double *y = (double *)malloc(GUITARPICO_SAMPLERATE*sizeof(double));
+
+    for (uint n=0;n<GUITARPICO_SAMPLERATE;n++)
+    {
+        double w = 2.0*M_PI*((double)DNL_TONE_FREQ)*n/GUITARPICO_SAMPLERATE;
+        uint16_t code = dnl_convert(ADC_MAX_VALUE/2 + DNL_TONE_AMPLITUDE*sin(w + 0.1) + DNL_DITHER*dnl_gauss());
+        y[n] = add->table[code];
+        re += y[n]*cos(w);
+        im += y[n]*sin(w);
+        sum += y[n];
+    }
+    double mean = sum/GUITARPICO_SAMPLERATE;
+    re *= 2.0/GUITARPICO_SAMPLERATE;
+    im *= 2.0/GUITARPICO_SAMPLERATE;
+    for (uint n=0;n<GUITARPICO_SAMPLERATE;n++)
+    {
+        double w = 2.0*M_PI*((double)DNL_TONE_FREQ)*n/GUITARPICO_SAMPLERATE;
+        double e = y[n] - mean - re*cos(w) - im*sin(w);
+        power += e*e;
+    }
+    free(y);
+    power /= GUITARPICO_SAMPLERATE;
+    return 10.0*log10(0.5*(re*re + im*im)/power);
+}
+
+int main(int argc, char **argv)
+{
+    uint failed = 0;
+    adc_dnl_data *straight = (adc_dnl_data *)malloc(sizeof(adc_dnl_data));
+    adc_dnl_data *add = (adc_dnl_data *)malloc(sizeof(adc_dnl_data));
+    uint16_t *hist = (uint16_t *)malloc(ADC_MAX_VALUE*sizeof(uint16_t));
+    adc_dnl_report adr;
+
+    dnl_model();
+    adc_dnl_reset(straight);
+
+    dnl_histogram(hist, DNL_QUIET_AMPLITUDE);
+    memcpy(add, straight, sizeof(adc_dnl_data));
+    bool fail = adc_dnl_build(hist, add, &adr) || memcmp(add, straight, sizeof(adc_dnl_data));
+    printf("Quiet sine: %s%s\n", fail ? "built" : "not built", fail ? " FAILED" : "");
+    if (fail) failed++;
+
+    dnl_histogram(hist, DNL_CLIPPED_AMPLITUDE);
+    fail = adc_dnl_build(hist, add, &adr) || memcmp(add, straight, sizeof(adc_dnl_data));
+    printf("Clipped sine: %s%s\n", fail ? "built" : "not built", fail ? " FAILED" : "");
+    if (fail) failed++;
+
+    dnl_histogram(hist, DNL_CAL_AMPLITUDE);
+    fail = !adc_dnl_build(hist, add, &adr);
+    printf("Sine: %s, codes %u-%u, most %+.2f codes at %u%s\n", fail ? "not built" : "built",
+           adr.first_code, adr.last_code, ((double)adr.worst_correction)/(ADC_PREC_VALUE/ADC_MAX_VALUE),
+           adr.worst_code, fail ? " FAILED" : "");
+    if (fail) failed++;
+    else
+    {
+        double before = dnl_inl(straight, adr.first_code, adr.last_code);
+        double after = dnl_inl(add, adr.first_code, adr.last_code);
+        fail = after > DNL_INL_MAX;
+        printf("INL: %.2f codes, %.2f straight%s\n", after, before, fail ? " FAILED" : "");
+        if (fail) failed++;
+
+        before = dnl_sinad(straight);
+        after = dnl_sinad(add);
+        fail = (after - before) < DNL_SINAD_DB;
+        printf("SINAD of %u Hz: %.2f dB, %.2f dB straight%s\n", DNL_TONE_FREQ, after, before, fail ? " FAILED" : "");
+        if (fail) failed++;
+    }
+
+    fail = !adc_dnl_valid(add);
+    add->table[ADC_MAX_VALUE/2]++;
+    fail = fail || adc_dnl_valid(add);
+    printf("Damaged table: %s%s\n", fail ? "not found" : "found", fail ? " FAILED" : "");
+    if (fail) failed++;
+
+    free(hist);
+    free(add);
+    free(straight);
+    printf("%u checks failed\n", failed);
+    return failed ? 1 : 0;
+}
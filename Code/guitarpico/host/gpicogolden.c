@@ -0,0 +1,321 @@
+/* gpicogolden.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "waves.h"
+#include "dsp.h"
+#include "preset.h"
+
+/* Golden output regression for the DSP engine.  Every effect type with its
+   dsp_parm_struct_defaults entry, and every chain in golden/chains, is fed
+   the same synthetic input while the control inputs ramp up and down.  The
+   chains are also run through dsp_process_block.  The
+   int16 engine output is checked block by block against golden/reference.txt
+   with a CRC32, so any change in rounding shows up with the sample range
+   where it first happens.
+
+     gpicogolden check golden      compare against golden/reference.txt
+     gpicogolden update golden     rewrite golden/reference.txt
+
+   Only run update when a change in the sound is intended. */
+
+#define GOLDEN_BLOCK_SIZE 1024
+#define GOLDEN_BLOCKS 16
+#define GOLDEN_SAMPLES (GOLDEN_BLOCK_SIZE*GOLDEN_BLOCKS)
+#define GOLDEN_SEGMENT (GOLDEN_SAMPLES/4)
+#define GOLDEN_NAME_LEN 32
+#define GOLDEN_MAX_CASES (DSP_TYPE_MAX_ENTRY+32)
+
+const char * const golden_chains[] = { "drive", "modulation", "pitch", "pedal", "amp", "reverb", "feedback", NULL };
+const uint golden_chain_blocks[] = { 0, 8, 32 };
+
+typedef struct
+{
+    char name[GOLDEN_NAME_LEN];
+    uint32_t samples;
+    uint32_t crc;
+    uint32_t block_crc[GOLDEN_BLOCKS];
+} golden_case;
+
+static uint32_t golden_crc32(uint32_t crc, const int16_t *s, uint32_t n)
+{
+    crc = ~crc;
+    for (uint32_t i=0;i<n;i++)
+    {
+        uint8_t b[2] = { (uint8_t)(s[i] & 0xFF), (uint8_t)(((uint16_t)s[i]) >> 8) };
+        for (uint j=0;j<2;j++)
+        {
+            crc ^= b[j];
+            for (uint k=0;k<8;k++)
+                crc = (crc >> 1) ^ (0xEDB88320u & (-(crc & 0x01)));
+        }
+    }
+    return ~crc;
+}
+
+/* Integer only, so the input is the same on every host:
+     a 40 Hz to 6 kHz sweep, a decaying two note pluck over a little noise,
+     silence to let delays and reverbs ring out, and full scale square
+     bursts over noise to drive the clipping paths. */
+static int32_t golden_input_sample(uint32_t n, uint32_t *phase1, uint32_t *phase2, uint32_t *seed)
+{
+    uint32_t segment = n / GOLDEN_SEGMENT;
+    uint32_t m = n % GOLDEN_SEGMENT;
+    int32_t s;
+
+    *seed = *seed * 1664525u + 1013904223u;
+    switch (segment)
+    {
+        case 0:
+        {
+            uint32_t freq = 40 + (uint32_t)((((uint64_t)(6000 - 40)) * m) / GOLDEN_SEGMENT);
+            *phase1 += (uint32_t)((((uint64_t)freq) << 32) / DSP_SAMPLERATE);
+            return (table_sine[*phase1 >> 22] * 6000) / QUANTIZATION_MAX;
+        }
+        case 1:
+        {
+            int32_t amp = 7000 >> (m / 768);
+            *phase1 += (uint32_t)((((uint64_t)110) << 32) / DSP_SAMPLERATE);
+            *phase2 += (uint32_t)((((uint64_t)165) << 32) / DSP_SAMPLERATE);
+            s = (table_sine[*phase1 >> 22] + table_sine[*phase2 >> 22]) / 2;
+            return (s * amp) / QUANTIZATION_MAX + (((int32_t)(*seed >> 24)) - 128);
+        }
+        case 2:
+            return 0;
+        default:
+            s = ((m / 25) & 0x01) ? (ADC_PREC_VALUE/2-1) : (-ADC_PREC_VALUE/2);
+            if ((m / 512) & 0x01) s = 0;
+            return s + (((int32_t)(*seed >> 21)) - 1024);
+    }
+}
+
+/* each control input is a triangle wave at a different phase */
+static uint16_t golden_control_value(uint v, uint32_t n)
+{
+    uint32_t t = (n * 4 + v * (POT_MAX_VALUE / POTENTIOMETER_MAX)) % (2*POT_MAX_VALUE);
+    return (t < POT_MAX_VALUE) ? t : (2*POT_MAX_VALUE - 1 - t);
+}
+
+/* true if the control pass falls due in the block of samples starting at n,
+   it is run at the start of that block */
+static bool golden_control_due(uint32_t n, uint block)
+{
+    uint32_t next = ((n + DSP_CONTROL_SAMPLES - 1) / DSP_CONTROL_SAMPLES) * DSP_CONTROL_SAMPLES;
+    return next < (n + (block ? block : 1));
+}
+
+/* block is 0 for the per sample path, otherwise the dsp_process_block size,
+   with the controls only changing between blocks as on the pedal */
+static void golden_run(golden_case *gc, uint block)
+{
+    int16_t out[GOLDEN_BLOCK_SIZE];
+    uint32_t phase1 = 0, phase2 = 0, seed = 1;
+
+    gc->samples = GOLDEN_SAMPLES;
+    gc->crc = 0;
+    for (uint b=0;b<GOLDEN_BLOCKS;b++)
+    {
+        for (uint i=0;i<GOLDEN_BLOCK_SIZE;i++)
+        {
+            uint32_t n = b*GOLDEN_BLOCK_SIZE + i;
+            if ((block == 0) || ((i % block) == 0))
+            {
+                for (uint v=1;v<=POTENTIOMETER_MAX;v++)
+                    host_set_potentiometer_value(v, golden_control_value(v, n));
+                if (golden_control_due(n, block)) dsp_control_update();
+            }
+            out[i] = golden_input_sample(n, &phase1, &phase2, &seed);
+            if (block == 0)
+                out[i] = dsp_process_sample(out[i]);
+            else if (((i+1) % block) == 0)
+                dsp_process_block(&out[i+1-block], block);
+        }
+        gc->block_crc[b] = golden_crc32(0, out, GOLDEN_BLOCK_SIZE);
+        gc->crc = golden_crc32(gc->crc, out, GOLDEN_BLOCK_SIZE);
+    }
+}
+
+static uint golden_run_all(const char *dir, golden_case *gcs)
+{
+    char filename[256];
+    uint n = 0;
+
+    for (uint dut=DSP_TYPE_NONE+1;dut<DSP_TYPE_MAX_ENTRY;dut++)
+    {
+        golden_case *gc = &gcs[n++];
+        initialize_dsp();
+        dsp_unit_initialize(0, (dsp_unit_type) dut);
+        snprintf(gc->name, GOLDEN_NAME_LEN, "%s", dtnames[dut]);
+        for (char *c=gc->name;*c != '\000';c++)
+            if (*c == ' ') *c = '_';
+        golden_run(gc, 0);
+    }
+    for (uint i=0;golden_chains[i] != NULL;i++)
+    {
+        for (uint b=0;b<(sizeof(golden_chain_blocks)/sizeof(golden_chain_blocks[0]));b++)
+        {
+            golden_case *gc = &gcs[n++];
+            initialize_dsp();
+            snprintf(filename, sizeof(filename), "%s/chains/%s.txt", dir, golden_chains[i]);
+            if (!preset_load_file(filename)) return 0;
+            if (golden_chain_blocks[b] == 0)
+                snprintf(gc->name, GOLDEN_NAME_LEN, "chain_%s", golden_chains[i]);
+            else
+                snprintf(gc->name, GOLDEN_NAME_LEN, "chain_%s_b%u", golden_chains[i], golden_chain_blocks[b]);
+            golden_run(gc, golden_chain_blocks[b]);
+        }
+    }
+    return n;
+}
+
+static bool golden_write(const char *filename, const golden_case *gcs, uint n)
+{
+    FILE *fp;
+
+    if ((fp = fopen(filename, "w")) == NULL) return false;
+    fprintf(fp, "# case samples crc block_crc[%u], written by gpicogolden update\n", GOLDEN_BLOCKS);
+    for (uint i=0;i<n;i++)
+    {
+        fprintf(fp, "%s %u %08x", gcs[i].name, gcs[i].samples, gcs[i].crc);
+        for (uint b=0;b<GOLDEN_BLOCKS;b++)
+            fprintf(fp, " %08x", gcs[i].block_crc[b]);
+        fprintf(fp, "\n");
+    }
+    return fclose(fp) == 0;
+}
+
+static bool golden_read_case(FILE *fp, golden_case *gc)
+{
+    char line[512];
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *c = line;
+        int len;
+
+        if ((line[0] == '#') || (line[0] == '\n')) continue;
+        if (sscanf(c, "%31s %u %x%n", gc->name, &gc->samples, &gc->crc, &len) != 3) return false;
+        c += len;
+        for (uint b=0;b<GOLDEN_BLOCKS;b++)
+        {
+            if (sscanf(c, "%x%n", &gc->block_crc[b], &len) != 1) return false;
+            c += len;
+        }
+        return true;
+    }
+    return false;
+}
+
+static uint golden_check(const char *filename, const golden_case *gcs, uint n)
+{
+    golden_case ref;
+    bool found[GOLDEN_MAX_CASES];
+    uint failures = 0;
+    FILE *fp;
+
+    if ((fp = fopen(filename, "r")) == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return n;
+    }
+    memset(found, '\000', sizeof(found));
+    while (golden_read_case(fp, &ref))
+    {
+        uint i;
+        for (i=0;i<n;i++)
+            if (!strcmp(gcs[i].name, ref.name)) break;
+        if (i == n)
+        {
+            printf("%-16s no longer generated\n", ref.name);
+            failures++;
+            continue;
+        }
+        found[i] = true;
+        if ((gcs[i].samples == ref.samples) && (gcs[i].crc == ref.crc))
+        {
+            printf("%-16s ok\n", ref.name);
+            continue;
+        }
+        uint b;
+        for (b=0;b<GOLDEN_BLOCKS;b++)
+            if (gcs[i].block_crc[b] != ref.block_crc[b]) break;
+        printf("%-16s DIFFERS from sample %u\n", ref.name, b*GOLDEN_BLOCK_SIZE);
+        failures++;
+    }
+    fclose(fp);
+    for (uint i=0;i<n;i++)
+    {
+        if (!found[i])
+        {
+            printf("%-16s missing from %s\n", gcs[i].name, filename);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: gpicogolden check golden_dir\n"
+                    "       gpicogolden update golden_dir\n");
+}
+
+int main(int argc, char **argv)
+{
+    static golden_case gcs[GOLDEN_MAX_CASES];
+    char filename[256];
+
+    if (argc != 3)
+    {
+        usage();
+        return 1;
+    }
+    uint n = golden_run_all(argv[2], gcs);
+    if (n == 0) return 1;
+    snprintf(filename, sizeof(filename), "%s/reference.txt", argv[2]);
+    if (!strcmp(argv[1], "update"))
+    {
+        if (!golden_write(filename, gcs, n))
+        {
+            fprintf(stderr, "Could not write %s\n", filename);
+            return 1;
+        }
+        printf("%u cases written to %s\n", n, filename);
+        return 0;
+    }
+    if (!strcmp(argv[1], "check"))
+    {
+        uint failures = golden_check(filename, gcs, n);
+        printf("%u of %u cases differ\n", failures, n);
+        return (failures == 0) ? 0 : 1;
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,207 @@
+/* gpicohost.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "dsp.h"
+#include "wavfile.h"
+#include "preset.h"
+
+/* Host renderer for the DSP engine.  Audio is 16 bit PCM at the pedal sample
+   rate.  Samples are scaled to the +/- ADC_PREC_VALUE/2 range that alarm_func
+   feeds the engine, and the output is clipped as the PWM DAC would clip it. */
+
+#define HOST_STREAM_BLOCK 256
+#define HOST_SAMPLE_SCALE (65536/ADC_PREC_VALUE)
+
+static inline int16_t host_sample_in(int16_t s)
+{
+    return s / HOST_SAMPLE_SCALE;
+}
+
+static inline int16_t host_sample_out(int16_t s)
+{
+    if (s > (ADC_PREC_VALUE/2-1)) s = ADC_PREC_VALUE/2-1;
+    if (s < (-ADC_PREC_VALUE/2)) s = -ADC_PREC_VALUE/2;
+    return s * HOST_SAMPLE_SCALE;
+}
+
+/* 0 runs the engine one sample at a time, otherwise dsp_process_block size */
+static uint host_block = 0;
+/* samples until the control pass is next run, as the pedal's 1 kHz timer would */
+static uint host_control_countdown = 0;
+
+static void host_control(uint32_t samples)
+{
+    if (host_control_countdown == 0)
+    {
+        dsp_control_update();
+        host_control_countdown = DSP_CONTROL_SAMPLES;
+    }
+    host_control_countdown = (samples < host_control_countdown) ? (host_control_countdown - samples) : 0;
+}
+
+static void host_process(int16_t *data, uint32_t samples)
+{
+    for (uint32_t i=0;i<samples;i++)
+        data[i] = host_sample_in(data[i]);
+    if (host_block == 0)
+    {
+        for (uint32_t i=0;i<samples;i++)
+        {
+            host_control(1);
+            data[i] = dsp_process_sample(data[i]);
+        }
+    } else
+    {
+        for (uint32_t i=0;i<samples;i+=host_block)
+        {
+            uint n = (samples - i) < host_block ? (samples - i) : host_block;
+            host_control(n);
+            dsp_process_block(&data[i], n);
+        }
+    }
+    for (uint32_t i=0;i<samples;i++)
+        data[i] = host_sample_out(data[i]);
+}
+
+static void host_report(const char *what, uint64_t samples, uint64_t ns)
+{
+    double secs = ns / 1e9;
+    double rate = (secs > 0.0) ? (samples / secs) : 0.0;
+    fprintf(stderr, "%s: %llu samples in %.3f s, %.0f samples/s, real-time factor %.1f\n",
+            what, (unsigned long long)samples, secs, rate, rate / DSP_SAMPLERATE);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: gpicohost render [-c n=value] [-b n] preset.txt input.wav output.wav\n"
+                    "       gpicohost stream [-c n=value] [-b n] preset.txt < input.raw > output.raw\n"
+                    "  preset.txt is the output of the CONF 0 0 command\n"
+                    "  stream audio is mono signed 16 bit little endian at %u Hz\n"
+                    "  -c n=value sets control input n (1-%u) to value (0-%u)\n"
+                    "  -b n processes blocks of n (1-%u) samples as the pedal's block mode does\n",
+                    DSP_SAMPLERATE, POTENTIOMETER_MAX, POT_MAX_VALUE-1, DSP_BLOCK_MAX);
+}
+
+static int host_render(int argc, char **argv)
+{
+    wavfile_data wd;
+
+    if (argc != 3)
+    {
+        usage();
+        return 1;
+    }
+    if (!preset_load_file(argv[0])) return 1;
+    if (!wavfile_read(argv[1], &wd))
+    {
+        fprintf(stderr, "Could not read 16 bit PCM wave file %s\n", argv[1]);
+        return 1;
+    }
+    if (wd.samplerate != DSP_SAMPLERATE)
+    {
+        fprintf(stderr, "Resampling %s from %u Hz to %u Hz\n", argv[1], wd.samplerate, DSP_SAMPLERATE);
+        if (!wavfile_resample(&wd, DSP_SAMPLERATE))
+        {
+            wavfile_free(&wd);
+            return 1;
+        }
+    }
+    uint64_t start = host_time_ns();
+    host_process(wd.data, wd.samples);
+    host_report("render", wd.samples, host_time_ns() - start);
+    bool ok = wavfile_write(argv[2], wd.data, wd.samples, DSP_SAMPLERATE);
+    if (!ok) fprintf(stderr, "Could not write %s\n", argv[2]);
+    wavfile_free(&wd);
+    return ok ? 0 : 1;
+}
+
+static int host_stream(int argc, char **argv)
+{
+    int16_t buf[HOST_STREAM_BLOCK];
+    uint64_t samples = 0, ns = 0;
+    size_t n;
+
+    if (argc != 1)
+    {
+        usage();
+        return 1;
+    }
+    if (!preset_load_file(argv[0])) return 1;
+    while ((n = fread(buf, sizeof(int16_t), HOST_STREAM_BLOCK, stdin)) > 0)
+    {
+        uint64_t start = host_time_ns();
+        host_process(buf, n);
+        ns += host_time_ns() - start;
+        samples += n;
+        if (fwrite(buf, sizeof(int16_t), n, stdout) != n) return 1;
+    }
+    fflush(stdout);
+    host_report("stream", samples, ns);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 2;
+
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    while (((arg+1) < argc) && ((!strcmp(argv[arg], "-c")) || (!strcmp(argv[arg], "-b"))))
+    {
+        uint control_no, value;
+        if (!strcmp(argv[arg], "-b"))
+        {
+            if ((sscanf(argv[arg+1], "%u", &host_block) != 1) || (host_block > DSP_BLOCK_MAX))
+            {
+                usage();
+                return 1;
+            }
+        } else
+        {
+            if ((sscanf(argv[arg+1], "%u=%u", &control_no, &value) != 2) ||
+                (control_no == 0) || (control_no > POTENTIOMETER_MAX) || (value >= POT_MAX_VALUE))
+            {
+                usage();
+                return 1;
+            }
+            host_set_potentiometer_value(control_no, value);
+        }
+        arg += 2;
+    }
+    initialize_dsp();
+    if (!strcmp(argv[1], "render")) return host_render(argc - arg, &argv[arg]);
+    if (!strcmp(argv[1], "stream")) return host_stream(argc - arg, &argv[arg]);
+    usage();
+    return 1;
+}
@@ -0,0 +1,53 @@
+/* host_hal.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "guitarpico.h"
+
+/* control inputs as the firmware numbers them: 0 is "no control",
+   1..POTENTIOMETER_MAX are the pots and pedal inputs */
+static uint16_t host_potentiometer_values[POTENTIOMETER_MAX+1];
+
+uint16_t read_potentiometer_value(uint v)
+{
+    if ((v == 0) || (v > POTENTIOMETER_MAX))
+        return 0;
+    return host_potentiometer_values[v];
+}
+
+void host_set_potentiometer_value(uint v, uint16_t value)
+{
+    if ((v == 0) || (v > POTENTIOMETER_MAX))
+        return;
+    host_potentiometer_values[v] = value;
+}
+
+uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec)*1000000000u + ts.tv_nsec;
+}
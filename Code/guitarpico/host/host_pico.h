@@ -0,0 +1,59 @@
+/* host_pico.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/* Stands in for the pico SDK headers pulled in by guitarpico.h when the
+   DSP engine is compiled for a workstation (GUITARPICO_HOST defined). */
+
+#ifndef _HOST_PICO_H
+#define _HOST_PICO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+
+#define __dmb() __sync_synchronize()
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) __attribute__((noinline)) func_name
+#define __time_critical_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void host_set_potentiometer_value(uint v, uint16_t value);
+uint64_t host_time_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HOST_PICO_H */
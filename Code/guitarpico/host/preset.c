@@ -0,0 +1,114 @@
+/* preset.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <math.h>
+#include "guitarpico.h"
+#include "dsp.h"
+#include "preset.h"
+
+/* Reads the text printed by the CONF command:
+
+     INIT 1 5 Bandpass
+     SET 1 Frequency 400 100 4000
+     ...
+     END 0 END
+
+   INIT and SET behave as the serial commands do, anything else
+   (GETDESC/SETDESC, prompts, END) is ignored. */
+
+#define PRESET_MAX_TOKENS 6
+
+static int preset_tokenize(char *c, char *tokens[])
+{
+    int n = 0;
+    while (n < PRESET_MAX_TOKENS)
+    {
+        while ((*c == ' ') || (*c == '\t') || (*c == '\r') || (*c == '\n') || (*c == '>')) c++;
+        if (*c == '\000') break;
+        tokens[n++] = c;
+        while ((*c != ' ') && (*c != '\t') && (*c != '\r') && (*c != '\n') && (*c != '\000')) c++;
+        if (*c == '\000') break;
+        *c++ = '\000';
+    }
+    return n;
+}
+
+bool preset_apply_line(const char *line)
+{
+    char buf[256];
+    char *tokens[PRESET_MAX_TOKENS];
+
+    strncpy(buf, line, sizeof(buf)-1);
+    buf[sizeof(buf)-1] = '\000';
+    int n = preset_tokenize(buf, tokens);
+    if (n == 0) return true;
+    if (!strcasecmp(tokens[0], "INIT"))
+    {
+        if (n < 3) return false;
+        uint unit_no = atoi(tokens[1]);
+        uint type_no = atoi(tokens[2]);
+        if ((unit_no == 0) || (unit_no > MAX_DSP_UNITS) || (type_no >= DSP_TYPE_MAX_ENTRY)) return false;
+        if (!dsp_chain_memory_fits(dsp_chain_memory_replace(unit_no-1, (dsp_unit_type) type_no))) return false;
+        dsp_unit_initialize(unit_no-1, (dsp_unit_type) type_no);
+        return true;
+    }
+    if (!strcasecmp(tokens[0], "SET"))
+    {
+        if (n < 4) return false;
+        uint unit_no = atoi(tokens[1]);
+        return (unit_no > 0) && dsp_unit_set_value(unit_no-1, tokens[2], strtoul(tokens[3], NULL, 10));
+    }
+    return true;
+}
+
+bool preset_load_file(const char *filename)
+{
+    char line[256];
+    uint line_no = 0;
+    bool ok = true;
+    FILE *fp;
+
+    if ((fp = fopen(filename, "r")) == NULL)
+    {
+        fprintf(stderr, "Could not open preset %s\n", filename);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_no++;
+        if (!preset_apply_line(line))
+        {
+            fprintf(stderr, "%s:%u: could not apply: %s", filename, line_no, line);
+            ok = false;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
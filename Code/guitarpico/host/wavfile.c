@@ -0,0 +1,169 @@
+/* wavfile.c
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "wavfile.h"
+
+/* Only 16 bit PCM is handled.  Multichannel files are mixed down to mono,
+   which is what the pedal's single ADC input sees. */
+
+static uint32_t wavfile_le32(const uint8_t *b)
+{
+    return ((uint32_t)b[0]) | (((uint32_t)b[1]) << 8) | (((uint32_t)b[2]) << 16) | (((uint32_t)b[3]) << 24);
+}
+
+static uint16_t wavfile_le16(const uint8_t *b)
+{
+    return ((uint16_t)b[0]) | (((uint16_t)b[1]) << 8);
+}
+
+static void wavfile_put_le32(uint8_t *b, uint32_t v)
+{
+    b[0] = v; b[1] = v >> 8; b[2] = v >> 16; b[3] = v >> 24;
+}
+
+static void wavfile_put_le16(uint8_t *b, uint16_t v)
+{
+    b[0] = v; b[1] = v >> 8;
+}
+
+bool wavfile_read(const char *filename, wavfile_data *wd)
+{
+    uint8_t hdr[12], chunk[8], fmt[16];
+    uint16_t channels = 0, bits = 0, format = 0;
+    bool have_fmt = false;
+    FILE *fp;
+
+    memset((void *)wd, '\000', sizeof(wavfile_data));
+    if ((fp = fopen(filename, "rb")) == NULL) return false;
+    if ((fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(hdr, "RIFF", 4) || memcmp(&hdr[8], "WAVE", 4))
+    {
+        fclose(fp);
+        return false;
+    }
+    while (fread(chunk, 1, sizeof(chunk), fp) == sizeof(chunk))
+    {
+        uint32_t len = wavfile_le32(&chunk[4]);
+        if (!memcmp(chunk, "fmt ", 4))
+        {
+            if ((len < sizeof(fmt)) || (fread(fmt, 1, sizeof(fmt), fp) != sizeof(fmt))) break;
+            format = wavfile_le16(&fmt[0]);
+            channels = wavfile_le16(&fmt[2]);
+            wd->samplerate = wavfile_le32(&fmt[4]);
+            bits = wavfile_le16(&fmt[14]);
+            have_fmt = true;
+            fseek(fp, (len - sizeof(fmt)) + (len & 1), SEEK_CUR);
+        } else if (!memcmp(chunk, "data", 4))
+        {
+            if ((!have_fmt) || (format != 1) || (bits != 16) || (channels == 0)) break;
+            uint32_t frames = len / (2 * channels);
+            if ((wd->data = (int16_t *)malloc(sizeof(int16_t) * (frames + 1))) == NULL) break;
+            for (uint32_t i=0;i<frames;i++)
+            {
+                uint8_t b[2];
+                int32_t sum = 0;
+                for (uint16_t c=0;c<channels;c++)
+                {
+                    if (fread(b, 1, 2, fp) != 2) break;
+                    sum += (int16_t)wavfile_le16(b);
+                }
+                wd->data[i] = sum / channels;
+                wd->samples++;
+            }
+            fclose(fp);
+            return true;
+        } else
+            fseek(fp, len + (len & 1), SEEK_CUR);
+    }
+    fclose(fp);
+    wavfile_free(wd);
+    return false;
+}
+
+bool wavfile_write(const char *filename, const int16_t *data, uint32_t samples, uint32_t samplerate)
+{
+    uint8_t hdr[44];
+    FILE *fp;
+
+    memcpy(&hdr[0], "RIFF", 4);
+    wavfile_put_le32(&hdr[4], 36 + samples * 2);
+    memcpy(&hdr[8], "WAVEfmt ", 8);
+    wavfile_put_le32(&hdr[16], 16);
+    wavfile_put_le16(&hdr[20], 1);
+    wavfile_put_le16(&hdr[22], 1);
+    wavfile_put_le32(&hdr[24], samplerate);
+    wavfile_put_le32(&hdr[28], samplerate * 2);
+    wavfile_put_le16(&hdr[32], 2);
+    wavfile_put_le16(&hdr[34], 16);
+    memcpy(&hdr[36], "data", 4);
+    wavfile_put_le32(&hdr[40], samples * 2);
+
+    if ((fp = fopen(filename, "wb")) == NULL) return false;
+    bool ok = fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr);
+    for (uint32_t i=0;(i<samples) && ok;i++)
+    {
+        uint8_t b[2];
+        wavfile_put_le16(b, (uint16_t)data[i]);
+        ok = fwrite(b, 1, 2, fp) == 2;
+    }
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+/* linear interpolation, good enough to audition a preset recorded at 44.1 or 48 kHz */
+bool wavfile_resample(wavfile_data *wd, uint32_t samplerate)
+{
+    if ((wd->samplerate == samplerate) || (wd->samples == 0))
+    {
+        wd->samplerate = samplerate;
+        return true;
+    }
+    uint32_t samples = (uint32_t)((((uint64_t)wd->samples) * samplerate) / wd->samplerate);
+    int16_t *data = (int16_t *)malloc(sizeof(int16_t) * (samples + 1));
+    if (data == NULL) return false;
+    for (uint32_t i=0;i<samples;i++)
+    {
+        uint64_t pos = (((uint64_t)i) * wd->samplerate * 65536u) / samplerate;
+        uint32_t n = pos >> 16, frac = pos & 0xFFFF;
+        int32_t s0 = wd->data[n];
+        int32_t s1 = (n+1) < wd->samples ? wd->data[n+1] : s0;
+        data[i] = s0 + (((s1 - s0) * (int32_t)frac) / 65536);
+    }
+    free(wd->data);
+    wd->data = data;
+    wd->samples = samples;
+    wd->samplerate = samplerate;
+    return true;
+}
+
+void wavfile_free(wavfile_data *wd)
+{
+    free(wd->data);
+    wd->data = NULL;
+    wd->samples = 0;
+}
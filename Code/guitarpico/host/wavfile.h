@@ -0,0 +1,53 @@
+/* wavfile.h
+
+*/
+
+/*
+   Copyright (c) 2024 Daniel Marks
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _WAVFILE_H
+#define _WAVFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+    uint32_t samplerate;
+    uint32_t samples;
+    int16_t *data;
+} wavfile_data;
+
+bool wavfile_read(const char *filename, wavfile_data *wd);
+bool wavfile_write(const char *filename, const int16_t *data, uint32_t samples, uint32_t samplerate);
+bool wavfile_resample(wavfile_data *wd, uint32_t samplerate);
+void wavfile_free(wavfile_data *wd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _WAVFILE_H */